@@ -0,0 +1,167 @@
+//===-- IndexBenchmark.cpp --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares the counterexample cache indexes, MapOfSets and SetIndex, on
+// synthetic keys shaped like those of the counterexample cache: the path
+// conditions of a tree of states, which share long prefixes, each extended
+// by a negated branch condition.
+//
+// Usage: cex-cache-index-benchmark [states] [queries] [seed]
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/SetIndex.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <sys/time.h>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+double now() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/// Cached values; odd values stand for unsatisfiable queries
+struct IsUnsat {
+  bool operator()(unsigned v) const { return v % 2; }
+};
+
+struct IsSat {
+  bool operator()(unsigned v) const { return !(v % 2); }
+};
+
+/// Path conditions of a random tree of states
+void generateKeys(unsigned count, std::vector<std::set<unsigned> > &keys) {
+  unsigned nextId = 0;
+  std::vector<std::set<unsigned> > states(1);
+  while (keys.size() < count) {
+    std::set<unsigned> &state = states[rand() % states.size()];
+    // A query is the path condition and a new or already seen condition
+    std::set<unsigned> key = state;
+    key.insert(rand() % 4 ? nextId++ : rand() % (nextId + 1));
+    keys.push_back(key);
+    // Fork: extend the path condition
+    if (state.size() < 64) {
+      std::set<unsigned> child = state;
+      child.insert(nextId++);
+      states.push_back(child);
+    }
+  }
+}
+
+struct Result {
+  double insert, lookup, subset, superset;
+  unsigned found;
+};
+
+Result runMapOfSets(const std::vector<std::set<unsigned> > &keys,
+                    const std::vector<std::set<unsigned> > &queries) {
+  Result r;
+  r.found = 0;
+  MapOfSets<unsigned, unsigned> index;
+
+  double start = now();
+  for (unsigned i = 0; i < keys.size(); ++i)
+    index.insert(keys[i], i);
+  r.insert = now() - start;
+
+  start = now();
+  for (unsigned i = 0; i < queries.size(); ++i)
+    r.found += index.lookup(queries[i]) != 0;
+  r.lookup = now() - start;
+
+  start = now();
+  for (unsigned i = 0; i < queries.size(); ++i)
+    r.found += index.findSubset(queries[i], IsUnsat()) != 0;
+  r.subset = now() - start;
+
+  start = now();
+  for (unsigned i = 0; i < queries.size(); ++i)
+    r.found += index.findSuperset(queries[i], IsSat()) != 0;
+  r.superset = now() - start;
+
+  return r;
+}
+
+Result runSetIndex(const std::vector<std::set<unsigned> > &keys,
+                   const std::vector<std::set<unsigned> > &queries) {
+  typedef SetIndex<unsigned>::key_ty key_ty;
+  Result r;
+  r.found = 0;
+  SetIndex<unsigned> index;
+
+  // Keys are built from the sets as the cache builds them from queries
+  double start = now();
+  for (unsigned i = 0; i < keys.size(); ++i)
+    index.insert(key_ty(keys[i].begin(), keys[i].end()), i);
+  r.insert = now() - start;
+
+  std::vector<key_ty> q;
+  start = now();
+  for (unsigned i = 0; i < queries.size(); ++i) {
+    key_ty key(queries[i].begin(), queries[i].end());
+    r.found += index.lookup(key) != 0;
+    q.push_back(key);
+  }
+  r.lookup = now() - start;
+
+  start = now();
+  for (unsigned i = 0; i < q.size(); ++i)
+    r.found += index.findSubset(q[i], IsUnsat()) != 0;
+  r.subset = now() - start;
+
+  start = now();
+  for (unsigned i = 0; i < q.size(); ++i)
+    r.found += index.findSuperset(q[i], IsSat()) != 0;
+  r.superset = now() - start;
+
+  return r;
+}
+
+void print(const char *name, const Result &r) {
+  printf("%-10s %10.3f %10.3f %10.3f %10.3f %10u\n", name, r.insert, r.lookup,
+         r.subset, r.superset, r.found);
+}
+
+}
+
+int main(int argc, char **argv) {
+  unsigned states = argc > 1 ? atoi(argv[1]) : 100000;
+  unsigned queries = argc > 2 ? atoi(argv[2]) : 100000;
+  srand(argc > 3 ? atoi(argv[3]) : 1);
+
+  std::vector<std::set<unsigned> > keys, lookups;
+  generateKeys(states, keys);
+  generateKeys(queries, lookups);
+  // Half of the queries are repeated
+  for (unsigned i = 0; i < lookups.size(); i += 2)
+    lookups[i] = keys[rand() % keys.size()];
+
+  printf("%u keys, %u queries (times in seconds)\n", states, queries);
+  printf("%-10s %10s %10s %10s %10s %10s\n", "index", "insert", "lookup",
+         "subset", "superset", "found");
+  Result a = runMapOfSets(keys, lookups);
+  print("MapOfSets", a);
+  Result b = runSetIndex(keys, lookups);
+  print("SetIndex", b);
+
+  if (a.found != b.found) {
+    printf("error: the indexes found different numbers of results\n");
+    return 1;
+  }
+  return 0;
+}
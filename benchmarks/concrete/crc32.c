@@ -0,0 +1,31 @@
+/*
+ * Bitwise CRC-32 of a pseudo-random buffer
+ */
+
+#define SIZE 65536
+
+static unsigned char buffer[SIZE];
+
+unsigned crc32(const unsigned char *data, unsigned size) {
+  unsigned crc = 0xffffffffu;
+  unsigned i, bit;
+
+  for (i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+int main() {
+  unsigned seed = 12345;
+  unsigned i;
+
+  // Linear congruential generator
+  for (i = 0; i < SIZE; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    buffer[i] = seed >> 16;
+  }
+  return crc32(buffer, SIZE) == 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * Product of two square integer matrices
+ */
+
+#define N 64
+
+static int a[N][N], b[N][N], c[N][N];
+
+int main() {
+  int i, j, k;
+  long long trace = 0;
+
+  for (i = 0; i < N; ++i) {
+    for (j = 0; j < N; ++j) {
+      a[i][j] = (i * 7 + j * 3) % 17 - 8;
+      b[i][j] = (i * 5 - j * 11) % 13;
+    }
+  }
+
+  for (i = 0; i < N; ++i) {
+    for (j = 0; j < N; ++j) {
+      int sum = 0;
+      for (k = 0; k < N; ++k)
+        sum += a[i][k] * b[k][j];
+      c[i][j] = sum;
+    }
+  }
+
+  for (i = 0; i < N; ++i)
+    trace += c[i][i];
+  return trace == 0;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python
+# -*- encoding: utf-8 -*-
+
+# ===-- run-benchmarks.py -------------------------------------------------===##
+#
+#                      The KLEE Symbolic Virtual Machine
+#
+#  This file is distributed under the University of Illinois Open Source
+#  License. See LICENSE.TXT for details.
+#
+# ===----------------------------------------------------------------------===##
+
+"""Measure the interpreter speed on fully concrete programs.
+
+The programs make no input symbolic, so KLEE runs a single path without
+solver queries, and the instructions per second measure the cost of
+interpreting concrete instructions alone. The metrics of all runs are written
+as JSON, which can be kept as a baseline and compared against by later runs.
+"""
+
+from __future__ import division
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+PROGRAMS = [
+    'crc32',
+    'matrix_multiply',
+    'sieve',
+]
+
+CONFIGS = [
+    ('default', []),
+    ('precision', ['-precision']),
+]
+
+FORMAT_VERSION = 1
+
+
+def compile_program(cc, source, bitcode):
+    """Compile a program to LLVM bitcode."""
+    cmd = [cc, '-emit-llvm', '-c', '-g', '-O0', source, '-o', bitcode]
+    subprocess.check_call(cmd)
+
+
+def read_stats(output_dir):
+    """Return the last row of run.stats as a dictionary."""
+    path = os.path.join(output_dir, 'run.stats')
+    if not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        lines = [ln.strip() for ln in f if ln.strip()]
+    if len(lines) < 2:
+        return {}
+    # The header and rows are Python tuple literals
+    header = [h.strip().strip("'") for h in lines[0].strip('()').split(',')
+              if h.strip()]
+    values = [v.strip() for v in lines[-1].strip('()').split(',') if v.strip()]
+    return dict((h, float(v)) for h, v in zip(header, values))
+
+
+def measure(klee, options, bitcode, output_dir):
+    """Run KLEE on a program and collect its metrics."""
+    if os.path.exists(output_dir):
+        shutil.rmtree(output_dir)
+    cmd = [klee, '-output-dir=' + output_dir] + options + [bitcode]
+    with open(os.devnull, 'w') as devnull:
+        start = time.time()
+        code = subprocess.call(cmd, stdout=devnull, stderr=devnull)
+        wall = time.time() - start
+
+    stats = read_stats(output_dir)
+    instructions = stats.get('Instructions', 0)
+    klee_time = stats.get('WallTime', wall)
+    return {
+        'exit_code': code,
+        'wall_time': wall,
+        'instructions': int(instructions),
+        'instructions_per_second':
+            instructions / klee_time if klee_time > 0 else 0.0,
+    }
+
+
+def main():
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description='Measure the interpreter speed on concrete programs.')
+    parser.add_argument('--klee', default='klee', help='path to klee')
+    parser.add_argument('--cc', default='clang',
+                        help='C compiler producing LLVM bitcode')
+    parser.add_argument('--work-dir', default='concrete-benchmarks',
+                        help='directory for bitcode and KLEE output')
+    parser.add_argument('--programs', nargs='+', default=PROGRAMS,
+                        choices=PROGRAMS, help='programs to run')
+    parser.add_argument('--configs', nargs='+',
+                        default=[name for name, _ in CONFIGS],
+                        choices=[name for name, _ in CONFIGS],
+                        help='configurations to run')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='number of runs per benchmark; the run with '
+                        'the median speed is reported')
+    parser.add_argument('--output', default='concrete-benchmarks.json',
+                        help='file the results are written to')
+    parser.add_argument('--baseline',
+                        help='baseline results to compare against')
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help='relative slowdown reported as a regression '
+                        '(default 0.1)')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.work_dir):
+        os.makedirs(args.work_dir)
+
+    options = dict(CONFIGS)
+    results = []
+    for program in args.programs:
+        source = os.path.join(script_dir, program + '.c')
+        bitcode = os.path.join(args.work_dir, program + '.bc')
+        compile_program(args.cc, source, bitcode)
+
+        for config in args.configs:
+            output_dir = os.path.join(args.work_dir,
+                                      '%s-%s' % (program, config))
+            runs = sorted((measure(args.klee, options[config], bitcode,
+                                   output_dir)
+                           for _ in range(args.repeat)),
+                          key=lambda r: r['instructions_per_second'])
+            metrics = runs[len(runs) // 2]
+            print('%-16s %-10s %8.2fs %10d instr %12.0f instr/s' %
+                  (program, config, metrics['wall_time'],
+                   metrics['instructions'],
+                   metrics['instructions_per_second']))
+            results.append({'program': program, 'config': config,
+                            'options': options[config], 'metrics': metrics})
+
+    with open(args.output, 'w') as f:
+        json.dump({'version': FORMAT_VERSION, 'results': results}, f,
+                  indent=2, sort_keys=True)
+
+    if not args.baseline:
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    if baseline.get('version') != FORMAT_VERSION:
+        print('Error: baseline format version mismatch', file=sys.stderr)
+        return 2
+    previous = dict(((r['program'], r['config']), r['metrics'])
+                    for r in baseline['results'])
+    regressions = 0
+    for r in results:
+        old = previous.get((r['program'], r['config']))
+        if not old or not old['instructions_per_second']:
+            continue
+        new_speed = r['metrics']['instructions_per_second']
+        old_speed = old['instructions_per_second']
+        change = (old_speed - new_speed) / old_speed
+        if change > args.tolerance:
+            regressions += 1
+            print('REGRESSION: %s [%s] instructions_per_second: %g -> %g '
+                  '(%+.1f%%)' % (r['program'], r['config'], old_speed,
+                                 new_speed, -100 * change))
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
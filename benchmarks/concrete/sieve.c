@@ -0,0 +1,20 @@
+/*
+ * Sieve of Eratosthenes, counting the primes below a bound
+ */
+
+#define LIMIT 200000
+
+static unsigned char composite[LIMIT];
+
+int main() {
+  unsigned i, j, count = 0;
+
+  for (i = 2; i < LIMIT; ++i) {
+    if (composite[i])
+      continue;
+    ++count;
+    for (j = 2 * i; j < LIMIT; j += i)
+      composite[j] = 1;
+  }
+  return count != 17984;
+}
@@ -0,0 +1,32 @@
+/*
+ * Dot product of two symbolic vectors
+ */
+
+#include <klee/klee.h>
+
+#define N 4
+
+double dot_product(double *x, double *y, unsigned n) {
+  double sum = 0.0;
+  unsigned i;
+
+  for (i = 0; i < n; ++i)
+    sum += x[i] * y[i];
+  return sum;
+}
+
+int main() {
+  double x[N], y[N];
+  unsigned i;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+  klee_make_symbolic(y, sizeof(y), "y");
+  for (i = 0; i < N; ++i) {
+    klee_track_error(&x[i], "x_err");
+    klee_track_error(&y[i], "y_err");
+  }
+
+  double result = dot_product(x, y, N);
+  klee_bound_error(result, "result", 1.0);
+  return 0;
+}
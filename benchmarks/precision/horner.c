@@ -0,0 +1,33 @@
+/*
+ * Polynomial evaluation using Horner's scheme
+ */
+
+#include <klee/klee.h>
+
+#define DEGREE 5
+
+double horner(const double *coeffs, unsigned degree, double x) {
+  double result = coeffs[degree];
+  unsigned i;
+
+  for (i = degree; i > 0; --i)
+    result = result * x + coeffs[i - 1];
+  return result;
+}
+
+int main() {
+  const double coeffs[DEGREE + 1] = { 1.0, -2.5, 0.75, 3.0, -0.125, 0.5 };
+  double x;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_track_error(&x, "x_err");
+
+  // Evaluate the polynomial on either side of its domain split
+  double result;
+  if (x < 0.0)
+    result = horner(coeffs, DEGREE, -x);
+  else
+    result = horner(coeffs, DEGREE, x);
+  klee_bound_error(result, "result", 1.0);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Compensated (Kahan) summation compared against naive summation
+ */
+
+#include <klee/klee.h>
+
+#define N 4
+
+double naive_sum(const double *x, unsigned n) {
+  double sum = 0.0;
+  unsigned i;
+
+  for (i = 0; i < n; ++i)
+    sum += x[i];
+  return sum;
+}
+
+double kahan_sum(const double *x, unsigned n) {
+  double sum = 0.0;
+  double c = 0.0;
+  unsigned i;
+
+  for (i = 0; i < n; ++i) {
+    double y = x[i] - c;
+    double t = sum + y;
+    c = (t - sum) - y;
+    sum = t;
+  }
+  return sum;
+}
+
+int main() {
+  double x[N];
+  unsigned i;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+  for (i = 0; i < N; ++i)
+    klee_track_error(&x[i], "x_err");
+
+  double naive = naive_sum(x, N);
+  double compensated = kahan_sum(x, N);
+  klee_bound_error(naive, "naive", 1.0);
+  klee_bound_error(compensated, "compensated", 1.0);
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Product of two symbolic square matrices
+ */
+
+#include <klee/klee.h>
+
+#define N 2
+
+void matrix_multiply(double a[N][N], double b[N][N], double c[N][N]) {
+  unsigned i, j, k;
+
+  for (i = 0; i < N; ++i) {
+    for (j = 0; j < N; ++j) {
+      double sum = 0.0;
+      for (k = 0; k < N; ++k)
+        sum += a[i][k] * b[k][j];
+      c[i][j] = sum;
+    }
+  }
+}
+
+int main() {
+  double a[N][N], b[N][N], c[N][N];
+  unsigned i, j;
+
+  klee_make_symbolic(a, sizeof(a), "a");
+  klee_make_symbolic(b, sizeof(b), "b");
+  for (i = 0; i < N; ++i) {
+    for (j = 0; j < N; ++j) {
+      klee_track_error(&a[i][j], "a_err");
+      klee_track_error(&b[i][j], "b_err");
+    }
+  }
+
+  matrix_multiply(a, b, c);
+  klee_bound_error(c[0][0], "c00", 1.0);
+  klee_bound_error(c[N - 1][N - 1], "c11", 1.0);
+  return 0;
+}
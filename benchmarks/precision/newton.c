@@ -0,0 +1,37 @@
+/*
+ * Square root by Newton iteration, compared against the libm result
+ */
+
+#include <klee/klee.h>
+
+#include <math.h>
+
+#define ITERATIONS 3
+
+double newton_sqrt(double a) {
+  double x = a;
+  unsigned i;
+
+  for (i = 0; i < ITERATIONS; ++i) {
+    double next = 0.5 * (x + a / x);
+    // Stop early once the iterate no longer decreases
+    if (next >= x)
+      break;
+    x = next;
+  }
+  return x;
+}
+
+int main() {
+  double a;
+
+  klee_make_symbolic(&a, sizeof(a), "a");
+  klee_track_error(&a, "a_err");
+  klee_assume(a > 1.0);
+
+  double approx = newton_sqrt(a);
+  double exact = sqrt(a);
+  klee_bound_error(approx, "approx", 1.0);
+  klee_bound_error(exact, "exact", 1.0);
+  return 0;
+}
@@ -0,0 +1,269 @@
+#!/usr/bin/env python
+# -*- encoding: utf-8 -*-
+
+# ===-- run-benchmarks.py -------------------------------------------------===##
+#
+#                      The KLEE Symbolic Virtual Machine
+#
+#  This file is distributed under the University of Illinois Open Source
+#  License. See LICENSE.TXT for details.
+#
+# ===----------------------------------------------------------------------===##
+
+"""Run the numerical precision analysis benchmarks and record their cost.
+
+Each kernel is compiled to bitcode once and run by KLEE under every selected
+configuration. The metrics of all runs are written as JSON, which can be kept
+as a baseline and compared against by later runs.
+"""
+
+from __future__ import division
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+KERNELS = [
+    'dot_product',
+    'horner',
+    'kahan_sum',
+    'matrix_multiply',
+    'newton',
+    'stencil',
+]
+
+CONFIGS = [
+    ('precision', ['-precision']),
+    ('loop-breaking', ['-precision', '-loop-breaking']),
+    ('real', ['-precision', '-compute-error-bound=real']),
+    ('integer', ['-precision', '-compute-error-bound=integer']),
+    ('math-calls', ['-precision', '-math-calls']),
+]
+
+# Metrics compared against a baseline, and whether larger values are better
+COMPARED_METRICS = [
+    ('wall_time', False),
+    ('instructions_per_second', True),
+    ('path_solver_time', False),
+    ('error_solver_time', False),
+    ('peak_rss_kb', False),
+    ('output_bytes', False),
+]
+
+FORMAT_VERSION = 1
+
+
+def compile_kernel(cc, include_dir, source, bitcode):
+    """Compile a kernel to LLVM bitcode."""
+    cmd = [cc, '-I', include_dir, '-emit-llvm', '-c', '-g', '-O0',
+           source, '-o', bitcode]
+    subprocess.check_call(cmd)
+
+
+def read_stats(output_dir):
+    """Return the last row of run.stats as a dictionary."""
+    path = os.path.join(output_dir, 'run.stats')
+    if not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        lines = [ln.strip() for ln in f if ln.strip()]
+    if len(lines) < 2:
+        return {}
+    # The header and rows are Python tuple literals
+    header = [h.strip().strip("'") for h in lines[0].strip('()').split(',')
+              if h.strip()]
+    values = [v.strip() for v in lines[-1].strip('()').split(',') if v.strip()]
+    return dict((h, float(v)) for h, v in zip(header, values))
+
+
+def read_info(output_dir):
+    """Return the summary counters KLEE reports in the info file."""
+    path = os.path.join(output_dir, 'info')
+    result = {}
+    if not os.path.exists(path):
+        return result
+    pattern = re.compile(r'^KLEE: done: (.*) = (\d+)$')
+    with open(path) as f:
+        for line in f:
+            m = pattern.match(line.strip())
+            if m:
+                result[m.group(1)] = int(m.group(2))
+    return result
+
+
+def output_sizes(output_dir):
+    """Return the total size of the output directory and of the precision
+    reports in it, in bytes."""
+    total = 0
+    precision = 0
+    for root, _, files in os.walk(output_dir):
+        for name in files:
+            size = os.path.getsize(os.path.join(root, name))
+            total += size
+            if name.endswith('.precision_error'):
+                precision += size
+    return total, precision
+
+
+def run_klee(klee, options, bitcode, output_dir):
+    """Run KLEE, returning its exit status, wall time and peak RSS (KB)."""
+    if os.path.exists(output_dir):
+        shutil.rmtree(output_dir)
+    cmd = [klee, '-output-dir=' + output_dir] + options + [bitcode]
+    with open(os.devnull, 'w') as devnull:
+        start = time.time()
+        proc = subprocess.Popen(cmd, stdout=devnull, stderr=devnull)
+        _, status, rusage = os.wait4(proc.pid, 0)
+        wall = time.time() - start
+    # Already reaped by wait4
+    proc.returncode = status
+    return os.WEXITSTATUS(status), wall, rusage.ru_maxrss
+
+
+def measure(klee, options, bitcode, output_dir):
+    """Run a single benchmark and collect its metrics."""
+    code, wall, rss = run_klee(klee, options, bitcode, output_dir)
+    stats = read_stats(output_dir)
+    info = read_info(output_dir)
+    total_bytes, precision_bytes = output_sizes(output_dir)
+
+    instructions = stats.get('Instructions', 0)
+    klee_time = stats.get('WallTime', wall)
+    # Every fork adds one explored path
+    forks = max(info.get('explored paths', 1) - 1, 0)
+
+    return {
+        'exit_code': code,
+        'wall_time': wall,
+        'instructions': int(instructions),
+        'instructions_per_second':
+            instructions / klee_time if klee_time > 0 else 0.0,
+        'forks': forks,
+        'forks_per_second': forks / klee_time if klee_time > 0 else 0.0,
+        'completed_paths': info.get('completed paths', 0),
+        'queries': int(stats.get('NumQueries', 0)),
+        'path_solver_time': stats.get('SolverTime', 0.0),
+        # Only reported by KLEE versions that time the error solver separately
+        'error_solver_time': stats.get('ErrorSolverTime'),
+        'peak_rss_kb': rss,
+        'output_bytes': total_bytes,
+        'precision_error_bytes': precision_bytes,
+    }
+
+
+def median_run(runs):
+    """Combine repeated runs, taking the median of each numeric metric."""
+    result = dict(runs[0])
+    for key, value in runs[0].items():
+        if isinstance(value, (int, float)) and not isinstance(value, bool):
+            values = sorted(r[key] for r in runs)
+            result[key] = values[len(values) // 2]
+    return result
+
+
+def compare(results, baseline, tolerance):
+    """Print the metrics that regressed against the baseline by more than the
+    tolerance, returning the number of regressions."""
+    previous = dict(((r['kernel'], r['config']), r['metrics'])
+                    for r in baseline['results'])
+    regressions = 0
+    for r in results:
+        old = previous.get((r['kernel'], r['config']))
+        if old is None:
+            continue
+        for metric, higher_is_better in COMPARED_METRICS:
+            new_value = r['metrics'].get(metric)
+            old_value = old.get(metric)
+            if new_value is None or old_value is None or old_value == 0:
+                continue
+            change = (new_value - old_value) / old_value
+            if higher_is_better:
+                change = -change
+            if change > tolerance:
+                regressions += 1
+                print('REGRESSION: %s [%s] %s: %g -> %g (%+.1f%%)' %
+                      (r['kernel'], r['config'], metric, old_value, new_value,
+                       100 * change))
+    return regressions
+
+
+def main():
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description='Run the numerical precision analysis benchmarks.')
+    parser.add_argument('--klee', default='klee', help='path to klee')
+    parser.add_argument('--cc', default='clang',
+                        help='C compiler producing LLVM bitcode')
+    parser.add_argument('--include',
+                        default=os.path.join(script_dir, '..', '..', 'include'),
+                        help='directory containing klee/klee.h')
+    parser.add_argument('--work-dir', default='precision-benchmarks',
+                        help='directory for bitcode and KLEE output')
+    parser.add_argument('--kernels', nargs='+', default=KERNELS,
+                        choices=KERNELS, help='kernels to run')
+    parser.add_argument('--configs', nargs='+',
+                        default=[name for name, _ in CONFIGS],
+                        choices=[name for name, _ in CONFIGS],
+                        help='configurations to run')
+    parser.add_argument('--max-time', type=int, default=300,
+                        help='time limit of each KLEE run (s)')
+    parser.add_argument('--repeat', type=int, default=1,
+                        help='number of runs per benchmark; the median of '
+                        'each metric is reported')
+    parser.add_argument('--output', default='precision-benchmarks.json',
+                        help='file the results are written to')
+    parser.add_argument('--baseline',
+                        help='baseline results to compare against')
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help='relative change of a metric reported as a '
+                        'regression (default 0.1)')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.work_dir):
+        os.makedirs(args.work_dir)
+
+    options = dict(CONFIGS)
+    results = []
+    for kernel in args.kernels:
+        source = os.path.join(script_dir, kernel + '.c')
+        bitcode = os.path.join(args.work_dir, kernel + '.bc')
+        compile_kernel(args.cc, args.include, source, bitcode)
+
+        for config in args.configs:
+            output_dir = os.path.join(args.work_dir,
+                                      '%s-%s' % (kernel, config))
+            klee_options = (['-max-time=%d' % args.max_time] +
+                            options[config])
+            runs = [measure(args.klee, klee_options, bitcode, output_dir)
+                    for _ in range(args.repeat)]
+            metrics = median_run(runs)
+            print('%-16s %-14s %8.2fs %10.0f instr/s %6d forks %8d KB' %
+                  (kernel, config, metrics['wall_time'],
+                   metrics['instructions_per_second'], metrics['forks'],
+                   metrics['peak_rss_kb']))
+            results.append({'kernel': kernel, 'config': config,
+                            'options': klee_options, 'metrics': metrics})
+
+    with open(args.output, 'w') as f:
+        json.dump({'version': FORMAT_VERSION, 'results': results}, f,
+                  indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get('version') != FORMAT_VERSION:
+            print('Error: baseline format version mismatch', file=sys.stderr)
+            return 2
+        if compare(results, baseline, args.tolerance):
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
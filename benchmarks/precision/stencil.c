@@ -0,0 +1,37 @@
+/*
+ * Three-point averaging stencil on a symbolic grid, with clamping at the
+ * boundaries
+ */
+
+#include <klee/klee.h>
+
+#define N 5
+#define STEPS 2
+
+void stencil_step(const double *in, double *out, unsigned n) {
+  unsigned i;
+
+  for (i = 0; i < n; ++i) {
+    double left = i > 0 ? in[i - 1] : in[i];
+    double right = i + 1 < n ? in[i + 1] : in[i];
+    double value = 0.25 * left + 0.5 * in[i] + 0.25 * right;
+    out[i] = value < 0.0 ? 0.0 : value;
+  }
+}
+
+int main() {
+  double grid[N], next[N];
+  unsigned i, step;
+
+  klee_make_symbolic(grid, sizeof(grid), "grid");
+  for (i = 0; i < N; ++i)
+    klee_track_error(&grid[i], "grid_err");
+
+  for (step = 0; step < STEPS; ++step) {
+    stencil_step(grid, next, N);
+    for (i = 0; i < N; ++i)
+      grid[i] = next[i];
+  }
+  klee_bound_error(grid[N / 2], "center", 1.0);
+  return 0;
+}
@@ -0,0 +1,154 @@
+//===-- InstructionInfoBenchmark.cpp ----------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the startup cost of building the InstructionInfoTable of a module,
+// typically a large program linked with uClibc, and compares its mapping of
+// instructions to assembly lines with that of printing the module to memory
+// and parsing it back.
+//
+// Usage: instruction-info-benchmark <module.bc>
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Config/Version.h"
+#include "klee/Internal/Module/InstructionInfoTable.h"
+
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#else
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#endif
+
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+#include "llvm/Assembly/AssemblyAnnotationWriter.h"
+#include "llvm/Support/InstIterator.h"
+#else
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/InstIterator.h"
+#endif
+
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+using namespace llvm;
+using namespace klee;
+
+namespace {
+
+double now() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+long maxRSS() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss / 1024;
+}
+
+class PointerAnnotator : public AssemblyAnnotationWriter {
+public:
+  void emitInstructionAnnot(const Instruction *i, formatted_raw_ostream &os) {
+    os << "%%%" << (uintptr_t)i;
+  }
+};
+
+/// The former line mapping: print the module to memory, annotated with the
+/// address of each instruction, and find the annotations in the text
+void printToMemory(Module *m, std::map<const Instruction *, unsigned> &out) {
+  PointerAnnotator a;
+  std::string str;
+  raw_string_ostream os(str);
+  m->print(os, &a);
+  os.flush();
+
+  unsigned line = 1;
+  for (const char *s = str.c_str(); *s; s++) {
+    if (*s == '\n') {
+      line++;
+      if (s[1] == '%' && s[2] == '%' && s[3] == '%') {
+        char *end;
+        unsigned long long value = strtoull(s + 4, &end, 10);
+        out.insert(std::make_pair((const Instruction *)value, line));
+        s = end - 1;
+      }
+    }
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <module.bc>\n", argv[0]);
+    return 1;
+  }
+
+  LLVMContext ctx;
+  SMDiagnostic err;
+  Module *m = ParseIRFile(argv[1], err, ctx);
+  if (!m) {
+    err.print(argv[0], errs());
+    return 1;
+  }
+
+  // The table is built first, as peak memory only grows; each mapping is
+  // charged with the growth of the peak while it runs
+  long baseRSS = maxRSS();
+  double start = now();
+  InstructionInfoTable *infos = new InstructionInfoTable(m);
+  double tableTime = now() - start;
+  long tableRSS = maxRSS();
+
+  std::map<const Instruction *, unsigned> lines;
+  start = now();
+  printToMemory(m, lines);
+  double printTime = now() - start;
+  long printRSS = maxRSS();
+
+  unsigned count = 0, mismatches = 0;
+  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); fnIt != fn_ie;
+       ++fnIt) {
+    Function *fn = static_cast<Function *>(fnIt);
+    for (inst_iterator it = inst_begin(fn), ie = inst_end(fn); it != ie;
+         ++it) {
+      ++count;
+      if (infos->getInfo(&*it).assemblyLine != lines[&*it])
+        ++mismatches;
+    }
+  }
+
+  printf("%u instructions (times in seconds, memory in MB)\n", count);
+  printf("%-20s %10s %10s\n", "mapping", "time", "extra-peak");
+  printf("%-20s %10.3f %10ld\n", "InstructionInfoTable", tableTime,
+         tableRSS - baseRSS);
+  printf("%-20s %10.3f %10ld\n", "print-to-memory", printTime,
+         printRSS - tableRSS);
+
+  delete infos;
+  delete m;
+  if (mismatches) {
+    printf("error: %u instructions have different assembly lines\n",
+           mismatches);
+    return 1;
+  }
+  return 0;
+}
@@ -19,6 +19,10 @@ extern llvm::cl::opt<bool> UseCache;
 
 extern llvm::cl::opt<bool> UseIndependentSolver; 
 
+extern llvm::cl::opt<std::string> PersistentQueryCache;
+
+extern llvm::cl::opt<unsigned> PersistentQueryCacheSize;
+
 extern llvm::cl::opt<bool> DebugValidateSolver;
   
 extern llvm::cl::opt<int> MinQueryTimeToLog;
@@ -37,7 +41,9 @@ enum QueryLoggingSolverType
     ALL_KQUERY,   ///< Log all queries (un-optimised) in .kquery (KQuery) format
     ALL_SMTLIB,   ///< Log all queries (un-optimised)  .smt2 (SMT-LIBv2) format
     SOLVER_KQUERY,///< Log queries passed to solver (optimised) in .kquery (KQuery) format
-    SOLVER_SMTLIB ///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    SOLVER_SMTLIB,///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    ALL_BINARY,   ///< Log all queries (un-optimised) in the binary query log format
+    SOLVER_BINARY ///< Log queries passed to solver (optimised) in the binary query log format
 };
 
 /* Using cl::list<> instead of cl::bits<> results in quite a bit of ugliness when it comes to checking
@@ -51,10 +57,13 @@ enum CoreSolverType {
   METASMT_SOLVER,
   DUMMY_SOLVER,
   Z3_SOLVER,
+  PORTFOLIO_SOLVER,
   NO_SOLVER
 };
 extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
+extern llvm::cl::list<CoreSolverType> SolverPortfolio;
+
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 
 extern llvm::cl::opt<bool> PrecisionError;
@@ -71,6 +80,8 @@ extern llvm::cl::opt<bool> ComputeRealSolution;
 
 extern llvm::cl::opt<bool> UniformInputError;
 
+extern llvm::cl::opt<bool> BatchErrorBound;
+
 extern llvm::cl::opt<bool> DebugPrecision;
 
 extern llvm::cl::opt<bool> LoopBreaking;
@@ -18,6 +18,7 @@
 // (ConstraintSet?) which ConstraintManager could embed if it likes.
 namespace klee {
 
+class ConstraintFactors;
 class ExprVisitor;
   
 class ConstraintManager {
@@ -26,14 +27,16 @@ public:
   typedef constraints_ty::iterator iterator;
   typedef constraints_ty::const_iterator const_iterator;
 
-  ConstraintManager() {}
+  ConstraintManager() : factors(0), keepFactors(false), id(newId()) {}
 
   // create from constraints with no optimization
   explicit
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
-    constraints(_constraints) {}
+    constraints(_constraints), factors(0), keepFactors(false), id(newId()) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  ConstraintManager(const ConstraintManager &cs);
+  ConstraintManager &operator=(const ConstraintManager &cs);
+  ~ConstraintManager();
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -45,6 +48,27 @@ public:
 
   void addConstraint(ref<Expr> e);
 
+  /// hasFactors - Whether the partition of the constraints into independent
+  /// factors is kept. It is for the constraints added by addConstraint(),
+  /// but not for constraint sets created from a vector. The partition is
+  /// brought up to date when it is next used, so that the constraint sets of
+  /// forked states only copy it when their factors are asked for.
+  bool hasFactors() const {
+    return keepFactors;
+  }
+
+  /// getIndependentConstraints - Collect, in order, the constraints which
+  /// share an array element with \arg e, directly or through other
+  /// constraints. Requires hasFactors().
+  void getIndependentConstraints(ref<Expr> e,
+                                 std::vector< ref<Expr> > &result) const;
+
+  /// getIndependentFactors - Partition the constraints, together with \arg e
+  /// unless it is null, into factors sharing no array element. The factor
+  /// of \arg e comes first and starts with it. Requires hasFactors().
+  void getIndependentFactors(
+      ref<Expr> e, std::vector< std::vector< ref<Expr> > > &result) const;
+
   bool empty() const {
     return constraints.empty();
   }
@@ -64,14 +88,31 @@ public:
   bool operator==(const ConstraintManager &other) const {
     return constraints == other.constraints;
   }
+
+  /// getId - An identifier of the constraint set. It is shared by the copies
+  /// of this manager and renewed whenever a constraint is added, so two
+  /// managers with the same id hold the same constraints.
+  uint64_t getId() const {
+    return id;
+  }
   
 private:
   std::vector< ref<Expr> > constraints;
+  // independent factors of the constraints, shared copy-on-write with the
+  // copies of this manager; they may lag behind the constraints
+  mutable ConstraintFactors *factors;
+  bool keepFactors;
+  uint64_t id;
+
+  static uint64_t newId();
 
   // returns true iff the constraints were modified
   bool rewriteConstraints(ExprVisitor &visitor);
 
   void addConstraintInternal(ref<Expr> e);
+
+  void releaseFactors() const;
+  void updateFactors() const;
 };
 
 }
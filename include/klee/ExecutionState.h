@@ -98,6 +98,14 @@ public:
   /// @brief Constraints collected so far
   ConstraintManager constraints;
 
+  /// @brief Constraints collected before the branch conditions whose
+  /// feasibility check is deferred (see -deferred-branch-check)
+  std::vector<ref<Expr> > deferredConstraints;
+
+  /// @brief Conjunction of the branch conditions added since
+  /// deferredConstraints whose feasibility is not checked yet, or null
+  ref<Expr> deferredCondition;
+
   /// Statistics and information
 
   /// @brief Costs for all queries issued for this state, in seconds
@@ -165,6 +173,10 @@ public:
 
   ExecutionState *branch();
 
+  /// @brief Record a branch condition, about to be added to the
+  /// constraints, whose feasibility is to be checked later
+  void deferBranchCheck(ref<Expr> condition);
+
   void pushFrame(KInstIterator caller, KFunction *kf);
   void popFrame();
 
@@ -90,6 +90,8 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 class Expr {
 public:
   static unsigned count;
+  /// Whether the alloc() methods intern new nodes, set by -intern-exprs
+  static bool interning;
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -202,8 +204,12 @@ protected:
   virtual int compareContents(const Expr &b) const = 0;
 
 public:
-  Expr() : refCount(0) { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  Expr() : refCount(0), interned(false) { Expr::count++; }
+  virtual ~Expr() {
+    if (interned)
+      unintern();
+    Expr::count--;
+  }
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
@@ -283,9 +289,31 @@ public:
 
   static bool classof(const Expr *) { return true; }
 
+  /// Returns the canonical node structurally equal to `e`, which becomes the
+  /// canonical node if there is none, when interning is enabled
+  /// (-intern-exprs). Otherwise, returns `e`.
+  ///
+  /// Interned nodes are kept in a global table which does not hold references
+  /// to them, so a node leaves the table when it is destroyed. Two interned
+  /// nodes are structurally equal iff they are the same node.
+  ///
+  /// Called by the alloc() methods once the hash of the new node is computed.
+  static ref<Expr> intern(const ref<Expr> &e);
+
+  /// Whether this is the canonical node of its structure.
+  bool isInterned() const { return interned; }
+
 private:
+  bool interned;
+
   typedef llvm::DenseSet<std::pair<const Expr *, const Expr *> > ExprEquivSet;
   int compare(const Expr &b, ExprEquivSet &equivs) const;
+
+  /// Whether `a` and `b` are structurally equal, given that their kids are
+  /// typically canonical nodes.
+  static bool isShallowEqual(const Expr &a, const Expr &b);
+  /// Removes this node from the interning table.
+  void unintern();
 };
 
 struct Expr::CreateArg {
@@ -418,7 +446,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &src) {
     ref<Expr> r(new NotOptimizedExpr(src));
     r->computeHash();
-    return r;
+    return intern(r);
   }
   
   static ref<Expr> create(ref<Expr> src);
@@ -578,7 +606,7 @@ public:
   static ref<Expr> alloc(const UpdateList &updates, const ref<Expr> &index) {
     ref<Expr> r(new ReadExpr(updates, index));
     r->computeHash();
-    return r;
+    return intern(r);
   }
   
   static ref<Expr> create(const UpdateList &updates, ref<Expr> i);
@@ -623,7 +651,7 @@ public:
                          const ref<Expr> &f) {
     ref<Expr> r(new SelectExpr(c, t, f));
     r->computeHash();
-    return r;
+    return intern(r);
   }
   
   static ref<Expr> create(ref<Expr> c, ref<Expr> t, ref<Expr> f);
@@ -686,7 +714,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {
     ref<Expr> c(new ConcatExpr(l, r));
     c->computeHash();
-    return c;
+    return intern(c);
   }
   
   static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);
@@ -753,7 +781,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e, unsigned o, Width w) {
     ref<Expr> r(new ExtractExpr(e, o, w));
     r->computeHash();
-    return r;
+    return intern(r);
   }
   
   /// Creates an ExtractExpr with the given bit offset and width
@@ -804,7 +832,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e) {
     ref<Expr> r(new NotExpr(e));
     r->computeHash();
-    return r;
+    return intern(r);
   }
   
   static ref<Expr> create(const ref<Expr> &e);
@@ -881,7 +909,7 @@ public:                                                          \
     static ref<Expr> alloc(const ref<Expr> &e, Width w) {        \
       ref<Expr> r(new _class_kind ## Expr(e, w));                \
       r->computeHash();                                          \
-      return r;                                                  \
+      return intern(r);                                          \
     }                                                            \
     static ref<Expr> create(const ref<Expr> &e, Width w);        \
     Kind getKind() const { return _class_kind; }                 \
@@ -914,7 +942,7 @@ CAST_EXPR_CLASS(ZExt)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return intern(res);                                                      \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Width getWidth() const { return left->getWidth(); }                        \
@@ -963,7 +991,7 @@ ARITHMETIC_EXPR_CLASS(AShr)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return intern(res);                                                      \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Kind getKind() const { return _class_kind; }                               \
@@ -1068,7 +1096,7 @@ public:
   static ref<ConstantExpr> alloc(const llvm::APInt &v) {
     ref<ConstantExpr> r(new ConstantExpr(v));
     r->computeHash();
-    return r;
+    return cast<ConstantExpr>(intern(r));
   }
 
   static ref<ConstantExpr> alloc(const llvm::APFloat &f) {
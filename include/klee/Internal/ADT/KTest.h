@@ -11,6 +11,8 @@
 #define __COMMON_KTEST_H__
 
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -49,6 +51,10 @@ extern "C" {
 
   /* returns 1 on success, 0 on (unspecified) error */
   int   kTest_toFile(KTest *, const char *path);
+
+  /* returns the contents of a .ktest file, allocated with malloc and of
+     *size bytes, or NULL on (unspecified) error */
+  unsigned char *kTest_toBuffer(KTest *, size_t *size);
   
   /* returns total number of object bytes */
   unsigned kTest_numBytes(KTest *);
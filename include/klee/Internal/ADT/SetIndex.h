@@ -0,0 +1,195 @@
+//===-- SetIndex.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SETINDEX_H
+#define KLEE_SETINDEX_H
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace klee {
+
+  /// SetIndex - A map from sets of small integer ids to values, supporting
+  /// the same subset and superset searches as MapOfSets.
+  ///
+  /// Sets are sorted vectors of distinct ids, typically interned by the
+  /// client. Each id has a posting list of the sets containing it, used to
+  /// find supersets, and a list of the sets whose largest element it is,
+  /// used to find subsets. Each set also has a 64-bit signature with a bit per
+  /// id modulo 64, which rules out most candidates without looking at their
+  /// elements. No memory is allocated by lookups.
+  ///
+  /// Pointers to values stay valid until clear() is called.
+  template<class V>
+  class SetIndex {
+  public:
+    typedef std::vector<unsigned> key_ty;
+
+  private:
+    struct Entry {
+      key_ty set;
+      uint64_t signature;
+      V value;
+    };
+
+    std::deque<Entry> entries;
+    /// Entries by hash of their set, for exact lookups
+    std::multimap<uint64_t, unsigned> byHash;
+    /// Entries containing each id
+    std::vector<std::vector<unsigned> > postings;
+    /// Entries whose largest element is each id
+    std::vector<std::vector<unsigned> > byLargest;
+    /// Index of the entry for the empty set, or -1
+    int emptyEntry;
+
+    static uint64_t signature(const key_ty &set) {
+      uint64_t s = 0;
+      for (typename key_ty::const_iterator it = set.begin(), ie = set.end();
+           it != ie; ++it)
+        s |= 1ULL << (*it % 64);
+      return s;
+    }
+
+    static uint64_t hash(const key_ty &set) {
+      uint64_t h = 0xcbf29ce484222325ULL;
+      for (typename key_ty::const_iterator it = set.begin(), ie = set.end();
+           it != ie; ++it)
+        h = (h ^ *it) * 0x100000001b3ULL;
+      return h;
+    }
+
+  public:
+    SetIndex() : emptyEntry(-1) {}
+
+    size_t size() const { return entries.size(); }
+
+    void clear() {
+      entries.clear();
+      byHash.clear();
+      postings.clear();
+      byLargest.clear();
+      emptyEntry = -1;
+    }
+
+    V *lookup(const key_ty &set) {
+      if (set.empty())
+        return emptyEntry < 0 ? 0 : &entries[emptyEntry].value;
+      std::pair<std::multimap<uint64_t, unsigned>::iterator,
+                std::multimap<uint64_t, unsigned>::iterator>
+          range = byHash.equal_range(hash(set));
+      for (; range.first != range.second; ++range.first) {
+        Entry &e = entries[range.first->second];
+        if (e.set == set)
+          return &e.value;
+      }
+      return 0;
+    }
+
+    void insert(const key_ty &set, const V &value) {
+      if (V *existing = lookup(set)) {
+        *existing = value;
+        return;
+      }
+
+      unsigned index = entries.size();
+      entries.push_back(Entry());
+      Entry &e = entries.back();
+      e.set = set;
+      e.signature = signature(set);
+      e.value = value;
+
+      if (set.empty()) {
+        emptyEntry = index;
+      } else {
+        byHash.insert(std::make_pair(hash(set), index));
+        if (postings.size() <= set.back()) {
+          postings.resize(set.back() + 1);
+          byLargest.resize(set.back() + 1);
+        }
+        for (typename key_ty::const_iterator it = set.begin(), ie = set.end();
+             it != ie; ++it)
+          postings[*it].push_back(index);
+        byLargest[set.back()].push_back(index);
+      }
+    }
+
+    /// findSubset - Return the value of a stored subset of \arg set which
+    /// satisfies \arg p, or null if there is none.
+    template<class Predicate>
+    V *findSubset(const key_ty &set, const Predicate &p) {
+      if (emptyEntry >= 0 && p(entries[emptyEntry].value))
+        return &entries[emptyEntry].value;
+
+      // The largest element of a subset is an element of the set, so each
+      // candidate is looked at exactly once.
+      uint64_t sig = signature(set);
+      for (typename key_ty::const_iterator it = set.begin(), ie = set.end();
+           it != ie; ++it) {
+        if (*it >= byLargest.size())
+          break;
+        const std::vector<unsigned> &list = byLargest[*it];
+        for (std::vector<unsigned>::const_iterator lit = list.begin(),
+                                                   lie = list.end();
+             lit != lie; ++lit) {
+          Entry &e = entries[*lit];
+          if ((e.signature & ~sig) || e.set.size() > set.size())
+            continue;
+          if (std::includes(set.begin(), set.end(), e.set.begin(),
+                            e.set.end()) &&
+              p(e.value))
+            return &e.value;
+        }
+      }
+      return 0;
+    }
+
+    /// findSuperset - Return the value of a stored superset of \arg set which
+    /// satisfies \arg p, or null if there is none.
+    template<class Predicate>
+    V *findSuperset(const key_ty &set, const Predicate &p) {
+      if (set.empty()) {
+        for (typename std::deque<Entry>::iterator it = entries.begin(),
+                                                  ie = entries.end();
+             it != ie; ++it)
+          if (p(it->value))
+            return &it->value;
+        return 0;
+      }
+
+      // Every superset is in the posting list of the rarest element
+      const std::vector<unsigned> *rarest = 0;
+      for (typename key_ty::const_iterator it = set.begin(), ie = set.end();
+           it != ie; ++it) {
+        if (*it >= postings.size() || postings[*it].empty())
+          return 0;
+        if (!rarest || postings[*it].size() < rarest->size())
+          rarest = &postings[*it];
+      }
+
+      uint64_t sig = signature(set);
+      for (std::vector<unsigned>::const_iterator it = rarest->begin(),
+                                                 ie = rarest->end();
+           it != ie; ++it) {
+        Entry &e = entries[*it];
+        if ((sig & ~e.signature) || e.set.size() < set.size())
+          continue;
+        if (std::includes(e.set.begin(), e.set.end(), set.begin(), set.end()) &&
+            p(e.value))
+          return &e.value;
+      }
+      return 0;
+    }
+  };
+
+}
+
+#endif
@@ -15,10 +15,61 @@
 namespace klee {
   class MemoryObject;
 
+  /// A register. Concrete values of up to 64 bits can be held inline, in
+  /// which case the ConstantExpr is only built when the value is asked for as
+  /// an expression, so that concrete interpretation does not allocate an
+  /// expression for every result.
   struct Cell {
-    ref<Expr> value;
+  private:
+    /// The value as an expression, null while a concrete value is only held
+    /// inline.
+    mutable ref<Expr> value;
+    uint64_t concreteValue;
+    /// The width of the concrete value, or 0 if the value is not concrete.
+    Expr::Width concreteWidth;
+
+  public:
     ref<Expr> error;
     ref<Expr> valueWithError;
+
+    Cell() : concreteValue(0), concreteWidth(0) {}
+
+    /// Returns the value, building its expression if it is only held inline.
+    const ref<Expr> &getValue() const {
+      if (value.isNull() && concreteWidth)
+        value = ConstantExpr::create(concreteValue, concreteWidth);
+      return value;
+    }
+
+    void setValue(const ref<Expr> &e) {
+      value = e;
+      ConstantExpr *ce = dyn_cast_or_null<ConstantExpr>(e.get());
+      if (ce && ce->getWidth() <= Expr::Int64) {
+        concreteValue = ce->getZExtValue();
+        concreteWidth = ce->getWidth();
+      } else {
+        concreteWidth = 0;
+      }
+    }
+
+    /// Holds the concrete value \arg v of width \arg w inline.
+    void setConcreteValue(uint64_t v, Expr::Width w) {
+      assert(w && w <= Expr::Int64 && "invalid width for concrete value");
+      value = ref<Expr>();
+      concreteValue = v & (~0ULL >> (64 - w));
+      concreteWidth = w;
+    }
+
+    /// Whether the value is a constant of at most 64 bits.
+    bool isConcrete() const { return concreteWidth != 0; }
+
+    /// The zero extended constant value; the value must be concrete.
+    uint64_t getConcreteValue() const {
+      assert(isConcrete() && "value is not concrete");
+      return concreteValue;
+    }
+
+    Expr::Width getConcreteWidth() const { return concreteWidth; }
   };
 }
 
@@ -117,6 +117,10 @@ namespace klee {
     // Mark function with functionName as part of the KLEE runtime
     void addInternalFunction(const char* functionName);
 
+    // Link the intrinsic runtime and run the passes preparing the module
+    // for interpretation
+    void transform(const Interpreter::ModuleOptions &opts);
+
   public:
     KModule(llvm::Module *_module);
     ~KModule();
@@ -0,0 +1,94 @@
+//===-- AsyncFileWriter.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_ASYNCFILEWRITER_H
+#define KLEE_ASYNCFILEWRITER_H
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+  /// AsyncFileWriter - Writes files on a background thread, so that slow
+  /// disks do not stall the caller.
+  ///
+  /// The contents of each file are handed over whole. Once the queued
+  /// contents exceed a bound, the caller waits for the writer to catch up.
+  /// Failures are reported as warnings by the caller's thread, on its next
+  /// call. The thread only handles strings, so the contents must not refer
+  /// to expressions or other unsynchronized state.
+  class AsyncFileWriter {
+    struct Request {
+      std::string path;
+      std::string contents;
+      bool append;
+    };
+
+    size_t maxQueued;
+    size_t queued;
+    std::deque<Request> requests;
+    /// Writing a request taken off the queue
+    bool busy;
+    bool stopping;
+    std::vector<std::string> failures;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    /// Signalled when a request is queued, or on stopping
+    pthread_cond_t queuedCond;
+    /// Signalled when a request has been written
+    pthread_cond_t writtenCond;
+
+    static void *run(void *writer);
+    void writeRequests();
+    static bool writeFile(const Request &request);
+    void queue(const std::string &path, std::string &contents, bool append);
+    /// Warn about failed writes; called with the mutex held
+    void reportFailures();
+
+  public:
+    explicit AsyncFileWriter(size_t maxQueued = 64 << 20);
+    /// Waits until all files are written
+    ~AsyncFileWriter();
+
+    /// Write \arg contents to the file at \arg path, replacing it. The
+    /// contents are taken over, leaving \arg contents empty.
+    void write(const std::string &path, std::string &contents);
+
+    /// Append \arg contents to the file at \arg path, after the files
+    /// queued before. The contents are taken over, leaving \arg contents
+    /// empty.
+    void append(const std::string &path, std::string &contents);
+
+    /// Wait until all queued files are written.
+    void flush();
+  };
+
+  /// async_file_ostream - An output stream to a file written through an
+  /// AsyncFileWriter once the stream is destroyed.
+  class async_file_ostream : public llvm::raw_ostream {
+    AsyncFileWriter &writer;
+    std::string path;
+    std::string contents;
+
+    virtual void write_impl(const char *Ptr, size_t Size);
+    virtual uint64_t current_pos() const { return contents.size(); }
+
+  public:
+    async_file_ostream(AsyncFileWriter &_writer, const std::string &_path);
+    ~async_file_ostream();
+  };
+
+}
+
+#endif
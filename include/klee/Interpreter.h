@@ -46,6 +46,16 @@ public:
   virtual void processTestCase(const ExecutionState &state,
                                const char *err, 
                                const char *suffix) = 0;
+
+  /// Whether another process wants one of the states to explore, see
+  /// Interpreter::setReplayPathPrefix(). Polled periodically; a true answer
+  /// is followed by a call to shareState().
+  virtual bool isStateWanted() { return false; }
+
+  /// Take over a state, as the branch decisions leading to it. The state is
+  /// no longer explored by this interpreter. \arg path is null if there
+  /// was no state to give.
+  virtual void shareState(const std::vector<bool> *path) {}
 };
 
 class Interpreter {
@@ -58,12 +68,16 @@ public:
     bool Optimize;
     bool CheckDivZero;
     bool CheckOvershift;
+    /// The module has already been prepared by an earlier run, and was
+    /// reloaded from the module cache
+    bool Prepared;
 
     ModuleOptions(const std::string &_LibraryDir,
                   const std::string &_EntryPoint, bool _Optimize,
                   bool _CheckDivZero, bool _CheckOvershift)
         : LibraryDir(_LibraryDir), EntryPoint(_EntryPoint), Optimize(_Optimize),
-          CheckDivZero(_CheckDivZero), CheckOvershift(_CheckOvershift) {}
+          CheckDivZero(_CheckDivZero), CheckOvershift(_CheckOvershift),
+          Prepared(false) {}
   };
 
   enum LogType
@@ -81,8 +95,13 @@ public:
     /// symbolic execution on concrete programs.
     unsigned MakeConcreteSymbolic;
 
+    /// Record the forks internal to memory operations in the paths too,
+    /// so that a path leads to exactly one state and states can be handed
+    /// over to other processes as their path.
+    bool CompletePaths;
+
     InterpreterOptions()
-      : MakeConcreteSymbolic(false)
+      : MakeConcreteSymbolic(false), CompletePaths(false)
     {}
   };
 
@@ -124,6 +143,13 @@ public:
   // a user specified path. use null to reset.
   virtual void setReplayPath(const std::vector<bool> *path) = 0;
 
+  // supply a list of branch decisions leading to the state to start
+  // from. exploration goes on from that state once the decisions have
+  // been followed, and states contradicting them are dropped. the runs of
+  // a series of prefixes share their statistics, which are finished when
+  // resetting with null.
+  virtual void setReplayPathPrefix(const std::vector<bool> *path) = 0;
+
   // supply a set of symbolic bindings that will be used as "seeds"
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
@@ -262,6 +262,14 @@ namespace klee {
                               std::vector<bool> &infinity,
                               std::vector<std::pair<int, double> > &values,
                               std::vector<bool> &epsilon, bool &hasSolution);
+
+    /// computeIndependentOptimalValues - Compute optimal values of objects,
+    /// optimizing each of them independently of the others (box priority).
+    bool computeIndependentOptimalValues(
+        const Query &query, const std::vector<const Array *> &objects,
+        std::vector<bool> &infinity,
+        std::vector<std::pair<int, double> > &values,
+        std::vector<bool> &epsilon, bool &hasSolution);
   };
 #endif // ENABLE_Z3
 
@@ -323,6 +331,23 @@ namespace klee {
   ///
   /// \param s - The underlying solver to use.
   Solver *createIndependentSolver(Solver *s);
+
+  /// createPersistentCachingSolver - Create a solver which caches query
+  /// results in a memory mapped file shared by all processes using it.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param path - The cache file, created if it does not exist.
+  /// \param size - The size in bytes of a newly created cache file.
+  Solver *createPersistentCachingSolver(Solver *s, std::string path,
+                                        size_t size);
+
+  /// createRealCachingSolver - Create a solver which splits real-number
+  /// solution queries into independent factors and caches the model of each
+  /// factor. Only computeInitialValues is cached, all other queries are
+  /// forwarded unchanged.
+  ///
+  /// \param s - The underlying real-number solver to use.
+  Solver *createRealCachingSolver(Solver *s);
   
   /// createKQueryLoggingSolver - Create a solver which will forward all queries
   /// after writing them to the given path in .kquery format.
@@ -334,11 +359,26 @@ namespace klee {
   Solver *createSMTLIBLoggingSolver(Solver *s, std::string path,
                                     int minQueryTimeToLog);
 
+  /// createBinaryQueryLoggingSolver - Create a solver which will forward all
+  /// queries after writing them to the given path in the binary query log
+  /// format, which kleaver can replay. The log is written by a background
+  /// thread.
+  Solver *createBinaryQueryLoggingSolver(Solver *s, std::string path,
+                                         int minQueryTimeToLog);
+
 
   /// createDummySolver - Create a dummy solver implementation which always
   /// fails.
   Solver *createDummySolver();
 
+  /// createPortfolioSolver - Create a solver which runs all the given solvers
+  /// on each query in forked processes, taking the first answer.
+  ///
+  /// \param solvers - The solvers to race; owned by the portfolio.
+  /// \param types - The type of each solver, used to attribute wins.
+  Solver *createPortfolioSolver(const std::vector<Solver *> &solvers,
+                                const std::vector<CoreSolverType> &types);
+
   // Create a solver based on the supplied ``CoreSolverType``.
   Solver *createCoreSolver(CoreSolverType cst);
 
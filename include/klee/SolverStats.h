@@ -16,6 +16,22 @@ namespace klee {
 namespace stats {
 
   extern Statistic cexCacheTime;
+  extern Statistic errorAssertions;
+  extern Statistic errorConstructCacheEvictions;
+  extern Statistic errorConstructCacheHits;
+  extern Statistic errorConstructCacheMisses;
+  extern Statistic errorModelQueries;
+  extern Statistic errorModelTime;
+  extern Statistic errorOptimizeQueries;
+  extern Statistic errorOptimizeTime;
+  extern Statistic incrementalAssertedConstraints;
+  extern Statistic incrementalReusedConstraints;
+  extern Statistic incrementalSolverHits;
+  extern Statistic incrementalSolverMisses;
+  extern Statistic persistentCacheTime;
+  extern Statistic portfolioWinsMetaSMT;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsZ3;
   extern Statistic queries;
   extern Statistic queriesInvalid;
   extern Statistic queriesValid;
@@ -26,7 +42,12 @@ namespace stats {
   extern Statistic queryConstructTime;
   extern Statistic queryConstructs;
   extern Statistic queryCounterexamples;
+  extern Statistic queryPersistentCacheHits;
+  extern Statistic queryPersistentCacheMisses;
   extern Statistic queryTime;
+  extern Statistic queryRealCacheHits;
+  extern Statistic queryRealCacheMisses;
+  extern Statistic realCacheTime;
   
 #ifdef DEBUG
   extern Statistic arrayHashTime;
@@ -0,0 +1,139 @@
+//===-- BinaryQueryLog.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A compact binary format for query logs, written by the binary logging
+// solver and replayed by kleaver.
+//
+// A log starts with a magic string and a version, followed by a sequence of
+// records. Arrays, update nodes and expressions are defined by records of
+// their own, each numbered by its order in the log, before the first query
+// which uses them. Later records refer to them by number, so the nodes shared
+// by queries are written once. A reset record discards all definitions, which
+// bounds the memory of the writer and the reader.
+//
+// Integers are written as LEB128 varints; query times as the bits of an
+// IEEE double, in little-endian order.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BINARYQUERYLOG_H
+#define KLEE_BINARYQUERYLOG_H
+
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+  /// BinaryQueryLogRecord - A query of the log, with its result.
+  struct BinaryQueryLogRecord {
+    enum Kind {
+      Truth,
+      Validity,
+      Value,
+      InitialValues
+    };
+
+    Kind kind;
+    /// Whether the solver succeeded; the results are only set if it did
+    bool success;
+    SolverImpl::SolverRunStatus status;
+    /// Time taken by the solver, in seconds
+    double time;
+    /// Number of instructions executed when the query was issued
+    uint64_t instructions;
+
+    std::vector< ref<Expr> > constraints;
+    ref<Expr> expr;
+    /// Objects of an InitialValues query
+    std::vector<const Array *> objects;
+
+    bool isValid;
+    Solver::Validity validity;
+    ref<Expr> value;
+    bool hasSolution;
+    std::vector< std::vector<unsigned char> > values;
+
+    BinaryQueryLogRecord()
+        : kind(Truth), success(false),
+          status(SolverImpl::SOLVER_RUN_STATUS_FAILURE), time(0),
+          instructions(0), isValid(false), validity(Solver::Unknown),
+          hasSolution(false) {}
+  };
+
+  /// BinaryQueryLogWriter - Serializes records into a binary query log.
+  class BinaryQueryLogWriter {
+    ExprHashMap<unsigned> exprIds;
+    std::map<const Array *, unsigned> arrayIds;
+    std::map<const UpdateNode *, unsigned> updateIds;
+    /// Keep the numbered update nodes alive, as they are keyed by address
+    std::vector<UpdateList> updateLists;
+    /// Definitions kept before the writer resets them
+    unsigned maxDefinitions;
+
+    unsigned defineArray(const Array *array, std::string &out);
+    unsigned defineUpdates(const UpdateList &updates, std::string &out);
+    unsigned defineExpr(const ref<Expr> &e, std::string &out);
+    void reset(std::string &out);
+
+  public:
+    explicit BinaryQueryLogWriter(unsigned maxDefinitions = 1 << 20);
+
+    /// Append the magic string and version starting a log to \arg out.
+    static void writeHeader(std::string &out);
+
+    /// Append \arg record to \arg out, preceded by the definitions it uses.
+    void write(const BinaryQueryLogRecord &record, std::string &out);
+  };
+
+  /// BinaryQueryLogReader - Reads the records of a binary query log held in
+  /// memory.
+  class BinaryQueryLogReader {
+    const unsigned char *pos, *end;
+    std::string error;
+
+    ArrayCache arrayCache;
+    std::vector<const Array *> arrays;
+    std::vector<UpdateList> updates;
+    std::vector< ref<Expr> > exprs;
+
+    bool fail(const char *message);
+    bool readVarint(uint64_t &value);
+    bool readUnsigned(unsigned &value);
+    bool readByte(unsigned char &value);
+    bool readConstant(Expr::Width width, ref<ConstantExpr> &value);
+    bool readArrayId(const Array *&array);
+    bool readExprId(ref<Expr> &e);
+    bool readArray();
+    bool readUpdate();
+    bool readExpr(unsigned kind);
+    bool readQuery(BinaryQueryLogRecord &record);
+
+  public:
+    BinaryQueryLogReader(const char *begin, const char *end);
+
+    /// Whether a buffer starts like a binary query log
+    static bool isBinaryQueryLog(const char *begin, const char *end);
+
+    /// Read the next query into \arg record. Returns false at the end of the
+    /// log or on malformed input, in which case getError() is not empty.
+    bool next(BinaryQueryLogRecord &record);
+
+    const std::string &getError() const { return error; }
+  };
+
+}
+
+#endif
@@ -36,6 +36,21 @@ UseIndependentSolver("use-independent-solver",
                      llvm::cl::init(true),
                      llvm::cl::desc("Use constraint independence (default=on)"));
 
+llvm::cl::opt<std::string>
+PersistentQueryCache("persistent-query-cache",
+                     llvm::cl::init(""),
+                     llvm::cl::value_desc("path"),
+                     llvm::cl::desc("Cache the queries reaching the core solver "
+                                    "in the given file, shared across runs "
+                                    "(default=off)"));
+
+llvm::cl::opt<unsigned>
+PersistentQueryCacheSize("persistent-query-cache-size",
+                         llvm::cl::init(256),
+                         llvm::cl::value_desc("MB"),
+                         llvm::cl::desc("Size of a newly created persistent "
+                                        "query cache (default=256)"));
+
 llvm::cl::opt<bool>
 DebugValidateSolver("debug-validate-solver",
 		             llvm::cl::init(false));
@@ -77,6 +92,8 @@ llvm::cl::list<QueryLoggingSolverType> queryLoggingOptions(
         clEnumValN(ALL_SMTLIB,"all:smt2","All queries in .smt2 (SMT-LIBv2) format"),
         clEnumValN(SOLVER_KQUERY,"solver:kquery","All queries reaching the solver in .kquery (KQuery) format"),
         clEnumValN(SOLVER_SMTLIB,"solver:smt2","All queries reaching the solver in .smt2 (SMT-LIBv2) format"),
+        clEnumValN(ALL_BINARY,"all:binary","All queries in the binary query log format"),
+        clEnumValN(SOLVER_BINARY,"solver:binary","All queries reaching the solver in the binary query log format"),
         clEnumValEnd
 	),
     llvm::cl::CommaSeparated
@@ -112,6 +129,14 @@ llvm::cl::opt<bool> UniformInputError(
         "Consider all input errors to be equal when computing error bound."),
     llvm::cl::init(false));
 
+llvm::cl::opt<bool> BatchErrorBound(
+    "batch-error-bound",
+    llvm::cl::desc("Defer the error bound computation of klee_bound_error "
+                   "calls to the end of the path, and compute the bounds of "
+                   "all calls on the path in a single optimization query "
+                   "with independent objectives (default=off)."),
+    llvm::cl::init(false));
+
 llvm::cl::opt<bool> LoopBreaking(
     "loop-breaking",
     llvm::cl::desc(
@@ -212,9 +237,22 @@ llvm::cl::opt<CoreSolverType> CoreSolverToUse(
                      clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT" METASMT_IS_DEFAULT_STR),
                      clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
                      clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+                     clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                                "Race the solvers given by -solver-portfolio "
+                                "on every query"),
                      clEnumValEnd),
     llvm::cl::init(DEFAULT_CORE_SOLVER));
 
+llvm::cl::list<CoreSolverType> SolverPortfolio(
+    "solver-portfolio",
+    llvm::cl::desc("Comma separated list of the solvers raced by "
+                   "-solver-backend=portfolio (default: stp,z3)"),
+    llvm::cl::values(clEnumValN(STP_SOLVER, "stp", "stp"),
+                     clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+                     clEnumValN(Z3_SOLVER, "z3", "Z3"),
+                     clEnumValEnd),
+    llvm::cl::CommaSeparated);
+
 llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith(
     "debug-crosscheck-core-solver",
     llvm::cl::desc(
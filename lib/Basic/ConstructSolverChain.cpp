@@ -20,7 +20,9 @@ Solver *constructSolverChain(Solver *coreSolver,
                              std::string querySMT2LogPath,
                              std::string baseSolverQuerySMT2LogPath,
                              std::string queryKQueryLogPath,
-                             std::string baseSolverQueryKQueryLogPath) {
+                             std::string baseSolverQueryKQueryLogPath,
+                             std::string queryBinaryLogPath,
+                             std::string baseSolverQueryBinaryLogPath) {
   Solver *solver = coreSolver;
 
   if (optionIsSet(queryLoggingOptions, SOLVER_KQUERY)) {
@@ -37,6 +39,21 @@ Solver *constructSolverChain(Solver *coreSolver,
                  baseSolverQuerySMT2LogPath.c_str());
   }
 
+  if (optionIsSet(queryLoggingOptions, SOLVER_BINARY)) {
+    solver = createBinaryQueryLoggingSolver(
+        solver, baseSolverQueryBinaryLogPath, MinQueryTimeToLog);
+    klee_message("Logging queries that reach solver in binary format to %s\n",
+                 baseSolverQueryBinaryLogPath.c_str());
+  }
+
+  if (!PersistentQueryCache.empty()) {
+    solver = createPersistentCachingSolver(
+        solver, PersistentQueryCache,
+        (size_t)PersistentQueryCacheSize << 20);
+    klee_message("Using persistent query cache %s\n",
+                 PersistentQueryCache.c_str());
+  }
+
   if (UseAssignmentValidatingSolver)
     solver = createAssignmentValidatingSolver(solver);
 
@@ -68,6 +85,13 @@ Solver *constructSolverChain(Solver *coreSolver,
     klee_message("Logging all queries in .smt2 format to %s\n",
                  querySMT2LogPath.c_str());
   }
+
+  if (optionIsSet(queryLoggingOptions, ALL_BINARY)) {
+    solver = createBinaryQueryLoggingSolver(solver, queryBinaryLogPath,
+                                            MinQueryTimeToLog);
+    klee_message("Logging all queries in binary format to %s\n",
+                 queryBinaryLogPath.c_str());
+  }
   if (DebugCrossCheckCoreSolverWith != NO_SOLVER) {
     Solver *oracleSolver = createCoreSolver(DebugCrossCheckCoreSolverWith);
     solver = createValidatingSolver(/*s=*/solver, /*oracle=*/oracleSolver);
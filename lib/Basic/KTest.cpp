@@ -175,48 +175,70 @@ KTest *kTest_fromFile(const char *path) {
   return 0;
 }
 
-int kTest_toFile(KTest *bo, const char *path) {
-  FILE *f = fopen(path, "wb");
+static int kTest_toStream(KTest *bo, FILE *f) {
   unsigned i;
 
-  if (!f) 
-    goto error;
   if (fwrite(KTEST_MAGIC, strlen(KTEST_MAGIC), 1, f)!=1)
-    goto error;
+    return 0;
   if (!write_uint32(f, KTEST_VERSION))
-    goto error;
+    return 0;
       
   if (!write_uint32(f, bo->numArgs))
-    goto error;
+    return 0;
   for (i=0; i<bo->numArgs; i++) {
     if (!write_string(f, bo->args[i]))
-      goto error;
+      return 0;
   }
 
   if (!write_uint32(f, bo->symArgvs))
-    goto error;
+    return 0;
   if (!write_uint32(f, bo->symArgvLen))
-    goto error;
+    return 0;
   
   if (!write_uint32(f, bo->numObjects))
-    goto error;
+    return 0;
   for (i=0; i<bo->numObjects; i++) {
     KTestObject *o = &bo->objects[i];
     if (!write_string(f, o->name))
-      goto error;
+      return 0;
     if (!write_uint32(f, o->numBytes))
-      goto error;
+      return 0;
     if (fwrite(o->bytes, o->numBytes, 1, f)!=1)
-      goto error;
+      return 0;
   }
 
-  fclose(f);
-
   return 1;
- error:
-  if (f) fclose(f);
-  
-  return 0;
+}
+
+int kTest_toFile(KTest *bo, const char *path) {
+  FILE *f = fopen(path, "wb");
+  int ok;
+
+  if (!f) 
+    return 0;
+  ok = kTest_toStream(bo, f);
+  if (fclose(f))
+    ok = 0;
+
+  return ok;
+}
+
+unsigned char *kTest_toBuffer(KTest *bo, size_t *size) {
+  char *buffer = 0;
+  FILE *f = open_memstream(&buffer, size);
+  int ok;
+
+  if (!f)
+    return 0;
+  ok = kTest_toStream(bo, f);
+  if (fclose(f))
+    ok = 0;
+  if (!ok) {
+    free(buffer);
+    return 0;
+  }
+
+  return (unsigned char *) buffer;
 }
 
 unsigned kTest_numBytes(KTest *bo) {
@@ -12,11 +12,213 @@
 #include "Memory.h"
 #include "TimingSolver.h"
 
+#include "klee/ExecutionState.h"
 #include "klee/Expr.h"
 #include "klee/TimerStatIncrementer.h"
 
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <map>
+
 using namespace klee;
 
+namespace {
+  llvm::cl::opt<unsigned>
+  ResolutionCacheSize("resolution-cache-size",
+                      llvm::cl::desc("Maximum number of symbolic pointers "
+                                     "whose resolution queries are cached, "
+                                     "0 to disable (default=4096)"),
+                      llvm::cl::init(4096));
+
+  /// Facts about a symbolic pointer under a fixed constraint set, learnt
+  /// while resolving it. They only depend on the addresses and sizes of
+  /// objects, not on the objects themselves, so they stay valid as objects
+  /// are allocated and freed.
+  struct PointerFacts {
+    enum { MayKnown = 1, May = 2, MustKnown = 4, Must = 8 };
+
+    /// A value the pointer may have
+    bool hasExample;
+    uint64_t example;
+
+    /// The range of the pointer: it must be at least \a lower and below
+    /// \a upper (if non-zero). It may be at least \a notLower (if non-zero)
+    /// and may be below \a notUpper.
+    uint64_t lower, upper, notLower, notUpper;
+
+    /// Whether the pointer may and must be in bounds of the object with the
+    /// given address and size
+    std::map<std::pair<uint64_t, unsigned>, unsigned char> inBounds;
+
+    PointerFacts()
+      : hasExample(false), example(0), lower(0), upper(0), notLower(0),
+        notUpper(0) {}
+  };
+
+  typedef std::map<std::pair<uint64_t, ref<Expr> >, PointerFacts>
+      ResolutionCache;
+
+  /// The pointers of all states, keyed by the identity of their constraint
+  /// set, so that states sharing constraints share their facts. Leaked to
+  /// outlive the expressions it refers to.
+  ResolutionCache &getResolutionCache() {
+    static ResolutionCache *cache = new ResolutionCache();
+    return *cache;
+  }
+
+  /// The solver queries made to resolve a symbolic pointer in a state. The
+  /// answers are looked up in, and added to, the resolution cache. Bounds
+  /// already known narrow the search: objects outside of them are ruled out
+  /// without a query.
+  class ResolutionQueries {
+    ExecutionState &state;
+    TimingSolver *solver;
+    ref<Expr> pointer;
+    PointerFacts *facts;
+
+    bool cached() {
+      ++stats::resolveQueriesCached;
+      return true;
+    }
+
+  public:
+    ResolutionQueries(ExecutionState &_state, TimingSolver *_solver,
+                      ref<Expr> _pointer)
+      : state(_state), solver(_solver), pointer(_pointer), facts(0) {
+      if (!ResolutionCacheSize)
+        return;
+      ResolutionCache &cache = getResolutionCache();
+      if (cache.size() >= ResolutionCacheSize)
+        cache.clear();
+      facts = &cache[std::make_pair(state.constraints.getId(), pointer)];
+    }
+
+    /// Get a value the pointer may have.
+    bool getExample(uint64_t &result) {
+      if (facts && facts->hasExample) {
+        result = facts->example;
+        return cached();
+      }
+      ref<ConstantExpr> cex;
+      if (!solver->getValue(state, pointer, cex))
+        return false;
+      result = cex->getZExtValue();
+      if (facts) {
+        facts->hasExample = true;
+        facts->example = result;
+      }
+      return true;
+    }
+
+    /// Whether the pointer must be at least the address of \a mo.
+    bool mustBeAtOrAbove(const MemoryObject *mo, bool &result) {
+      if (facts) {
+        if (mo->address <= facts->lower) {
+          result = true;
+          return cached();
+        }
+        if (facts->notLower && mo->address >= facts->notLower) {
+          result = false;
+          return cached();
+        }
+      }
+      if (!solver->mustBeTrue(
+              state, UgeExpr::create(pointer, mo->getBaseExpr()), result))
+        return false;
+      if (facts) {
+        if (result)
+          facts->lower = std::max(facts->lower, mo->address);
+        else if (!facts->notLower || mo->address < facts->notLower)
+          facts->notLower = mo->address;
+      }
+      return true;
+    }
+
+    /// Whether the pointer must be below the address of \a mo.
+    bool mustBeBelow(const MemoryObject *mo, bool &result) {
+      if (facts) {
+        if (facts->upper && mo->address >= facts->upper) {
+          result = true;
+          return cached();
+        }
+        if (mo->address <= facts->notUpper) {
+          result = false;
+          return cached();
+        }
+      }
+      if (!solver->mustBeTrue(
+              state, UltExpr::create(pointer, mo->getBaseExpr()), result))
+        return false;
+      if (facts) {
+        if (result) {
+          if (!facts->upper || mo->address < facts->upper)
+            facts->upper = mo->address;
+        } else {
+          facts->notUpper = std::max(facts->notUpper, mo->address);
+        }
+      }
+      return true;
+    }
+
+    /// Whether the pointer may be in bounds of \a mo.
+    bool mayBeInBounds(const MemoryObject *mo, bool &result) {
+      unsigned char *known = 0;
+      if (facts) {
+        // Out of the range of the pointer
+        uint64_t end = mo->address + (mo->size ? mo->size : 1);
+        if (end <= facts->lower ||
+            (facts->upper && mo->address >= facts->upper)) {
+          result = false;
+          return cached();
+        }
+        known = &facts->inBounds[std::make_pair(mo->address, mo->size)];
+        if (*known & PointerFacts::MayKnown) {
+          result = *known & PointerFacts::May;
+          return cached();
+        }
+      }
+      if (!solver->mayBeTrue(state, mo->getBoundsCheckPointer(pointer), result))
+        return false;
+      if (known) {
+        *known |= PointerFacts::MayKnown;
+        if (result)
+          *known |= PointerFacts::May;
+        else
+          *known |= PointerFacts::MustKnown;
+      }
+      return true;
+    }
+
+    /// Whether the pointer must be in bounds of \a mo.
+    bool mustBeInBounds(const MemoryObject *mo, bool &result) {
+      unsigned char *known = 0;
+      if (facts) {
+        known = &facts->inBounds[std::make_pair(mo->address, mo->size)];
+        if (*known & PointerFacts::MustKnown) {
+          result = *known & PointerFacts::Must;
+          return cached();
+        }
+      }
+      if (!solver->mustBeTrue(state, mo->getBoundsCheckPointer(pointer),
+                              result))
+        return false;
+      if (known) {
+        *known |= PointerFacts::MustKnown;
+        if (result) {
+          *known |= PointerFacts::Must | PointerFacts::MayKnown |
+                    PointerFacts::May;
+          uint64_t end = mo->address + (mo->size ? mo->size : 1);
+          facts->lower = std::max(facts->lower, mo->address);
+          if (!facts->upper || end < facts->upper)
+            facts->upper = end;
+        }
+      }
+      return true;
+    }
+  };
+}
+
 ///
 
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
@@ -81,12 +283,13 @@ bool AddressSpace::resolveOne(ExecutionState &state,
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
 
+    ResolutionQueries queries(state, solver, address);
+
     // try cheap search, will succeed for any inbounds pointer
 
-    ref<ConstantExpr> cex;
-    if (!solver->getValue(state, address, cex))
+    uint64_t example;
+    if (!queries.getExample(example))
       return false;
-    uint64_t example = cex->getZExtValue();
     MemoryObject hack(example);
     const MemoryMap::value_type *res = objects.lookup_previous(&hack);
     
@@ -111,8 +314,7 @@ bool AddressSpace::resolveOne(ExecutionState &state,
       const MemoryObject *mo = oi->first;
         
       bool mayBeTrue;
-      if (!solver->mayBeTrue(state, 
-                             mo->getBoundsCheckPointer(address), mayBeTrue))
+      if (!queries.mayBeInBounds(mo, mayBeTrue))
         return false;
       if (mayBeTrue) {
         result = *oi;
@@ -120,9 +322,7 @@ bool AddressSpace::resolveOne(ExecutionState &state,
         return true;
       } else {
         bool mustBeTrue;
-        if (!solver->mustBeTrue(state, 
-                                UgeExpr::create(address, mo->getBaseExpr()),
-                                mustBeTrue))
+        if (!queries.mustBeAtOrAbove(mo, mustBeTrue))
           return false;
         if (mustBeTrue)
           break;
@@ -134,18 +334,14 @@ bool AddressSpace::resolveOne(ExecutionState &state,
       const MemoryObject *mo = oi->first;
 
       bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UltExpr::create(address, mo->getBaseExpr()),
-                              mustBeTrue))
+      if (!queries.mustBeBelow(mo, mustBeTrue))
         return false;
       if (mustBeTrue) {
         break;
       } else {
         bool mayBeTrue;
 
-        if (!solver->mayBeTrue(state, 
-                               mo->getBoundsCheckPointer(address),
-                               mayBeTrue))
+        if (!queries.mayBeInBounds(mo, mayBeTrue))
           return false;
         if (mayBeTrue) {
           result = *oi;
@@ -190,10 +386,10 @@ bool AddressSpace::resolve(ExecutionState &state,
     // to hit the fast path with exactly 2 queries). we could also
     // just get this by inspection of the expr.
     
-    ref<ConstantExpr> cex;
-    if (!solver->getValue(state, p, cex))
+    ResolutionQueries queries(state, solver, p);
+    uint64_t example;
+    if (!queries.getExample(example))
       return true;
-    uint64_t example = cex->getZExtValue();
     MemoryObject hack(example);
     
     MemoryMap::iterator oi = objects.upper_bound(&hack);
@@ -217,9 +413,8 @@ bool AddressSpace::resolve(ExecutionState &state,
         return true;
 
       // XXX I think there is some query wasteage here?
-      ref<Expr> inBounds = mo->getBoundsCheckPointer(p);
       bool mayBeTrue;
-      if (!solver->mayBeTrue(state, inBounds, mayBeTrue))
+      if (!queries.mayBeInBounds(mo, mayBeTrue))
         return true;
       if (mayBeTrue) {
         rl.push_back(*oi);
@@ -228,7 +423,7 @@ bool AddressSpace::resolve(ExecutionState &state,
         unsigned size = rl.size();
         if (size==1) {
           bool mustBeTrue;
-          if (!solver->mustBeTrue(state, inBounds, mustBeTrue))
+          if (!queries.mustBeInBounds(mo, mustBeTrue))
             return true;
           if (mustBeTrue)
             return false;
@@ -238,9 +433,7 @@ bool AddressSpace::resolve(ExecutionState &state,
       }
         
       bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UgeExpr::create(p, mo->getBaseExpr()),
-                              mustBeTrue))
+      if (!queries.mustBeAtOrAbove(mo, mustBeTrue))
         return true;
       if (mustBeTrue)
         break;
@@ -252,17 +445,14 @@ bool AddressSpace::resolve(ExecutionState &state,
         return true;
 
       bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UltExpr::create(p, mo->getBaseExpr()),
-                              mustBeTrue))
+      if (!queries.mustBeBelow(mo, mustBeTrue))
         return true;
       if (mustBeTrue)
         break;
       
       // XXX I think there is some query wasteage here?
-      ref<Expr> inBounds = mo->getBoundsCheckPointer(p);
       bool mayBeTrue;
-      if (!solver->mayBeTrue(state, inBounds, mayBeTrue))
+      if (!queries.mayBeInBounds(mo, mayBeTrue))
         return true;
       if (mayBeTrue) {
         rl.push_back(*oi);
@@ -271,7 +461,7 @@ bool AddressSpace::resolve(ExecutionState &state,
         unsigned size = rl.size();
         if (size==1) {
           bool mustBeTrue;
-          if (!solver->mustBeTrue(state, inBounds, mustBeTrue))
+          if (!queries.mustBeInBounds(mo, mustBeTrue))
             return true;
           if (mustBeTrue)
             return false;
@@ -301,7 +491,7 @@ void AddressSpace::copyOutConcretes() {
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
       if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+        os->readConcreteStore(address);
     }
   }
 }
@@ -315,12 +505,12 @@ bool AddressSpace::copyInConcretes() {
       const ObjectState *os = it->second;
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
-      if (memcmp(address, os->concreteStore, mo->size)!=0) {
+      if (!os->equalsConcreteStore(address)) {
         if (os->readOnly) {
           return false;
         } else {
           ObjectState *wos = getWriteable(mo, os);
-          memcpy(wos->concreteStore, address, mo->size);
+          wos->writeConcreteStore(address);
         }
       }
     }
@@ -13,6 +13,7 @@ using namespace klee;
 
 Statistic stats::allocations("Allocations", "Alloc");
 Statistic stats::coveredInstructions("CoveredInstructions", "Icov");
+Statistic stats::deferredInfeasibleStates("DeferredInfeasibleStates", "DIS");
 Statistic stats::falseBranches("FalseBranches", "Bf");
 Statistic stats::forkTime("ForkTime", "Ftime");
 Statistic stats::forks("Forks", "Forks");
@@ -22,6 +23,7 @@ Statistic stats::instructions("Instructions", "I");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
 Statistic stats::reachableUncovered("ReachableUncovered", "IuncovReach");
+Statistic stats::resolveQueriesCached("ResolveQueriesCached", "RQcached");
 Statistic stats::resolveTime("ResolveTime", "Rtime");
 Statistic stats::solverTime("SolverTime", "Stime");
 Statistic stats::states("States", "States");
@@ -17,6 +17,10 @@ namespace stats {
 
   extern Statistic allocations;
   extern Statistic resolveTime;
+
+  /// The number of pointer resolution queries answered by the resolution
+  /// cache instead of the solver.
+  extern Statistic resolveQueriesCached;
   extern Statistic instructions;
   extern Statistic instructionTime;
   extern Statistic instructionRealTime;
@@ -30,6 +34,10 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The number of forked states found infeasible by a deferred
+  /// feasibility check.
+  extern Statistic deferredInfeasibleStates;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
@@ -30,6 +30,15 @@
 
 using namespace klee;
 
+namespace {
+llvm::cl::opt<unsigned> MaxShadowErrorUpdates(
+    "max-shadow-error-updates",
+    llvm::cl::desc("Maximum number of updates kept in the shadow error memory "
+                   "of an object written at symbolic offsets. Beyond it the "
+                   "errors of the object become unspecified (default=64)."),
+    llvm::cl::init(64));
+}
+
 ref<Expr> ErrorState::getError(Executor *executor, ref<Expr> valueExpr,
                                llvm::Value *value) {
   ref<Expr> ret = ConstantExpr::create(0, Expr::Int8);
@@ -87,14 +96,13 @@ ref<Expr> ErrorState::getError(Executor *executor, ref<Expr> valueExpr,
 
 ErrorState::~ErrorState() {}
 
-void ErrorState::outputComputedErrorBound(
-    std::vector<std::pair<int, double> > bounds) {
-  llvm::raw_string_ostream stream(outputString);
-
-  uint64_t size = inputErrorList.size();
+static void writeErrorBounds(llvm::raw_ostream &stream,
+                             const std::vector<ref<Expr> > &inputErrors,
+                             const std::vector<std::pair<int, double> > &bounds) {
+  uint64_t size = inputErrors.size();
   for (unsigned i = 0; i < size; ++i) {
     stream << "Error Bound for ";
-    stream << PrettyExpressionBuilder::construct(inputErrorList.at(i));
+    stream << PrettyExpressionBuilder::construct(inputErrors.at(i));
     stream << " is ";
     std::pair<int, double> p(bounds.at(i));
 
@@ -111,9 +119,43 @@ void ErrorState::outputComputedErrorBound(
     }
     stream << "\n";
   }
+}
+
+void ErrorState::outputComputedErrorBound(
+    std::vector<std::pair<int, double> > bounds) {
+  llvm::raw_string_ostream stream(outputString);
+  writeErrorBounds(stream, inputErrorList, bounds);
   stream.flush();
 }
 
+void ErrorState::deferErrorBound(const ConstraintManager &constraints,
+                                 const ConstraintManager &pathConstraints,
+                                 const std::vector<ref<Expr> > &inputErrors) {
+  DeferredErrorBound deferred;
+  deferred.constraints.assign(constraints.begin(), constraints.end());
+  deferred.pathConstraints = pathConstraints;
+  deferred.inputErrors = inputErrors;
+  deferred.outputPosition = outputString.size();
+  deferredErrorBounds.push_back(deferred);
+}
+
+void ErrorState::outputDeferredErrorBounds(
+    const std::vector<std::vector<std::pair<int, double> > > &bounds) {
+  assert(bounds.size() == deferredErrorBounds.size() &&
+         "bounds of all deferred error bound computations required");
+
+  // Insert from the last position so that earlier positions remain valid
+  for (unsigned i = deferredErrorBounds.size(); i > 0; --i) {
+    const DeferredErrorBound &deferred = deferredErrorBounds.at(i - 1);
+    std::string text;
+    llvm::raw_string_ostream stream(text);
+    writeErrorBounds(stream, deferred.inputErrors, bounds.at(i - 1));
+    stream.flush();
+    outputString.insert(deferred.outputPosition, text);
+  }
+  deferredErrorBounds.clear();
+}
+
 ConstraintManager
 ErrorState::outputErrorBound(llvm::Instruction *inst, ref<Expr> error,
                              double bound, std::string name,
@@ -197,9 +239,9 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
     llvm::Value *rOp = instr->getOperand(1);
 
     ref<Expr> lError = arguments.at(0).error;
-    ref<Expr> lValue = arguments.at(0).value;
+    ref<Expr> lValue = arguments.at(0).getValue();
     ref<Expr> rError = arguments.at(1).error;
-    ref<Expr> rValue = arguments.at(1).value;
+    ref<Expr> rValue = arguments.at(1).getValue();
     if (lError.isNull()) {
       lError = getError(executor, lValue, lOp);
     }
@@ -230,9 +272,9 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
     llvm::Value *rOp = instr->getOperand(1);
 
     ref<Expr> lError = arguments.at(0).error;
-    ref<Expr> lValue = arguments.at(0).value;
+    ref<Expr> lValue = arguments.at(0).getValue();
     ref<Expr> rError = arguments.at(1).error;
-    ref<Expr> rValue = arguments.at(1).value;
+    ref<Expr> rValue = arguments.at(1).getValue();
 
     if (lError.isNull()) {
       lError = getError(executor, lValue, lOp);
@@ -265,9 +307,9 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
     llvm::Value *rOp = instr->getOperand(1);
 
     ref<Expr> lError = arguments.at(0).error;
-    ref<Expr> lValue = arguments.at(0).value;
+    ref<Expr> lValue = arguments.at(0).getValue();
     ref<Expr> rError = arguments.at(1).error;
-    ref<Expr> rValue = arguments.at(1).value;
+    ref<Expr> rValue = arguments.at(1).getValue();
 
     if (lError.isNull()) {
       lError = getError(executor, lValue, lOp);
@@ -287,9 +329,9 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
     llvm::Value *rOp = instr->getOperand(1);
 
     ref<Expr> lError = arguments.at(0).error;
-    ref<Expr> lValue = arguments.at(0).value;
+    ref<Expr> lValue = arguments.at(0).getValue();
     ref<Expr> rError = arguments.at(1).error;
-    ref<Expr> rValue = arguments.at(1).value;
+    ref<Expr> rValue = arguments.at(1).getValue();
 
     if (lError.isNull()) {
       lError = getError(executor, lValue, lOp);
@@ -311,9 +353,9 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
     llvm::Value *rOp = instr->getOperand(1);
 
     ref<Expr> lError = arguments.at(0).error;
-    ref<Expr> lValue = arguments.at(0).value;
+    ref<Expr> lValue = arguments.at(0).getValue();
     ref<Expr> rError = arguments.at(1).error;
-    ref<Expr> rValue = arguments.at(1).value;
+    ref<Expr> rValue = arguments.at(1).getValue();
 
     if (lError.isNull()) {
       lError = getError(executor, lValue, lOp);
@@ -342,17 +384,19 @@ ErrorState::propagateError(Executor *executor, llvm::Instruction *instr,
 
     // x * (1 - ex)
     ref<Expr> extendedLeft = lError;
-    if (lError->getWidth() != arguments.at(0).value->getWidth()) {
+    if (lError->getWidth() != arguments.at(0).getValue()->getWidth()) {
       extendedLeft =
-          ZExtExpr::create(lError, arguments.at(0).value->getWidth());
+          ZExtExpr::create(lError, arguments.at(0).getValue()->getWidth());
     }
     ref<Expr> extendedRight = rError;
-    if (rError->getWidth() != arguments.at(1).value->getWidth()) {
+    if (rError->getWidth() != arguments.at(1).getValue()->getWidth()) {
       extendedRight =
-          ZExtExpr::create(rError, arguments.at(1).value->getWidth());
+          ZExtExpr::create(rError, arguments.at(1).getValue()->getWidth());
     }
-    ref<Expr> leftMul = MulExpr::create(arguments.at(0).value, extendedLeft);
-    ref<Expr> rightMul = MulExpr::create(arguments.at(1).value, extendedRight);
+    ref<Expr> leftMul =
+        MulExpr::create(arguments.at(0).getValue(), extendedLeft);
+    ref<Expr> rightMul =
+        MulExpr::create(arguments.at(1).getValue(), extendedRight);
 
     ref<Expr> conditionWithError;
 
@@ -554,6 +598,18 @@ void ErrorState::executeStoreSimple(ref<Expr> base, ref<Expr> address,
     storedError[intAddress] =
         std::pair<ref<Expr>, ref<Expr> >(error, valueWithError);
 
+    // Keep the shadow error memory of the object up to date, if any
+    if (ConstantExpr *cpBase = llvm::dyn_cast<ConstantExpr>(base)) {
+      std::map<uintptr_t, UpdateList>::iterator it =
+          shadowError.find(cpBase->getZExtValue());
+      if (it != shadowError.end())
+        updateShadowError(
+            it->first, it->second,
+            ConstantExpr::create(intAddress - cpBase->getZExtValue(),
+                                 Expr::Int32),
+            error);
+    }
+
     unsigned line = 0;
     llvm::StringRef file = "";
     llvm::StringRef dir = "";
@@ -652,6 +708,122 @@ void ErrorState::executeStoreSimple(ref<Expr> base, ref<Expr> address,
   }
 }
 
+UpdateList &ErrorState::getShadowError(uint64_t base, unsigned size) {
+  std::map<uintptr_t, UpdateList>::iterator it = shadowError.find(base);
+  if (it != shadowError.end())
+    return it->second;
+
+  std::vector<ref<ConstantExpr> > zeros(size,
+                                        ConstantExpr::create(0, Expr::Int8));
+  std::ostringstream name;
+  name << "_shadow_error_" << base << "_" << shadowErrorCount++;
+  const Array *array = errorArrayCache->CreateArray(
+      name.str(), size, &zeros[0], &zeros[0] + size);
+  UpdateList ul(array, 0);
+
+  // Errors of the elements of a declared input, as read by executeLoad()
+  ref<Expr> baseError = retrieveDeclaredInputError(Expr::createPointer(base));
+  if (!baseError.isNull()) {
+    unsigned elementSize;
+    getInputError(baseError, Expr::createPointer(0), elementSize);
+    if (!elementSize)
+      elementSize = 1;
+    if (size / elementSize > MaxShadowErrorUpdates) {
+      ul = UpdateList(createUnspecifiedShadowError(base, size), 0);
+    } else {
+      for (unsigned offset = 0; offset < size; offset += elementSize) {
+        ref<Expr> error = getInputError(
+            baseError, ConstantExpr::create(offset, Expr::Int32), elementSize);
+        registerInputError(error);
+        updateShadowError(base, ul, ConstantExpr::create(offset, Expr::Int32),
+                          error);
+      }
+    }
+  }
+
+  // Errors stored so far at concrete addresses within the object
+  for (std::map<uintptr_t, std::pair<ref<Expr>, ref<Expr> > >::const_iterator
+           sit = storedError.lower_bound(base),
+           sie = storedError.lower_bound(base + size);
+       sit != sie; ++sit) {
+    updateShadowError(base, ul,
+                      ConstantExpr::create(sit->first - base, Expr::Int32),
+                      sit->second.first);
+  }
+
+  return shadowError.insert(std::make_pair(base, ul)).first->second;
+}
+
+const Array *ErrorState::createUnspecifiedShadowError(uint64_t base,
+                                                      unsigned size) {
+  std::ostringstream name;
+  name << "_unspecified_error_shadow_" << base << "_" << shadowErrorCount++;
+  return errorArrayCache->CreateArray(name.str(), size);
+}
+
+void ErrorState::updateShadowError(uint64_t base, UpdateList &ul,
+                                   ref<Expr> offset, ref<Expr> error) {
+  offset = ZExtExpr::create(offset, Expr::Int32);
+  error = ZExtExpr::create(error, Expr::Int8);
+
+  // An update at a constant offset is dead once the offset is written again,
+  // whatever was written in between, so it is dropped rather than kept.
+  if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
+    std::vector<const UpdateNode *> live;
+    bool overwritten = false;
+    for (const UpdateNode *un = ul.head; un; un = un->next) {
+      ConstantExpr *index = llvm::dyn_cast<ConstantExpr>(un->index);
+      if (index && index->getZExtValue() == ce->getZExtValue())
+        overwritten = true;
+      else
+        live.push_back(un);
+    }
+    if (overwritten) {
+      UpdateList rebuilt(ul.root, 0);
+      for (std::vector<const UpdateNode *>::reverse_iterator
+               it = live.rbegin(),
+               ie = live.rend();
+           it != ie; ++it)
+        rebuilt.extend((*it)->index, (*it)->value);
+      ul = rebuilt;
+    }
+  }
+
+  if (ul.getSize() >= MaxShadowErrorUpdates) {
+    // Too many updates to keep the queries compact: from now on the errors of
+    // the object are unspecified rather than silently zero.
+    ul = UpdateList(createUnspecifiedShadowError(base, ul.root->size), 0);
+    return;
+  }
+  ul.extend(offset, error);
+}
+
+void ErrorState::executeStoreSymbolic(ref<Expr> base, unsigned size,
+                                      ref<Expr> offset, ref<Expr> error) {
+  if (!size)
+    return;
+
+  ConstantExpr *cpBase = llvm::dyn_cast<ConstantExpr>(base);
+  if (!cpBase)
+    return;
+  uint64_t intBase = cpBase->getZExtValue();
+
+  // A value without error overwrites the error stored at its offset
+  if (error.isNull())
+    error = ConstantExpr::create(0, Expr::Int8);
+
+  // Any value stored at a concrete address of the object may be overwritten
+  for (std::map<uintptr_t, std::pair<ref<Expr>, ref<Expr> > >::iterator
+           it = storedError.lower_bound(intBase),
+           ie = storedError.lower_bound(intBase + size);
+       it != ie; ++it)
+    it->second.second = ref<Expr>();
+
+  updateShadowError(intBase, getShadowError(intBase, size), offset, error);
+}
+
+void ErrorState::freeObject(uint64_t base) { shadowError.erase(base); }
+
 void ErrorState::declareInputError(ref<Expr> address, ref<Expr> error) {
   if (error.isNull())
     return;
@@ -728,12 +900,71 @@ bool ErrorState::hasDeclaredInputError(ref<Expr> address) const {
     return false;
 }
 
+ref<Expr> ErrorState::getInputError(ref<Expr> baseError, ref<Expr> offset,
+                                    unsigned &elementSize) {
+  elementSize = 0;
+
+  // The following also performs nullity check on the result of the cast. If
+  // the type does not match, re is NULL
+  ReadExpr *re = llvm::dyn_cast<ReadExpr>(baseError);
+  if (!re)
+    return ConstantExpr::create(0, Expr::Int8);
+
+  const std::string array_prefix8 = ARRAY_PREFIX8;
+  const std::string array_prefix16 = ARRAY_PREFIX16;
+  const std::string array_prefix32 = ARRAY_PREFIX32;
+  const std::string array_prefix64 = ARRAY_PREFIX64;
+  const std::string *prefixes[] = { &array_prefix8, &array_prefix16,
+                                    &array_prefix32, &array_prefix64 };
+
+  std::string errorName = re->updates.root->name;
+  for (unsigned i = 0; i < 4; ++i) {
+    const std::string &prefix = *prefixes[i];
+    if (errorName.compare(0, prefix.size(), prefix))
+      continue;
+
+    elementSize = 1 << i;
+    errorName.erase(0, prefix.size());
+    if (!UniformInputError) {
+      if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
+        std::ostringstream so;
+        uint64_t array_index = ce->getZExtValue();
+        so << array_index / elementSize;
+        errorName += "__index__" + so.str();
+        offset = Expr::createPointer(0);
+      }
+    } else {
+      offset = Expr::createPointer(0);
+    }
+    const Array *newErrorArray =
+        errorArrayCache->CreateArray(errorName, Expr::Int8);
+    UpdateList ul(newErrorArray, 0);
+    return ReadExpr::create(ul, offset);
+  }
+  return baseError;
+}
+
 std::pair<ref<Expr>, ref<Expr> >
 ErrorState::executeLoad(llvm::Instruction *inst, ref<Expr> base,
                         ref<Expr> address, ref<Expr> offset) {
   ref<Expr> nullExpr;
   ref<Expr> error = ConstantExpr::create(0, Expr::Int8);
 
+  // Objects written at symbolic offsets are read from their shadow error
+  // memory, which also covers their concrete stores.
+  if (ConstantExpr *cpBase = llvm::dyn_cast<ConstantExpr>(base)) {
+    std::map<uintptr_t, UpdateList>::const_iterator it =
+        shadowError.find(cpBase->getZExtValue());
+    if (it != shadowError.end()) {
+      error = ReadExpr::create(it->second,
+                               ZExtExpr::create(offset, Expr::Int32));
+      // The value with error of a concrete store is kept until a symbolic
+      // store may overwrite it
+      return std::pair<ref<Expr>, ref<Expr> >(
+          error, retrieveStoredError(address).second);
+    }
+  }
+
   if (hasStoredError(address)) {
     return retrieveStoredError(address);
   }
@@ -750,88 +981,8 @@ ErrorState::executeLoad(llvm::Instruction *inst, ref<Expr> base,
     return std::pair<ref<Expr>, ref<Expr> >(error, nullExpr);
   }
 
-  // The following also performs nullity check on the result of the cast. If
-  // the type does not match, re is NULL
-  if (ReadExpr *re = llvm::dyn_cast<ReadExpr>(baseError)) {
-      std::string errorName = re->updates.root->name;
-
-      const std::string array_prefix8 = ARRAY_PREFIX8;
-      const std::string array_prefix16 = ARRAY_PREFIX16;
-      const std::string array_prefix32 = ARRAY_PREFIX32;
-      const std::string array_prefix64 = ARRAY_PREFIX64;
-
-      if (!errorName.compare(0, array_prefix8.size(), array_prefix8)) {
-        errorName.erase(0, 8);
-        if (!UniformInputError) {
-          if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
-            std::ostringstream so;
-            uint64_t array_index = ce->getZExtValue();
-            so << array_index;
-            errorName += "__index__" + so.str();
-            offset = Expr::createPointer(0);
-          }
-        } else {
-          offset = Expr::createPointer(0);
-        }
-        const Array *newErrorArray =
-            errorArrayCache->CreateArray(errorName, Expr::Int8);
-        UpdateList ul(newErrorArray, 0);
-        error = ReadExpr::create(ul, offset);
-      } else if (!errorName.compare(0, array_prefix16.size(), array_prefix16)) {
-        errorName.erase(0, 9);
-        if (!UniformInputError) {
-          if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
-            std::ostringstream so;
-            uint64_t array_index = ce->getZExtValue();
-            so << array_index / 2;
-            errorName += "__index__" + so.str();
-            offset = Expr::createPointer(0);
-          }
-        } else {
-          offset = Expr::createPointer(0);
-        }
-        const Array *newErrorArray =
-            errorArrayCache->CreateArray(errorName, Expr::Int8);
-        UpdateList ul(newErrorArray, 0);
-        error = ReadExpr::create(ul, offset);
-      } else if (!errorName.compare(0, array_prefix32.size(), array_prefix32)) {
-        errorName.erase(0, 9);
-        if (!UniformInputError) {
-          if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
-            std::ostringstream so;
-            uint64_t array_index = ce->getZExtValue();
-            so << array_index / 4;
-            errorName += "__index__" + so.str();
-            offset = Expr::createPointer(0);
-          }
-        } else {
-          offset = Expr::createPointer(0);
-        }
-        const Array *newErrorArray =
-            errorArrayCache->CreateArray(errorName, Expr::Int8);
-        UpdateList ul(newErrorArray, 0);
-        error = ReadExpr::create(ul, offset);
-      } else if (!errorName.compare(0, array_prefix64.size(), array_prefix64)) {
-        errorName.erase(0, 9);
-        if (!UniformInputError) {
-          if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(offset)) {
-            std::ostringstream so;
-            uint64_t array_index = ce->getZExtValue();
-            so << array_index / 8;
-            errorName += "__index__" + so.str();
-            offset = Expr::createPointer(0);
-          }
-        } else {
-          offset = Expr::createPointer(0);
-        }
-        const Array *newErrorArray =
-            errorArrayCache->CreateArray(errorName, Expr::Int8);
-        UpdateList ul(newErrorArray, 0);
-        error = ReadExpr::create(ul, offset);
-      } else {
-        error = baseError;
-      }
-  }
+  unsigned elementSize;
+  error = getInputError(baseError, offset, elementSize);
   registerInputError(error);
 
   if (ConstantExpr *cp = llvm::dyn_cast<ConstantExpr>(address)) {
@@ -903,6 +1054,15 @@ void ErrorState::print(llvm::raw_ostream &os) const {
     os << "\n";
   }
 
+  os << "Shadow Store:\n";
+  for (std::map<uintptr_t, UpdateList>::const_iterator
+           it = shadowError.begin(),
+           ie = shadowError.end();
+       it != ie; ++it) {
+    os << it->first << ": " << it->second.root->name << " with "
+       << it->second.getSize() << " updates\n";
+  }
+
   os << "Output String: ";
   if (outputString.empty())
     os << "(empty)";
@@ -27,6 +27,24 @@ class Executor;
 
 class ErrorState {
 public:
+  /// \brief A klee_bound_error call whose bound computation is deferred to
+  /// the end of the path
+  struct DeferredErrorBound {
+    /// \brief The error bound constraints of the call, without the path
+    /// condition
+    std::vector<ref<Expr> > constraints;
+
+    /// \brief The path condition at the call
+    ConstraintManager pathConstraints;
+
+    /// \brief The input errors whose bounds are to be computed
+    std::vector<ref<Expr> > inputErrors;
+
+    /// \brief The position in the output string where the computed bounds
+    /// are reported
+    size_t outputPosition;
+  };
+
   unsigned refCount;
 
 private:
@@ -43,10 +61,44 @@ private:
 
   std::map<uintptr_t, std::pair<ref<Expr>, ref<Expr> > > storedError;
 
+  /// \brief Shadow error memory of objects written at symbolic offsets, keyed
+  /// by the base address of the object. The errors are indexed by their
+  /// offset within the object, and the initial contents are zero.
+  std::map<uintptr_t, UpdateList> shadowError;
+
+  /// \brief Counter used to name shadow error arrays
+  unsigned shadowErrorCount;
+
+  /// \brief Create the shadow error memory of the object at the given base
+  /// address, seeded with the errors of a declared input and the errors
+  /// stored at concrete addresses within the object.
+  UpdateList &getShadowError(uint64_t base, unsigned size);
+
+  /// \brief Create an array of unknown errors, standing for the shadow error
+  /// memory of an object with too many updates to track.
+  const Array *createUnspecifiedShadowError(uint64_t base, unsigned size);
+
+  /// \brief Record the error written at the given offset in the shadow error
+  /// memory \arg ul of the object at the given base address. Updates at the
+  /// same constant offset are replaced, and the errors become unspecified
+  /// once the updates reach -max-shadow-error-updates.
+  void updateShadowError(uint64_t base, UpdateList &ul, ref<Expr> offset,
+                         ref<Expr> error);
+
+  /// \brief Error of the input read at the given offset within an object
+  /// declared with error \arg baseError. Returns in \arg elementSize the size
+  /// of the elements with an error each, or 0 if the object has one error.
+  ref<Expr> getInputError(ref<Expr> baseError, ref<Expr> offset,
+                          unsigned &elementSize);
+
   std::map<std::string, std::pair<std::string, ref<Expr> > > errorExpressions;
 
   std::vector<ref<Expr> > inputErrorList;
 
+  /// \brief Error bound computations deferred to the end of the path, in the
+  /// order of the klee_bound_error calls
+  std::vector<DeferredErrorBound> deferredErrorBounds;
+
   std::map<std::string, std::vector<Cell> > mathCallArgs;
 
   std::vector<std::pair<unsigned, std::string> > memcpyStoreInfo;
@@ -56,14 +108,18 @@ private:
 
 public:
   ErrorState(ArrayCache *arrayCache)
-      : refCount(0), errorArrayCache(arrayCache), mathVarCount(0) {}
+      : refCount(0), errorArrayCache(arrayCache), shadowErrorCount(0),
+        mathVarCount(0) {}
 
   ErrorState(ErrorState &errorState)
       : refCount(0), errorArrayCache(errorState.errorArrayCache) {
     declaredInputError = errorState.declaredInputError;
     storedError = errorState.storedError;
+    shadowError = errorState.shadowError;
+    shadowErrorCount = errorState.shadowErrorCount;
     errorExpressions = errorState.errorExpressions;
     inputErrorList = errorState.inputErrorList;
+    deferredErrorBounds = errorState.deferredErrorBounds;
     outputString = errorState.outputString;
     mathCallArgs = errorState.mathCallArgs;
     mathVarCount = errorState.mathVarCount;
@@ -79,6 +135,22 @@ public:
                                      double bound, std::string name,
                                      std::vector<ref<Expr> > &_inputErrorList);
 
+  /// \brief Record the error bound constraints of the last klee_bound_error
+  /// call, whose bounds are to be computed at the end of the path
+  void deferErrorBound(const ConstraintManager &constraints,
+                       const ConstraintManager &pathConstraints,
+                       const std::vector<ref<Expr> > &inputErrors);
+
+  std::vector<DeferredErrorBound> &getDeferredErrorBounds() {
+    return deferredErrorBounds;
+  }
+
+  /// \brief Report the bounds computed for the deferred klee_bound_error
+  /// calls at their positions in the output string. The bounds are given per
+  /// call, in the order of getDeferredErrorBounds().
+  void outputDeferredErrorBounds(
+      const std::vector<std::vector<std::pair<int, double> > > &bounds);
+
   std::pair<ref<Expr>, ref<Expr> > propagateError(Executor *executor,
                                                   llvm::Instruction *instr,
                                                   ref<Expr> result,
@@ -92,8 +164,19 @@ public:
                           ref<Expr> error, ref<Expr> valueWithError,
                           llvm::Instruction *inst);
 
+  /// \brief Store the error of a value written at a symbolic offset within
+  /// the object of the given base address and size. Instead of forking for
+  /// each possible address, the error is recorded as an update of the
+  /// object's shadow error memory.
+  void executeStoreSymbolic(ref<Expr> base, unsigned size, ref<Expr> offset,
+                            ref<Expr> error);
+
   void declareInputError(ref<Expr> address, ref<Expr> error);
 
+  /// \brief Drop the shadow error memory of a freed object, so that an
+  /// object allocated later at the same address starts without one.
+  void freeObject(uint64_t base);
+
   std::pair<ref<Expr>, ref<Expr> > retrieveStoredError(ref<Expr> address) const;
 
   ref<Expr> retrieveDeclaredInputError(ref<Expr> address) const;
@@ -108,6 +108,8 @@ ExecutionState::ExecutionState(const ExecutionState& state):
 
     addressSpace(state.addressSpace),
     constraints(state.constraints),
+    deferredConstraints(state.deferredConstraints),
+    deferredCondition(state.deferredCondition),
 
     queryCost(state.queryCost),
     weight(state.weight),
@@ -129,6 +131,15 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     symbolics[i].first->refCount++;
 }
 
+void ExecutionState::deferBranchCheck(ref<Expr> condition) {
+  if (deferredCondition.isNull()) {
+    deferredConstraints.assign(constraints.begin(), constraints.end());
+    deferredCondition = condition;
+  } else {
+    deferredCondition = AndExpr::create(deferredCondition, condition);
+  }
+}
+
 ExecutionState *ExecutionState::branch() {
   depth++;
 
@@ -150,8 +161,11 @@ void ExecutionState::pushFrame(KInstIterator caller, KFunction *kf) {
 void ExecutionState::popFrame() {
   StackFrame &sf = stack.back();
   for (std::vector<const MemoryObject*>::iterator it = sf.allocas.begin(), 
-         ie = sf.allocas.end(); it != ie; ++it)
+         ie = sf.allocas.end(); it != ie; ++it) {
+    if (symbolicError)
+      symbolicError->freeObject((*it)->address);
     addressSpace.unbindObject(*it);
+  }
   stack.pop_back();
 }
 
@@ -315,13 +329,13 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      const ref<Expr> &av = af.locals[i].getValue();
+      const ref<Expr> &bv = bf.locals[i].getValue();
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        af.locals[i].setValue(SelectExpr::create(inA, av, bv));
       }
     }
   }
@@ -374,7 +388,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].getValue();
       if (value.get() && isa<ConstantExpr>(value))
         out << "=" << value;
     }
@@ -34,6 +34,7 @@
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
 #include "klee/util/ExprUtil.h"
+#include "klee/util/ExprVisitor.h"
 #include "klee/util/GetElementPtrTypeIterator.h"
 #include "klee/Config/Version.h"
 #include "klee/Internal/ADT/KTest.h"
@@ -42,6 +43,7 @@
 #include "klee/Internal/Module/InstructionInfoTable.h"
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
+#include "klee/Internal/Module/TripCounter.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Internal/Support/FloatEvaluation.h"
 #include "klee/Internal/Support/ModuleUtil.h"
@@ -309,6 +311,21 @@ namespace {
   MaxForks("max-forks",
            cl::desc("Only fork this many times (default=-1 (off))"),
            cl::init(~0u));
+
+  cl::opt<bool>
+  DeferredBranchCheck("deferred-branch-check",
+                      cl::desc("Fork at branches without checking their "
+                               "feasibility, and check the feasibility of "
+                               "the forked states when they are selected, "
+                               "before they are executed (default=off)"),
+                      cl::init(false));
+
+  cl::opt<unsigned>
+  DeferredBranchCheckBatch("deferred-branch-check-batch",
+                           cl::desc("Number of forked states whose deferred "
+                                    "feasibility is checked together "
+                                    "(default=8)"),
+                           cl::init(8));
   
   cl::opt<unsigned>
   MaxDepth("max-depth",
@@ -324,6 +341,11 @@ namespace {
   MaxMemoryInhibit("max-memory-inhibit",
             cl::desc("Inhibit forking at memory cap (vs. random terminate) (default=on)"),
             cl::init(true));
+
+  cl::opt<bool>
+  UseRealCache("use-real-cache",
+               cl::init(true),
+               cl::desc("Use independence slicing and model caching when computing real number solutions (default=on)"));
 }
 
 
@@ -351,13 +373,15 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
     : Interpreter(opts), kmodule(0), interpreterHandler(ih), searcher(0),
       externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0),
-      processTree(0), replayKTest(0), replayPath(0), usingSeeds(0),
+      processTree(0), replayKTest(0), replayPath(0), replayPathIsPrefix(false),
+      usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
       ivcEnabled(false),
       coreSolverTimeout(MaxCoreSolverTime != 0 && MaxInstructionTime != 0
                             ? std::min(MaxCoreSolverTime, MaxInstructionTime)
                             : std::max(MaxCoreSolverTime, MaxInstructionTime)),
-      debugInstFile(0), debugLogBuffer(debugBufferString) {
+      zeroError(ConstantExpr::create(0, Expr::Int8)), debugInstFile(0),
+      debugLogBuffer(debugBufferString) {
 
   if (coreSolverTimeout) UseForkedCoreSolver = true;
   Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
@@ -370,11 +394,18 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
       interpreterHandler->getOutputFilename(ALL_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(SOLVER_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(ALL_QUERIES_KQUERY_FILE_NAME),
-      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME));
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME),
+      interpreterHandler->getOutputFilename(ALL_QUERIES_BINARY_FILE_NAME),
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_BINARY_FILE_NAME));
 
   this->solver = new TimingSolver(solver, EqualitySubstitution);
 #ifdef ENABLE_Z3
   this->errorSolver = createCoreErrorSolver();
+  // The caching solver takes ownership of errorSolver, which stays available
+  // for the optimization queries the cache does not handle.
+  this->realSolver = errorSolver;
+  if (errorSolver && ComputeRealSolution && UseRealCache)
+    this->realSolver = createRealCachingSolver(errorSolver);
 #endif
   memory = new MemoryManager(&arrayCache);
 
@@ -449,7 +480,7 @@ Executor::~Executor() {
     delete statsTracker;
   delete solver;
 #ifdef ENABLE_Z3
-  delete errorSolver;
+  delete realSolver;
 #endif
   delete kmodule;
   while(!timers.empty()) {
@@ -705,6 +736,33 @@ void Executor::branch(ExecutionState &state,
   unsigned N = conditions.size();
   assert(N);
 
+  // Explore normally once the prefix has been followed
+  if (replayPath && replayPathIsPrefix &&
+      replayPosition == replayPath->size())
+    replayPath = 0;
+
+  if (replayPath) {
+    unsigned choice = replayChoice(N);
+    bool feasible = choice < N;
+    if (feasible && replayPathIsPrefix) {
+      // A prefix comes from another process; check its decisions rather
+      // than trust them
+      bool success = solver->mayBeTrue(state, conditions[choice], feasible);
+      feasible = success && feasible;
+    }
+    if (!feasible) {
+      assert(replayPathIsPrefix && "hit invalid branch in replay path mode");
+      result.assign(N, NULL);
+      removeState(state);
+      return;
+    }
+    for (unsigned i=0; i<N; ++i)
+      result.push_back(i == choice ? &state : NULL);
+    recordChoice(state, choice, N);
+    addConstraint(state, conditions[choice]);
+    return;
+  }
+
   if (MaxForks!=~0u && stats::forks >= MaxForks) {
     unsigned next = theRNG.getInt32() % N;
     for (unsigned i=0; i<N; ++i) {
@@ -729,9 +787,17 @@ void Executor::branch(ExecutionState &state,
         processTree->split(es->ptreeNode, ns, es);
       ns->ptreeNode = res.first;
       es->ptreeNode = res.second;
+      if (pathWriter)
+        ns->pathOS = pathWriter->open(es->pathOS);
+      if (symPathWriter)
+        ns->symPathOS = symPathWriter->open(es->symPathOS);
     }
   }
 
+  for (unsigned i=0; i<N; ++i)
+    if (result[i])
+      recordChoice(*result[i], i, N);
+
   // If necessary redistribute seeds to match conditions, killing
   // states if necessary due to OnlyReplaySeeds (inefficient but
   // simple).
@@ -792,6 +858,13 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
   std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
     seedMap.find(&current);
   bool isSeeding = it != seedMap.end();
+  // Whether the decision is part of the path of the state
+  bool isRecorded = !isInternal || interpreterOpts.CompletePaths;
+
+  // Explore normally once the prefix has been followed
+  if (replayPath && replayPathIsPrefix &&
+      replayPosition == replayPath->size())
+    replayPath = 0;
 
   if (!isSeeding && !isa<ConstantExpr>(condition) && 
       (MaxStaticForkPct!=1. || MaxStaticSolvePct != 1. ||
@@ -820,10 +893,19 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
     }
   }
 
+  bool forkInhibited = (MaxMemoryInhibit && atMemoryLimit) ||
+                       current.forkDisabled || inhibitForking ||
+                       (MaxForks != ~0u && stats::forks >= MaxForks);
+  // The feasibility of both branches is checked when they are selected,
+  // see checkDeferredBranches()
+  bool deferCheck = isBranching && DeferredBranchCheck && !isSeeding &&
+                    !replayPath && !forkInhibited &&
+                    !isa<ConstantExpr>(condition);
+
   double timeout = coreSolverTimeout;
   if (isSeeding)
     timeout *= it->second.size();
-  if (isBranching && NoBranchCheck) {
+  if ((isBranching && NoBranchCheck) || deferCheck) {
     res = Solver::Unknown;
   } else {
     solver->setTimeout(timeout);
@@ -837,16 +919,18 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
   }
 
   if (!isSeeding) {
-    if (replayPath && !isInternal) {
+    if (replayPath && isRecorded) {
       assert(replayPosition<replayPath->size() &&
              "ran out of branches in replay path mode");
       bool branch = (*replayPath)[replayPosition++];
       
-      if (res==Solver::True) {
-        assert(branch && "hit invalid branch in replay path mode");
-      } else if (res==Solver::False) {
-        assert(!branch && "hit invalid branch in replay path mode");
-      } else {
+      if ((res==Solver::True && !branch) || (res==Solver::False && branch)) {
+        // A prefix may lead to a state found infeasible after it was
+        // recorded, whose feasibility check was deferred
+        assert(replayPathIsPrefix && "hit invalid branch in replay path mode");
+        removeState(current);
+        return StatePair(0, 0);
+      } else if (res==Solver::Unknown) {
         // add constraints
         if(branch) {
           res = Solver::True;
@@ -859,10 +943,7 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
     } else if (res==Solver::Unknown) {
       assert(!replayKTest && "in replay mode, only one branch can be true.");
       
-      if ((MaxMemoryInhibit && atMemoryLimit) || 
-          current.forkDisabled ||
-          inhibitForking || 
-          (MaxForks!=~0u && stats::forks >= MaxForks)) {
+      if (forkInhibited) {
 
 	if (MaxMemoryInhibit && atMemoryLimit)
 	  klee_warning_once(0, "skipping fork (memory cap exceeded)");
@@ -925,7 +1006,7 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
   // hint to just use the single constraint instead of all the binary
   // search ones. If that makes sense.
   if (res==Solver::True) {
-    if (!isInternal) {
+    if (isRecorded) {
       if (pathWriter) {
         current.pathOS << "1";
       }
@@ -933,7 +1014,7 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
 
     return StatePair(&current, 0);
   } else if (res==Solver::False) {
-    if (!isInternal) {
+    if (isRecorded) {
       if (pathWriter) {
         current.pathOS << "0";
       }
@@ -993,19 +1074,26 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
       // Need to update the pathOS.id field of falseState, otherwise the same id
       // is used for both falseState and trueState.
       falseState->pathOS = pathWriter->open(current.pathOS);
-      if (!isInternal) {
+      if (isRecorded) {
         trueState->pathOS << "1";
         falseState->pathOS << "0";
       }
     }
     if (symPathWriter) {
       falseState->symPathOS = symPathWriter->open(current.symPathOS);
-      if (!isInternal) {
+      if (isRecorded) {
         trueState->symPathOS << "1";
         falseState->symPathOS << "0";
       }
     }
 
+    if (deferCheck) {
+      trueState->deferBranchCheck(condition);
+      falseState->deferBranchCheck(Expr::createIsZero(condition));
+      uncheckedStates.insert(trueState);
+      uncheckedStates.insert(falseState);
+    }
+
     addConstraint(*trueState, condition);
     addConstraint(*falseState, Expr::createIsZero(condition));
 
@@ -1133,14 +1221,14 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
   if (vnumber < 0) {
     unsigned index = -vnumber - 2;
     Cell &ret = kmodule->constantTable[index];
-    if (state.symbolicError->checkStoredError(ret.value)) {
+    if (state.symbolicError->checkStoredError(ret.getValue())) {
       std::pair<ref<Expr>, ref<Expr> > pair =
-          state.symbolicError->retrieveStoredError(ret.value);
+          state.symbolicError->retrieveStoredError(ret.getValue());
       ret.error = pair.first;
       ret.valueWithError = pair.second;
     } else {
       ref<Expr> nullExpr;
-      ret.error = ConstantExpr::create(0, Expr::Int8);
+      ret.error = zeroError;
       ret.valueWithError = nullExpr;
     }
     return ret;
@@ -1155,21 +1243,129 @@ void Executor::bindLocal(KInstruction *target, ExecutionState &state,
                          ref<Expr> value,
                          std::pair<ref<Expr>, ref<Expr> > error) {
   Cell &c = getDestCell(state, target);
-  c.value = value;
+  c.setValue(value);
   c.error = error.first;
   c.valueWithError = error.second;
 }
 
+/// Whether the operand is a concrete value without error, so that the
+/// result of an integer operation on it has no error either.
+static bool isConcreteOperand(const Cell &c) {
+  return c.isConcrete() && !c.error.isNull() && c.error->isZero();
+}
+
+static int64_t signExtend(uint64_t v, Expr::Width w) {
+  return (int64_t)(v << (64 - w)) >> (64 - w);
+}
+
+bool Executor::executeConcreteInstruction(ExecutionState &state,
+                                          KInstruction *ki) {
+  Instruction *i = ki->inst;
+
+  // The error propagation also tracks loop iterations, starting at this
+  // instruction.
+  if (LoopBreaking && TripCounter::instance &&
+      TripCounter::instance->isRealFirstInstruction(i))
+    return false;
+
+  const Cell &lCell = eval(ki, 0, state);
+  if (!isConcreteOperand(lCell))
+    return false;
+  uint64_t left = lCell.getConcreteValue();
+  Expr::Width width = lCell.getConcreteWidth();
+
+  if (CastInst *ci = dyn_cast<CastInst>(i)) {
+    Expr::Width to = getWidthForLLVMType(ci->getType());
+    if (to > Expr::Int64)
+      return false;
+    if (ci->getOpcode() == Instruction::SExt)
+      left = signExtend(left, width);
+    Cell &c = getDestCell(state, ki);
+    c.setConcreteValue(left, to);
+    c.error = zeroError;
+    c.valueWithError = ref<Expr>();
+    return true;
+  }
+
+  const Cell &rCell = eval(ki, 1, state);
+  if (!isConcreteOperand(rCell))
+    return false;
+  uint64_t right = rCell.getConcreteValue();
+  uint64_t result;
+
+  switch (i->getOpcode()) {
+  case Instruction::Add: result = left + right; break;
+  case Instruction::Sub: result = left - right; break;
+  case Instruction::Mul: result = left * right; break;
+  case Instruction::And: result = left & right; break;
+  case Instruction::Or: result = left | right; break;
+  case Instruction::Xor: result = left ^ right; break;
+  // Overshifts are left to the expression builder
+  case Instruction::Shl:
+    if (right >= width)
+      return false;
+    result = left << right;
+    break;
+  case Instruction::LShr:
+    if (right >= width)
+      return false;
+    result = left >> right;
+    break;
+  case Instruction::AShr:
+    if (right >= width)
+      return false;
+    result = signExtend(left, width) >> right;
+    break;
+  case Instruction::ICmp: {
+    bool res;
+    switch (cast<ICmpInst>(i)->getPredicate()) {
+    case ICmpInst::ICMP_EQ: res = left == right; break;
+    case ICmpInst::ICMP_NE: res = left != right; break;
+    case ICmpInst::ICMP_UGT: res = left > right; break;
+    case ICmpInst::ICMP_UGE: res = left >= right; break;
+    case ICmpInst::ICMP_ULT: res = left < right; break;
+    case ICmpInst::ICMP_ULE: res = left <= right; break;
+    case ICmpInst::ICMP_SGT:
+      res = signExtend(left, width) > signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SGE:
+      res = signExtend(left, width) >= signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SLT:
+      res = signExtend(left, width) < signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SLE:
+      res = signExtend(left, width) <= signExtend(right, width);
+      break;
+    default:
+      return false;
+    }
+    // Without errors, the condition with error is the condition itself
+    ref<Expr> cond = ConstantExpr::alloc(res, Expr::Bool);
+    bindLocal(ki, state, cond, std::make_pair(zeroError, cond));
+    return true;
+  }
+  default:
+    return false;
+  }
+
+  Cell &c = getDestCell(state, ki);
+  c.setConcreteValue(result, width);
+  c.error = zeroError;
+  c.valueWithError = ref<Expr>();
+  return true;
+}
+
 void Executor::bindArgument(KFunction *kf, unsigned index, 
                             ExecutionState &state, ref<Expr> value) {
-  getArgumentCell(state, kf, index).value = value;
+  getArgumentCell(state, kf, index).setValue(value);
 }
 
 void Executor::bindArgument(KFunction *kf, unsigned index,
                             ExecutionState &state, ref<Expr> value,
                             ref<Expr> error) {
   Cell &c = getArgumentCell(state, kf, index);
-  c.value = value;
+  c.setValue(value);
   c.error = error;
 }
 
@@ -1363,22 +1559,22 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
             state, true, arguments[0], ConstantExpr::create(48, 32),
             ConstantExpr::create(0, Expr::Int8), nullExpr, 0); // gp_offset
         Cell c1;
-        c1.value =
-            AddExpr::create(arguments[0].value, ConstantExpr::create(4, 64));
+        c1.setValue(AddExpr::create(arguments[0].getValue(),
+                                     ConstantExpr::create(4, 64)));
         c1.error = arguments[0].error;
         executeMemoryOperation(state, true, c1, ConstantExpr::create(304, 32),
                                ConstantExpr::create(0, Expr::Int8), nullExpr,
                                0); // fp_offset
         Cell c2;
-        c2.value =
-            AddExpr::create(arguments[0].value, ConstantExpr::create(8, 64));
+        c2.setValue(AddExpr::create(arguments[0].getValue(),
+                                     ConstantExpr::create(8, 64)));
         c2.error = arguments[0].error;
         executeMemoryOperation(state, true, c2, sf.varargs->getBaseExpr(),
                                ConstantExpr::create(0, Expr::Int8), nullExpr,
                                0); // overflow_arg_area
         Cell c3;
-        c3.value =
-            AddExpr::create(arguments[0].value, ConstantExpr::create(16, 64));
+        c3.setValue(AddExpr::create(arguments[0].getValue(),
+                                     ConstantExpr::create(16, 64)));
         c3.error = arguments[0].error;
         executeMemoryOperation(state, true, c3, ConstantExpr::create(0, 64),
                                ConstantExpr::create(0, Expr::Int8), nullExpr,
@@ -1446,9 +1642,10 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
         // FIXME: This is really specific to the architecture, not the pointer
         // size. This happens to work for x86-32 and x86-64, however.
         if (WordSize == Expr::Int32) {
-          size += Expr::getMinBytesForWidth(arguments[i].value->getWidth());
+          size +=
+              Expr::getMinBytesForWidth(arguments[i].getValue()->getWidth());
         } else {
-          Expr::Width argWidth = arguments[i].value->getWidth();
+          Expr::Width argWidth = arguments[i].getValue()->getWidth();
           // AMD64-ABI 3.5.7p5: Step 7. Align l->overflow_arg_area upwards to a
           // 16 byte boundary if alignment needed by type exceeds 8 byte
           // boundary.
@@ -1484,16 +1681,17 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
           // FIXME: This is really specific to the architecture, not the pointer
           // size. This happens to work for x86-32 and x86-64, however.
           if (WordSize == Expr::Int32) {
-            os->write(offset, arguments[i].value);
-            offset += Expr::getMinBytesForWidth(arguments[i].value->getWidth());
+            os->write(offset, arguments[i].getValue());
+            offset +=
+                Expr::getMinBytesForWidth(arguments[i].getValue()->getWidth());
           } else {
             assert(WordSize == Expr::Int64 && "Unknown word size!");
 
-            Expr::Width argWidth = arguments[i].value->getWidth();
+            Expr::Width argWidth = arguments[i].getValue()->getWidth();
             if (argWidth > Expr::Int64) {
               offset = llvm::RoundUpToAlignment(offset, 16);
             }
-            os->write(offset, arguments[i].value);
+            os->write(offset, arguments[i].getValue());
             offset += llvm::RoundUpToAlignment(argWidth, WordSize) / 8;
           }
         }
@@ -1502,7 +1700,7 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
 
     unsigned numFormals = f->arg_size();
     for (unsigned i = 0; i < numFormals; ++i)
-      bindArgument(kf, i, state, arguments[i].value, arguments[i].error);
+      bindArgument(kf, i, state, arguments[i].getValue(), arguments[i].error);
   }
 }
 
@@ -1607,7 +1805,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     if (!isVoidReturn) {
       Cell c = eval(ki, 0, state);
-      result = c.value;
+      result = c.getValue();
       error = c.error;
       valueWithError = c.valueWithError;
     }
@@ -1699,7 +1897,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       // FIXME: Find a way that we don't have this hidden dependency.
       assert(bi->getCondition() == bi->getOperand(0) &&
              "Wrong operand index!");
-      ref<Expr> cond = eval(ki, 0, state).value;
+      ref<Expr> cond = eval(ki, 0, state).getValue();
       ref<Expr> error = eval(ki, 0, state).error;
       ref<Expr> condWithError = eval(ki, 0, state).valueWithError;
       Executor::StatePair branches =
@@ -1721,7 +1919,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::Switch: {
     SwitchInst *si = cast<SwitchInst>(i);
-    ref<Expr> cond = eval(ki, 0, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
     BasicBlock *bb = si->getParent();
 
     cond = toUnique(state, cond);
@@ -1898,7 +2096,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         for (std::vector<Cell>::iterator ai = arguments.begin(),
                                          ie = arguments.end();
              ai != ie; ++ai) {
-          Expr::Width to, from = ai->value->getWidth();
+          Expr::Width to, from = ai->getValue()->getWidth();
 
           if (i<fType->getNumParams()) {
             to = getWidthForLLVMType(fType->getParamType(i));
@@ -1913,9 +2111,11 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 	      bool isSExt = cs.paramHasAttr(i+1, llvm::Attribute::SExt);
 #endif
               if (isSExt) {
-                arguments[i].value = SExtExpr::create(arguments[i].value, to);
+                arguments[i].setValue(
+                    SExtExpr::create(arguments[i].getValue(), to));
               } else {
-                arguments[i].value = ZExtExpr::create(arguments[i].value, to);
+                arguments[i].setValue(
+                    ZExtExpr::create(arguments[i].getValue(), to));
               }
             }
           }
@@ -1925,7 +2125,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
       executeCall(state, ki, f, arguments);
     } else {
-      ref<Expr> v = eval(ki, 0, state).value;
+      ref<Expr> v = eval(ki, 0, state).getValue();
 
       ExecutionState *free = &state;
       bool hasInvalid = false, first = true;
@@ -1974,7 +2174,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 #else
     Cell c = eval(ki, state.incomingBBIndex * 2, state);
 #endif
-    ref<Expr> result = c.value;
+    ref<Expr> result = c.getValue();
     ref<Expr> error = c.error;
     // We use the arguments list as a carrier for the error amount
     std::vector<Cell> errorsList;
@@ -1987,12 +2187,12 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     // Special instructions
   case Instruction::Select: {
-    ref<Expr> cond = eval(ki, 0, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
     Cell c1 = eval(ki, 1, state);
-    ref<Expr> tExpr = c1.value;
+    ref<Expr> tExpr = c1.getValue();
     ref<Expr> terror = c1.error;
     Cell c2 = eval(ki, 2, state);
-    ref<Expr> fExpr = c2.value;
+    ref<Expr> fExpr = c2.getValue();
     ref<Expr> ferror = c2.error;
     ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
     ref<Expr> error = SelectExpr::create(cond, terror, ferror);
@@ -2009,11 +2209,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Arithmetic / logical
 
   case Instruction::Add: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = AddExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2026,11 +2229,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Sub: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = SubExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2043,11 +2249,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
  
   case Instruction::Mul: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = MulExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2063,8 +2272,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = UDivExpr::create(left, right);
 
     /* When float code is being executed as int, we want to avoid possible
@@ -2101,8 +2310,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
 
     if (NoBranchCheck && right->isZero())
       return terminateStateOnExecError(state,
@@ -2142,8 +2351,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = URemExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2159,8 +2368,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = SRemExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2173,11 +2382,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::And: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = AndExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2190,11 +2402,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Or: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = OrExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2207,11 +2422,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Xor: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = XorExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2224,11 +2442,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Shl: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = ShlExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2241,11 +2462,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::LShr: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = LShrExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2258,11 +2482,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::AShr: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     const Cell &lCell = eval(ki, 0, state);
     const Cell &rCell = eval(ki, 1, state);
 
-    ref<Expr> left = lCell.value;
-    ref<Expr> right = rCell.value;
+    ref<Expr> left = lCell.getValue();
+    ref<Expr> right = rCell.getValue();
     ref<Expr> result = AShrExpr::create(left, right);
 
     std::vector<Cell> arguments;
@@ -2277,6 +2504,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Compare
 
   case Instruction::ICmp: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     CmpInst *ci = cast<CmpInst>(i);
     ICmpInst *ii = cast<ICmpInst>(ci);
 
@@ -2285,8 +2515,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = EqExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2302,8 +2532,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = NeExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2319,8 +2549,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = UgtExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2336,8 +2566,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = UgeExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2353,8 +2583,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = UltExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2370,8 +2600,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = UleExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2387,8 +2617,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SgtExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2404,8 +2634,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SgeExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2421,8 +2651,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SltExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2438,8 +2668,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &lCell = eval(ki, 0, state);
       const Cell &rCell = eval(ki, 1, state);
 
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SleExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2464,7 +2694,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       kmodule->targetData->getTypeStoreSize(ai->getAllocatedType());
     ref<Expr> size = Expr::createPointer(elementSize);
     if (ai->isArrayAllocation()) {
-      ref<Expr> count = eval(ki, 0, state).value;
+      ref<Expr> count = eval(ki, 0, state).getValue();
       count = Expr::createZExtToPointerWidth(count);
       size = MulExpr::create(size, count);
     }
@@ -2482,7 +2712,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::Store: {
     Cell base = eval(ki, 1, state);
     Cell valueCell = eval(ki, 0, state);
-    ref<Expr> value = valueCell.value;
+    ref<Expr> value = valueCell.getValue();
     ref<Expr> error = valueCell.error;
     ref<Expr> valueWithError = valueCell.valueWithError;
 
@@ -2492,14 +2722,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
   case Instruction::GetElementPtr: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
-    ref<Expr> oldBase = eval(ki, 0, state).value;
+    ref<Expr> oldBase = eval(ki, 0, state).getValue();
     ref<Expr> base = oldBase;
 
     for (std::vector< std::pair<unsigned, uint64_t> >::iterator 
            it = kgepi->indices.begin(), ie = kgepi->indices.end(); 
          it != ie; ++it) {
       uint64_t elementSize = it->second;
-      ref<Expr> index = eval(ki, it->first, state).value;
+      ref<Expr> index = eval(ki, it->first, state).getValue();
       base = AddExpr::create(base,
                              MulExpr::create(Expr::createSExtToPointerWidth(index),
                                              Expr::createPointer(elementSize)));
@@ -2510,7 +2740,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     std::vector<Cell> arguments;
     Cell oldBaseCell;
-    oldBaseCell.value = oldBase;
+    oldBaseCell.setValue(oldBase);
     oldBaseCell.error = ConstantExpr::create(0, Expr::Int8);
     arguments.push_back(oldBaseCell);
 
@@ -2521,10 +2751,13 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     // Conversion
   case Instruction::Trunc: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     CastInst *ci = cast<CastInst>(i);
     Cell c = eval(ki, 0, state);
-    ref<Expr> result =
-        ExtractExpr::create(c.value, 0, getWidthForLLVMType(ci->getType()));
+    ref<Expr> result = ExtractExpr::create(c.getValue(), 0,
+                                           getWidthForLLVMType(ci->getType()));
     std::vector<Cell> arguments;
     arguments.push_back(c);
     bindLocal(ki, state, result,
@@ -2532,10 +2765,13 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     break;
   }
   case Instruction::ZExt: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     CastInst *ci = cast<CastInst>(i);
     Cell c = eval(ki, 0, state);
     ref<Expr> result =
-        ZExtExpr::create(c.value, getWidthForLLVMType(ci->getType()));
+        ZExtExpr::create(c.getValue(), getWidthForLLVMType(ci->getType()));
     std::vector<Cell> arguments;
     arguments.push_back(c);
     bindLocal(ki, state, result,
@@ -2543,10 +2779,13 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     break;
   }
   case Instruction::SExt: {
+    if (executeConcreteInstruction(state, ki))
+      break;
+
     CastInst *ci = cast<CastInst>(i);
     Cell c = eval(ki, 0, state);
     ref<Expr> result =
-        SExtExpr::create(c.value, getWidthForLLVMType(ci->getType()));
+        SExtExpr::create(c.getValue(), getWidthForLLVMType(ci->getType()));
     std::vector<Cell> arguments;
     arguments.push_back(c);
     bindLocal(ki, state, result,
@@ -2558,7 +2797,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width pType = getWidthForLLVMType(ci->getType());
     Cell c = eval(ki, 0, state);
-    ref<Expr> arg = c.value;
+    ref<Expr> arg = c.getValue();
     ref<Expr> result = ZExtExpr::create(arg, pType);
     std::vector<Cell> arguments;
     arguments.push_back(c);
@@ -2570,7 +2809,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width iType = getWidthForLLVMType(ci->getType());
     Cell c = eval(ki, 0, state);
-    ref<Expr> arg = c.value;
+    ref<Expr> arg = c.getValue();
     ref<Expr> result = ZExtExpr::create(arg, iType);
     std::vector<Cell> arguments;
     arguments.push_back(c);
@@ -2581,7 +2820,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
   case Instruction::BitCast: {
     Cell c = eval(ki, 0, state);
-    ref<Expr> result = c.value;
+    ref<Expr> result = c.getValue();
     std::vector<Cell> arguments;
     arguments.push_back(c);
     bindLocal(ki, state, result,
@@ -2596,8 +2835,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &rCell = eval(ki, 1, state);
 
     if (PrecisionError) {
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = AddExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2607,9 +2846,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                                        this, ki, result, arguments));
     } else {
       ref<ConstantExpr> left =
-          toConstant(state, eval(ki, 0, state).value, "floating point");
+          toConstant(state, eval(ki, 0, state).getValue(), "floating point");
       ref<ConstantExpr> right =
-          toConstant(state, eval(ki, 1, state).value, "floating point");
+          toConstant(state, eval(ki, 1, state).getValue(), "floating point");
       if (!fpWidthToSemantics(left->getWidth()) ||
           !fpWidthToSemantics(right->getWidth()))
         return terminateStateOnExecError(state, "Unsupported FAdd operation");
@@ -2642,8 +2881,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &rCell = eval(ki, 1, state);
 
     if (PrecisionError) {
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SubExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2654,9 +2893,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                                        this, ki, result, arguments));
     } else {
       ref<ConstantExpr> left =
-          toConstant(state, eval(ki, 0, state).value, "floating point");
+          toConstant(state, eval(ki, 0, state).getValue(), "floating point");
       ref<ConstantExpr> right =
-          toConstant(state, eval(ki, 1, state).value, "floating point");
+          toConstant(state, eval(ki, 1, state).getValue(), "floating point");
       if (!fpWidthToSemantics(left->getWidth()) ||
           !fpWidthToSemantics(right->getWidth()))
         return terminateStateOnExecError(state, "Unsupported FSub operation");
@@ -2687,8 +2926,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &rCell = eval(ki, 1, state);
 
     if (PrecisionError) {
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
 
       if (left->getWidth() > right->getWidth())
         right = ZExtExpr::create(right, left->getWidth());
@@ -2704,9 +2943,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       bindLocal(ki, state, result, state.symbolicError->propagateError(
                                        this, ki, result, arguments));
     } else {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2736,8 +2975,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &rCell = eval(ki, 1, state);
 
     if (PrecisionError) {
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
 
       if (left->getWidth() > right->getWidth())
         right = ZExtExpr::create(right, left->getWidth());
@@ -2759,9 +2998,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       break;
     } else {
       ref<ConstantExpr> left =
-          toConstant(state, eval(ki, 0, state).value, "floating point");
+          toConstant(state, eval(ki, 0, state).getValue(), "floating point");
       ref<ConstantExpr> right =
-          toConstant(state, eval(ki, 1, state).value, "floating point");
+          toConstant(state, eval(ki, 1, state).getValue(), "floating point");
       if (!fpWidthToSemantics(left->getWidth()) ||
           !fpWidthToSemantics(right->getWidth()))
         return terminateStateOnExecError(state, "Unsupported FDiv operation");
@@ -2793,8 +3032,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     const Cell &rCell = eval(ki, 1, state);
 
     if (PrecisionError) {
-      ref<Expr> left = lCell.value;
-      ref<Expr> right = rCell.value;
+      ref<Expr> left = lCell.getValue();
+      ref<Expr> right = rCell.getValue();
       ref<Expr> result = SRemExpr::create(left, right);
 
       std::vector<Cell> arguments;
@@ -2805,9 +3044,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                                        this, ki, result, arguments));
     } else {
       ref<ConstantExpr> left =
-          toConstant(state, eval(ki, 0, state).value, "floating point");
+          toConstant(state, eval(ki, 0, state).getValue(), "floating point");
       ref<ConstantExpr> right =
-          toConstant(state, eval(ki, 1, state).value, "floating point");
+          toConstant(state, eval(ki, 1, state).getValue(), "floating point");
       if (!fpWidthToSemantics(left->getWidth()) ||
           !fpWidthToSemantics(right->getWidth()))
         return terminateStateOnExecError(state, "Unsupported FRem operation");
@@ -2837,8 +3076,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     if (PrecisionError) {
       CastInst *ci = cast<CastInst>(i);
       Cell c = eval(ki, 0, state);
-      ref<Expr> result =
-          ExtractExpr::create(c.value, 0, getWidthForLLVMType(ci->getType()));
+      ref<Expr> result = ExtractExpr::create(
+          c.getValue(), 0, getWidthForLLVMType(ci->getType()));
       std::vector<Cell> arguments;
       arguments.push_back(c);
       bindLocal(ki, state, result, state.symbolicError->propagateError(
@@ -2847,7 +3086,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       FPTruncInst *fi = cast<FPTruncInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
       Cell c = eval(ki, 0, state);
-      ref<ConstantExpr> arg = toConstant(state, c.value, "floating point");
+      ref<ConstantExpr> arg = toConstant(state, c.getValue(), "floating point");
       if (!fpWidthToSemantics(arg->getWidth()) || resultType > arg->getWidth())
         return terminateStateOnExecError(state,
                                          "Unsupported FPTrunc operation");
@@ -2865,7 +3104,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell argCell;
-      argCell.value = arg;
+      argCell.setValue(arg);
       argCell.error = c.error;
       arguments.push_back(argCell);
 
@@ -2880,7 +3119,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       CastInst *ci = cast<CastInst>(i);
       Cell c = eval(ki, 0, state);
       ref<Expr> result =
-          SExtExpr::create(c.value, getWidthForLLVMType(ci->getType()));
+          SExtExpr::create(c.getValue(), getWidthForLLVMType(ci->getType()));
       std::vector<Cell> arguments;
       arguments.push_back(c);
       bindLocal(ki, state, result, state.symbolicError->propagateError(
@@ -2889,7 +3128,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       FPExtInst *fi = cast<FPExtInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
       Cell c = eval(ki, 0, state);
-      ref<ConstantExpr> arg = toConstant(state, c.value, "floating point");
+      ref<ConstantExpr> arg = toConstant(state, c.getValue(), "floating point");
       if (!fpWidthToSemantics(arg->getWidth()) || arg->getWidth() > resultType)
         return terminateStateOnExecError(state, "Unsupported FPExt operation");
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
@@ -2905,7 +3144,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell argCell;
-      argCell.value = arg;
+      argCell.setValue(arg);
       argCell.error = c.error;
       arguments.push_back(argCell);
 
@@ -2920,7 +3159,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     if (PrecisionError) {
       // We simply assume equality
-      ref<Expr> result = c.value;
+      ref<Expr> result = c.getValue();
       std::vector<Cell> arguments;
       arguments.push_back(c);
       bindLocal(ki, state, result, state.symbolicError->propagateError(
@@ -2928,7 +3167,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     } else {
       FPToUIInst *fi = cast<FPToUIInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
-      ref<ConstantExpr> arg = toConstant(state, c.value, "floating point");
+      ref<ConstantExpr> arg = toConstant(state, c.getValue(), "floating point");
       if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
         return terminateStateOnExecError(state, "Unsupported FPToUI operation");
 
@@ -2946,7 +3185,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell argCell;
-      argCell.value = arg;
+      argCell.setValue(arg);
       argCell.error = c.error;
       arguments.push_back(argCell);
 
@@ -2961,7 +3200,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     if (PrecisionError) {
       // We simply assume equality
-      ref<Expr> result = c.value;
+      ref<Expr> result = c.getValue();
       std::vector<Cell> arguments;
       arguments.push_back(c);
       bindLocal(ki, state, result, state.symbolicError->propagateError(
@@ -2969,7 +3208,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     } else {
       FPToSIInst *fi = cast<FPToSIInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
-      ref<ConstantExpr> arg = toConstant(state, c.value, "floating point");
+      ref<ConstantExpr> arg = toConstant(state, c.getValue(), "floating point");
       if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
         return terminateStateOnExecError(state, "Unsupported FPToSI operation");
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
@@ -2987,7 +3226,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell argCell;
-      argCell.value = arg;
+      argCell.setValue(arg);
       argCell.error = c.error;
       arguments.push_back(argCell);
 
@@ -3002,7 +3241,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     if (PrecisionError) {
       // We simply assume equality
-      ref<Expr> result = c.value;
+      ref<Expr> result = c.getValue();
       std::vector<Cell> arguments;
       arguments.push_back(c);
       bindLocal(ki, state, result, state.symbolicError->propagateError(
@@ -3010,7 +3249,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     } else {
     UIToFPInst *fi = cast<UIToFPInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, c.value, "floating point");
+    ref<ConstantExpr> arg = toConstant(state, c.getValue(), "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
       return terminateStateOnExecError(state, "Unsupported UIToFP operation");
@@ -3021,7 +3260,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     std::vector<Cell> arguments;
     Cell argCell;
-    argCell.value = arg;
+    argCell.setValue(arg);
     argCell.error = c.error;
     arguments.push_back(argCell);
 
@@ -3037,7 +3276,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     if (PrecisionError) {
       SIToFPInst *fi = cast<SIToFPInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
-      ref<Expr> result = c.value;
+      ref<Expr> result = c.getValue();
       Expr::Width resultInputType = result->getWidth();
       if (resultInputType < resultType) {
         result = SExtExpr::create(result, resultType);
@@ -3052,7 +3291,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       SIToFPInst *fi = cast<SIToFPInst>(i);
       Expr::Width resultType = getWidthForLLVMType(fi->getType());
       ref<ConstantExpr> arg =
-          toConstant(state, eval(ki, 0, state).value, "floating point");
+          toConstant(state, eval(ki, 0, state).getValue(), "floating point");
       const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
       if (!semantics)
         return terminateStateOnExecError(state, "Unsupported SIToFP operation");
@@ -3063,7 +3302,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell argCell;
-      argCell.value = arg;
+      argCell.setValue(arg);
       argCell.error = c.error;
       arguments.push_back(argCell);
 
@@ -3085,8 +3324,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         // Always true
         ref<Expr> result = ConstantExpr::create(1, Expr::Bool);
 
@@ -3103,8 +3342,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         // Always false
         ref<Expr> result = ConstantExpr::create(0, Expr::Bool);
 
@@ -3124,8 +3363,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = EqExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3141,8 +3380,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = UgtExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3159,8 +3398,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = SgeExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3177,8 +3416,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = SltExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3195,8 +3434,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = SleExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3213,8 +3452,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         ref<Expr> result = NeExpr::create(left, right);
 
         std::vector<Cell> arguments;
@@ -3232,8 +3471,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         // Always false
         ref<Expr> result = ConstantExpr::create(0, Expr::Bool);
 
@@ -3249,8 +3488,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         const Cell &lCell = eval(ki, 0, state);
         const Cell &rCell = eval(ki, 1, state);
 
-        left = lCell.value;
-        right = rCell.value;
+        left = lCell.getValue();
+        right = rCell.getValue();
         // Always false
         ref<Expr> result = ConstantExpr::create(1, Expr::Bool);
 
@@ -3268,9 +3507,10 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       const Cell &rCell = eval(ki, 1, state);
 
       FCmpInst *fi = cast<FCmpInst>(i);
-      ref<ConstantExpr> left = toConstant(state, lCell.value, "floating point");
+      ref<ConstantExpr> left =
+          toConstant(state, lCell.getValue(), "floating point");
       ref<ConstantExpr> right =
-          toConstant(state, rCell.value, "floating point");
+          toConstant(state, rCell.getValue(), "floating point");
       if (!fpWidthToSemantics(left->getWidth()) ||
           !fpWidthToSemantics(right->getWidth()))
         return terminateStateOnExecError(state, "Unsupported FCmp operation");
@@ -3364,9 +3604,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::vector<Cell> arguments;
       Cell lArg, rArg;
-      lArg.value = left;
+      lArg.setValue(left);
       lArg.error = lCell.error;
-      rArg.value = right;
+      rArg.setValue(right);
       rArg.error = rCell.error;
       arguments.push_back(lCell);
       arguments.push_back(rCell);
@@ -3382,8 +3622,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = aggCell.value;
-    ref<Expr> val = valCell.value;
+    ref<Expr> agg = aggCell.getValue();
+    ref<Expr> val = valCell.getValue();
 
     ref<Expr> l = NULL, r = NULL;
     unsigned lOffset = kgepi->offset*8, rOffset = kgepi->offset*8 + val->getWidth();
@@ -3416,7 +3656,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = aggCell.value;
+    ref<Expr> agg = aggCell.getValue();
 
     ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
 
@@ -3477,6 +3717,47 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 }
 
+bool Executor::checkDeferredBranches(ExecutionState &current) {
+  // Check the selected state together with other unchecked states, so that
+  // infeasible states are discarded before they are selected
+  std::vector<ExecutionState *> batch;
+  batch.push_back(&current);
+  for (std::set<ExecutionState *>::iterator it = uncheckedStates.begin(),
+                                            ie = uncheckedStates.end();
+       it != ie && batch.size() < DeferredBranchCheckBatch; ++it) {
+    if (*it != &current)
+      batch.push_back(*it);
+  }
+
+  bool feasible = true;
+  for (std::vector<ExecutionState *>::iterator it = batch.begin(),
+                                               ie = batch.end();
+       it != ie; ++it) {
+    ExecutionState &es = **it;
+    uncheckedStates.erase(&es);
+    if (es.deferredCondition.isNull())
+      continue;
+
+    ExecutionState tmp(es.deferredConstraints);
+    bool mayBeTrue;
+    solver->setTimeout(coreSolverTimeout);
+    bool success = solver->mayBeTrue(tmp, es.deferredCondition, mayBeTrue);
+    solver->setTimeout(0);
+    es.queryCost += tmp.queryCost;
+    es.deferredConstraints.clear();
+    es.deferredCondition = ref<Expr>();
+
+    // Keep the state when the solver fails, as -no-branch-check would
+    if (success && !mayBeTrue) {
+      ++stats::deferredInfeasibleStates;
+      removedStates.push_back(&es);
+      if (&es == &current)
+        feasible = false;
+    }
+  }
+  return feasible;
+}
+
 void Executor::updateStates(ExecutionState *current) {
   if (searcher) {
     searcher->update(current, addedStates, removedStates);
@@ -3499,6 +3780,7 @@ void Executor::updateStates(ExecutionState *current) {
       seedMap.find(es);
     if (it3 != seedMap.end())
       seedMap.erase(it3);
+    uncheckedStates.erase(es);
     processTree->remove(es->ptreeNode);
     delete es;
   }
@@ -3563,7 +3845,7 @@ void Executor::bindModuleConstants() {
   kmodule->constantTable = new Cell[kmodule->constants.size()];
   for (unsigned i=0; i<kmodule->constants.size(); ++i) {
     Cell &c = kmodule->constantTable[i];
-    c.value = evalConstant(kmodule->constants[i]);
+    c.setValue(evalConstant(kmodule->constants[i]));
   }
 }
 
@@ -3702,6 +3984,10 @@ void Executor::run(ExecutionState &initialState) {
   while (!states.empty() && !haltExecution &&
          (!LoopBreaking || !searcher->empty())) {
     ExecutionState &state = searcher->selectState();
+    if (!state.deferredCondition.isNull() && !checkDeferredBranches(state)) {
+      updateStates(0);
+      continue;
+    }
     KInstruction *ki = state.pc;
     stepInstruction(state);
 
@@ -3798,7 +4084,10 @@ void Executor::terminateState(ExecutionState &state) {
   }
 
   interpreterHandler->incPathsExplored();
+  removeState(state);
+}
 
+void Executor::removeState(ExecutionState &state) {
   std::vector<ExecutionState *>::iterator it =
       std::find(addedStates.begin(), addedStates.end(), &state);
   if (it==addedStates.end()) {
@@ -3811,25 +4100,231 @@ void Executor::terminateState(ExecutionState &state) {
       seedMap.find(&state);
     if (it3 != seedMap.end())
       seedMap.erase(it3);
+    uncheckedStates.erase(&state);
     addedStates.erase(it);
     processTree->remove(state.ptreeNode);
     delete &state;
   }
 }
 
+void Executor::shareState() {
+  // Count the states left to explore, and pick the one closest to the root
+  // among those whose feasibility is known.
+  unsigned remaining = addedStates.size();
+  ExecutionState *shared = 0;
+  for (std::set<ExecutionState*>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it) {
+    ExecutionState *es = *it;
+    if (std::find(removedStates.begin(), removedStates.end(), es) !=
+        removedStates.end())
+      continue;
+    ++remaining;
+    if (uncheckedStates.count(es) || seedMap.count(es))
+      continue;
+    if (!shared || es->depth < shared->depth)
+      shared = es;
+  }
+
+  if (!pathWriter || !shared || remaining < 2) {
+    interpreterHandler->shareState(0);
+    return;
+  }
+
+  std::vector<unsigned char> branches;
+  pathWriter->readStream(getPathStreamID(*shared), branches);
+  std::vector<bool> path;
+  for (std::vector<unsigned char>::iterator it = branches.begin(),
+         ie = branches.end(); it != ie; ++it)
+    path.push_back(*it == '1');
+  interpreterHandler->shareState(&path);
+  removeState(*shared);
+}
+
+unsigned Executor::replayChoice(unsigned N) {
+  unsigned choice = 0;
+  for (unsigned n = N - 1; n; n >>= 1) {
+    assert(replayPosition<replayPath->size() &&
+           "ran out of branches in replay path mode");
+    choice = (choice << 1) | (*replayPath)[replayPosition++];
+  }
+  return choice;
+}
+
+void Executor::recordChoice(ExecutionState &state, unsigned choice,
+                            unsigned N) {
+  // The choice is written in binary, most significant bit first, with as
+  // many bits as needed for N-1
+  unsigned bits = 0;
+  for (unsigned n = N - 1; n; n >>= 1)
+    ++bits;
+  while (bits--) {
+    const char *bit = (choice >> bits) & 1 ? "1" : "0";
+    if (pathWriter)
+      state.pathOS << bit;
+    if (symPathWriter)
+      state.symPathOS << bit;
+  }
+}
+
+namespace {
+/// Replace reads of arrays by reads of their renamed copies
+class ArrayRenamer : public ExprVisitor {
+  const std::map<const Array *, const Array *> &renaming;
+
+public:
+  ArrayRenamer(const std::map<const Array *, const Array *> &_renaming)
+      : renaming(_renaming) {}
+
+  Action visitRead(const ReadExpr &re) {
+    std::map<const Array *, const Array *>::const_iterator it =
+        renaming.find(re.updates.root);
+    if (it == renaming.end())
+      return Action::doChildren();
+
+    // Replay the updates on the copy, oldest first
+    std::vector<const UpdateNode *> updates;
+    for (const UpdateNode *un = re.updates.head; un; un = un->next)
+      updates.push_back(un);
+    UpdateList ul(it->second, 0);
+    for (std::vector<const UpdateNode *>::reverse_iterator
+             uit = updates.rbegin(),
+             uie = updates.rend();
+         uit != uie; ++uit)
+      ul.extend(visit((*uit)->index), visit((*uit)->value));
+    return Action::changeTo(ReadExpr::create(ul, visit(re.index)));
+  }
+};
+
+/// Map the symbolic arrays among \arg arrays to fresh copies, named with
+/// \arg suffix
+void renameArrays(ArrayCache &arrayCache,
+                  const std::vector<const Array *> &arrays,
+                  const std::string &suffix,
+                  std::map<const Array *, const Array *> &renaming) {
+  for (std::vector<const Array *>::const_iterator it = arrays.begin(),
+                                                  ie = arrays.end();
+       it != ie; ++it) {
+    const Array *array = *it;
+    if (array->isConstantArray() || renaming.count(array))
+      continue;
+    renaming[array] = arrayCache.CreateArray(array->name + suffix, array->size,
+                                             0, 0, array->domain, array->range);
+  }
+}
+}
+
+void Executor::computeDeferredErrorBounds(ExecutionState &state) {
+#ifdef ENABLE_Z3
+  std::vector<ErrorState::DeferredErrorBound> &deferred =
+      state.symbolicError->getDeferredErrorBounds();
+  if (deferred.empty())
+    return;
+
+  // Each call is optimized under the path condition at the call, which the
+  // later branches of the path may have strengthened. The calls made under
+  // the same path condition share one copy of it, whose arrays are renamed
+  // for all but the first copy. The arrays that only occur in the
+  // constraints of a call (its error variable and input errors) are renamed
+  // per call, so that each call is optimized independently of the
+  // constraints of the other calls.
+  std::vector<ref<Expr> > constraints;
+  std::set<const Array *> pathArrays;
+  std::map<const Array *, const Array *> pathRenaming;
+  std::vector<const Array *> objects;
+  for (unsigned i = 0; i < deferred.size(); ++i) {
+    const ConstraintManager &path = deferred[i].pathConstraints;
+    if (!i || path.getId() != deferred[i - 1].pathConstraints.getId()) {
+      std::vector<const Array *> arrays;
+      findSymbolicObjects(path.begin(), path.end(), arrays);
+      pathArrays.clear();
+      pathArrays.insert(arrays.begin(), arrays.end());
+      pathRenaming.clear();
+      if (i)
+        renameArrays(arrayCache, arrays, "__path" + llvm::utostr(i),
+                     pathRenaming);
+
+      ArrayRenamer renamer(pathRenaming);
+      for (ConstraintManager::constraint_iterator it = path.begin(),
+                                                  ie = path.end();
+           it != ie; ++it)
+        constraints.push_back(renamer.visit(*it));
+    }
+
+    std::vector<const Array *> arrays;
+    findSymbolicObjects(deferred[i].constraints.begin(),
+                        deferred[i].constraints.end(), arrays);
+    std::vector<const Array *> callArrays;
+    for (std::vector<const Array *>::iterator it = arrays.begin(),
+                                              ie = arrays.end();
+         it != ie; ++it)
+      if (!pathArrays.count(*it))
+        callArrays.push_back(*it);
+
+    std::map<const Array *, const Array *> renaming(pathRenaming);
+    renameArrays(arrayCache, callArrays, "__bound" + llvm::utostr(i),
+                 renaming);
+
+    ArrayRenamer renamer(renaming);
+    for (std::vector<ref<Expr> >::iterator
+             it = deferred[i].constraints.begin(),
+             ie = deferred[i].constraints.end();
+         it != ie; ++it)
+      constraints.push_back(renamer.visit(*it));
+
+    for (std::vector<ref<Expr> >::iterator
+             it = deferred[i].inputErrors.begin(),
+             ie = deferred[i].inputErrors.end();
+         it != ie; ++it) {
+      std::vector<const Array *> addedObjects;
+      findSymbolicObjects(*it, addedObjects);
+      std::map<const Array *, const Array *>::iterator rit =
+          renaming.find(addedObjects.back());
+      objects.push_back(rit == renaming.end() ? addedObjects.back()
+                                              : rit->second);
+    }
+  }
+
+  std::vector<bool> infinity;
+  std::vector<std::pair<int, double> > values;
+  std::vector<bool> epsilon;
+  bool hasSolution;
+  ConstraintManager cm(constraints);
+  Query queryWithFalse(cm, ConstantExpr::create(0, Expr::Bool));
+  bool success = errorSolver->computeIndependentOptimalValues(
+      queryWithFalse, objects, infinity, values, epsilon, hasSolution);
+
+  if (!(success && hasSolution))
+    assert(!"state has invalid constraint set");
+
+  std::vector<std::vector<std::pair<int, double> > > bounds;
+  std::vector<std::pair<int, double> >::iterator vit = values.begin();
+  for (unsigned i = 0; i < deferred.size(); ++i) {
+    std::vector<std::pair<int, double> >::iterator vie =
+        vit + deferred[i].inputErrors.size();
+    bounds.push_back(std::vector<std::pair<int, double> >(vit, vie));
+    vit = vie;
+  }
+  state.symbolicError->outputDeferredErrorBounds(bounds);
+#endif
+}
+
 void Executor::terminateStateEarly(ExecutionState &state, 
                                    const Twine &message) {
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
-      (AlwaysOutputSeeds && seedMap.count(&state)))
+      (AlwaysOutputSeeds && seedMap.count(&state))) {
+    computeDeferredErrorBounds(state);
     interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
                                         "early");
+  }
   terminateState(state);
 }
 
 void Executor::terminateStateOnExit(ExecutionState &state) {
   if (!OnlyOutputStatesCoveringNew || state.coveredNew || 
-      (AlwaysOutputSeeds && seedMap.count(&state)))
+      (AlwaysOutputSeeds && seedMap.count(&state))) {
+    computeDeferredErrorBounds(state);
     interpreterHandler->processTestCase(state, 0, 0);
+  }
   terminateState(state);
 }
 
@@ -3929,6 +4424,7 @@ void Executor::terminateStateOnError(ExecutionState &state,
       suffix = suffix_buf.c_str();
     }
 
+    computeDeferredErrorBounds(state);
     interpreterHandler->processTestCase(state, msg.str().c_str(), suffix);
   }
     
@@ -3960,7 +4456,7 @@ void Executor::callExternalFunction(ExecutionState &state, KInstruction *target,
   std::vector<ref<Expr> > arguments;
   for (std::vector<Cell>::iterator it = callArgs.begin(), ie = callArgs.end();
        it != ie; ++it) {
-    arguments.push_back(it->value);
+    arguments.push_back(it->getValue());
   }
   // check if specialFunctionHandler wants it
   if (specialFunctionHandler->handle(state, function, target, arguments))
@@ -4154,6 +4650,7 @@ void Executor::executeAlloc(ExecutionState &state,
         unsigned count = std::min(reallocFrom->size, os->size);
         for (unsigned i=0; i<count; i++)
           os->write(i, reallocFrom->read8(i));
+        state.symbolicError->freeObject(reallocFrom->getObject()->address);
         state.addressSpace.unbindObject(reallocFrom->getObject());
       }
     }
@@ -4272,6 +4769,7 @@ void Executor::executeFree(ExecutionState &state,
                               getAddressInfo(*it->second, address));
       } else {
         ref<Expr> nullExpr;
+        it->second->symbolicError->freeObject(mo->address);
         it->second->addressSpace.unbindObject(mo);
         if (target)
           bindLocal(target, *it->second, Expr::createPointer(0),
@@ -4319,7 +4817,7 @@ void Executor::executeMemoryOperation(
     ref<Expr> value /* undef if read */, ref<Expr> error /* undef if read */,
     ref<Expr> valueWithError /* undef if read */,
     KInstruction *target /* undef if write */) {
-  ref<Expr> address = cell.value;
+  ref<Expr> address = cell.getValue();
   Expr::Width type = (isWrite ? value->getWidth() : 
                      getWidthForLLVMType(target->inst->getType()));
   unsigned bytes = Expr::getMinBytesForWidth(type);
@@ -4371,8 +4869,9 @@ void Executor::executeMemoryOperation(
         } else {
           ObjectState *wos = state.addressSpace.getWriteable(mo, os);
           wos->write(offset, value);
-          state.symbolicError->executeStore(mo->getBaseExpr(), address, value,
-                                            error, valueWithError,
+          state.symbolicError->executeStore(mo->getBaseExpr(), address, offset,
+                                            mo->size, value, error,
+                                            valueWithError,
                                             target ? target->inst : 0);
         }
       } else {
@@ -4421,14 +4920,14 @@ void Executor::executeMemoryOperation(
         } else {
           ObjectState *wos = bound->addressSpace.getWriteable(mo, os);
           wos->write(mo->getOffsetExpr(address), value);
-          state.symbolicError->executeStore(mo->getBaseExpr(), address, value,
-                                            error, valueWithError,
-                                            target->inst);
+          bound->symbolicError->executeStore(
+              mo->getBaseExpr(), address, mo->getOffsetExpr(address), mo->size,
+              value, error, valueWithError, target ? target->inst : 0);
         }
       } else {
         ref<Expr> result = os->read(mo->getOffsetExpr(address), type);
         bindLocal(target, *bound, result,
-                  state.symbolicError->executeLoad(target->inst,
+                  bound->symbolicError->executeLoad(target->inst,
                                                    mo->getBaseExpr(), address,
                                                    mo->getOffsetExpr(address)));
       }
@@ -4559,6 +5058,21 @@ ref<Expr> Executor::createFreshArray(ExecutionState &state, uint64_t &id,
 
 /***/
 
+void Executor::setReplayPathPrefix(const std::vector<bool> *path) {
+  assert(!replayKTest && "cannot replay both buffer and path");
+  if (!path) {
+    // The runs of the prefixes are over
+    if (replayPathIsPrefix && statsTracker)
+      statsTracker->done();
+    replayPath = 0;
+    replayPathIsPrefix = false;
+  } else {
+    replayPath = !path->empty() ? path : 0;
+    replayPathIsPrefix = true;
+  }
+  replayPosition = 0;
+}
+
 void Executor::runFunctionAsMain(Function *f,
 				 int argc,
 				 char **argv,
@@ -4659,12 +5173,14 @@ void Executor::runFunctionAsMain(Function *f,
 
   // hack to clear memory objects
   delete memory;
-  memory = new MemoryManager(NULL);
+  memory = new MemoryManager(&arrayCache);
 
   globalObjects.clear();
   globalAddresses.clear();
 
-  if (statsTracker)
+  // The statistics of a series of prefixes are finished once the series is,
+  // see setReplayPathPrefix()
+  if (statsTracker && !replayPathIsPrefix)
     statsTracker->done();
 }
 
@@ -4791,7 +5307,7 @@ bool Executor::getRealSymbolicSolution(
 
   for (unsigned i = 0; i != state.symbolics.size(); ++i)
     objects.push_back(state.symbolics[i].second);
-  bool success = errorSolver->getInitialValues(
+  bool success = realSolver->getInitialValues(
       Query(state.constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
       values);
   if (!success) {
@@ -132,6 +132,9 @@ private:
   TimingSolver *solver;
 #ifdef ENABLE_Z3
   Z3ErrorSolver *errorSolver;
+  /// Solver for real number solutions, either errorSolver itself or a
+  /// caching solver owning it.
+  Solver *realSolver;
 #endif
   MemoryManager *memory;
   std::set<ExecutionState*> states;
@@ -152,6 +155,11 @@ private:
   /// \invariant \ref addedStates and \ref removedStates are disjoint.
   std::vector<ExecutionState *> removedStates;
 
+  /// States forked without checking the feasibility of their branch
+  /// condition (see -deferred-branch-check).
+  /// \invariant \ref uncheckedStates is a subset of \ref states.
+  std::set<ExecutionState *> uncheckedStates;
+
   /// When non-empty the Executor is running in "seed" mode. The
   /// states in this map will be executed in an arbitrary order
   /// (outside the normal search interface) until they terminate. When
@@ -177,6 +185,9 @@ private:
   const struct KTest *replayKTest;
   /// When non-null a list of branch decisions to be used for replay.
   const std::vector<bool> *replayPath;
+  /// Whether \ref replayPath is only a prefix of the paths to explore,
+  /// see setReplayPathPrefix().
+  bool replayPathIsPrefix;
   /// The index into the current \ref replayKTest or \ref replayPath
   /// object.
   unsigned replayPosition;
@@ -204,6 +215,10 @@ private:
   /// (e.g. for a single STP query)
   double coreSolverTimeout;
 
+  /// The error of values without error, shared by the registers to avoid
+  /// allocating it for each of them.
+  ref<Expr> zeroError;
+
   /// Assumes ownership of the created array objects
   ArrayCache arrayCache;
 
@@ -238,6 +253,11 @@ private:
 
   void stepInstruction(ExecutionState &state);
   void updateStates(ExecutionState *current);
+
+  /// Check the feasibility of the deferred branch conditions of the
+  /// selected state and of a batch of other unchecked states, and remove
+  /// the infeasible ones. Returns false if the selected state is infeasible.
+  bool checkDeferredBranches(ExecutionState &current);
   void transferToBasicBlock(llvm::BasicBlock *dst, 
 			    llvm::BasicBlock *src,
 			    ExecutionState &state);
@@ -356,6 +376,12 @@ private:
 
   void bindLocal(KInstruction *target, ExecutionState &state, ref<Expr> value,
                  std::pair<ref<Expr>, ref<Expr> > error);
+
+  /// Executes an integer arithmetic, comparison or conversion instruction
+  /// whose operands are concrete and without error on the inline values of
+  /// the registers, without building expressions. Returns false, doing
+  /// nothing, if the instruction does not qualify.
+  bool executeConcreteInstruction(ExecutionState &state, KInstruction *ki);
   void bindArgument(KFunction *kf, 
                     unsigned index,
                     ExecutionState &state,
@@ -395,6 +421,22 @@ private:
 
   // remove state from queue and delete
   void terminateState(ExecutionState &state);
+  // remove state from queue and delete, without counting it as an
+  // explored path
+  void removeState(ExecutionState &state);
+
+  /// Hand over a state to the interpreter handler as the branch decisions
+  /// leading to it, see InterpreterHandler::isStateWanted().
+  void shareState();
+
+  /// Read the replayed choice among \arg N alternatives, or record
+  /// \arg choice into the path of \arg state.
+  unsigned replayChoice(unsigned N);
+  void recordChoice(ExecutionState &state, unsigned choice, unsigned N);
+  /// Compute the error bounds of the klee_bound_error calls on the path
+  /// of the state deferred by -batch-error-bound, using a single
+  /// optimization query for all of them.
+  void computeDeferredErrorBounds(ExecutionState &state);
   // call exit handler and terminate state
   void terminateStateEarly(ExecutionState &state, const llvm::Twine &message);
   // call exit handler and terminate state
@@ -473,9 +515,12 @@ public:
   virtual void setReplayPath(const std::vector<bool> *path) {
     assert(!replayKTest && "cannot replay both buffer and path");
     replayPath = path;
+    replayPathIsPrefix = false;
     replayPosition = 0;
   }
 
+  virtual void setReplayPathPrefix(const std::vector<bool> *path);
+
   virtual llvm::Module *setModule(llvm::Module *module,
                                   const ModuleOptions &opts);
 
@@ -189,6 +189,9 @@ void Executor::processTimers(ExecutionState *current,
       }
     }
 
+    if (interpreterHandler->isStateWanted())
+      shareState();
+
     if (!timers.empty()) {
       double time = util::getWallTime();
 
@@ -98,14 +98,47 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 /***/
 
+ObjectStatePage::ObjectStatePage(unsigned _size)
+  : refCount(0),
+    size(_size),
+    concreteStore(new uint8_t[_size]),
+    concreteMask(0),
+    flushMask(0),
+    knownSymbolics(0) {
+  memset(concreteStore, 0, size);
+}
+
+ObjectStatePage::ObjectStatePage(const ObjectStatePage &p)
+  : refCount(0),
+    size(p.size),
+    concreteStore(new uint8_t[p.size]),
+    concreteMask(p.concreteMask ? new BitArray(*p.concreteMask, p.size) : 0),
+    flushMask(p.flushMask ? new BitArray(*p.flushMask, p.size) : 0),
+    knownSymbolics(0) {
+  if (p.knownSymbolics) {
+    knownSymbolics = new ref<Expr>[size];
+    for (unsigned i=0; i<size; i++)
+      knownSymbolics[i] = p.knownSymbolics[i];
+  }
+
+  memcpy(concreteStore, p.concreteStore, size*sizeof(*concreteStore));
+}
+
+ObjectStatePage::~ObjectStatePage() {
+  if (concreteMask) delete concreteMask;
+  if (flushMask) delete flushMask;
+  if (knownSymbolics) delete[] knownSymbolics;
+  delete[] concreteStore;
+}
+
+/***/
+
+const unsigned ObjectState::pageSize;
+
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
-    concreteMask(0),
-    flushMask(0),
-    knownSymbolics(0),
     updates(0, 0),
     size(mo->size),
     readOnly(false) {
@@ -116,7 +149,7 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
+  allocatePages();
 }
 
 
@@ -124,26 +157,19 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
-    concreteMask(0),
-    flushMask(0),
-    knownSymbolics(0),
     updates(array, 0),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
+  allocatePages();
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    pages(os.pages),
     updates(os.updates),
     size(os.size),
     readOnly(false) {
@@ -151,20 +177,16 @@ ObjectState::ObjectState(const ObjectState &os)
   if (object)
     object->refCount++;
 
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
+  for (std::vector<ObjectStatePage *>::iterator it = pages.begin(),
+         ie = pages.end(); it != ie; ++it)
+    ++(*it)->refCount;
 }
 
 ObjectState::~ObjectState() {
-  if (concreteMask) delete concreteMask;
-  if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  delete[] concreteStore;
+  for (std::vector<ObjectStatePage *>::iterator it = pages.begin(),
+         ie = pages.end(); it != ie; ++it)
+    if (--(*it)->refCount == 0)
+      delete *it;
 
   if (object)
   {
@@ -177,6 +199,25 @@ ObjectState::~ObjectState() {
   }
 }
 
+void ObjectState::allocatePages() {
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    ObjectStatePage *page =
+        new ObjectStatePage(std::min(pageSize, size - offset));
+    ++page->refCount;
+    pages.push_back(page);
+  }
+}
+
+ObjectStatePage &ObjectState::getWriteablePage(unsigned offset) const {
+  ObjectStatePage *&page = pages[offset / pageSize];
+  if (page->refCount > 1) {
+    --page->refCount;
+    page = new ObjectStatePage(*page);
+    ++page->refCount;
+  }
+  return *page;
+}
+
 ArrayCache *ObjectState::getArrayCache() const {
   assert(object && "object was NULL");
   return object->parent->getArrayCache();
@@ -236,12 +277,19 @@ const UpdateList &ObjectState::getUpdates() const {
 }
 
 void ObjectState::makeConcrete() {
-  if (concreteMask) delete concreteMask;
-  if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  concreteMask = 0;
-  flushMask = 0;
-  knownSymbolics = 0;
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    const ObjectStatePage &p = getPage(offset);
+    if (!p.concreteMask && !p.flushMask && !p.knownSymbolics)
+      continue;
+
+    ObjectStatePage &page = getWriteablePage(offset);
+    if (page.concreteMask) delete page.concreteMask;
+    if (page.flushMask) delete page.flushMask;
+    if (page.knownSymbolics) delete[] page.knownSymbolics;
+    page.concreteMask = 0;
+    page.flushMask = 0;
+    page.knownSymbolics = 0;
+  }
 }
 
 void ObjectState::makeSymbolic() {
@@ -258,14 +306,20 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    ObjectStatePage &page = getWriteablePage(offset);
+    memset(page.concreteStore, 0, page.size);
+  }
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    ObjectStatePage &page = getWriteablePage(offset);
+    for (unsigned i=0; i<page.size; i++) {
+      // randomly selected by 256 sided die
+      page.concreteStore[i] = 0xAB;
+    }
   }
 }
 
@@ -286,42 +340,44 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
- 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
+      ObjectStatePage &page = getWriteablePage(offset);
+      unsigned i = offset % pageSize;
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(page.concreteStore[i], Expr::Int8));
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       page.knownSymbolics[i]);
       }
 
-      flushMask->unset(offset);
+      if (!page.flushMask) page.flushMask = new BitArray(page.size, true);
+      page.flushMask->unset(i);
     }
   } 
 }
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
-
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
+      ObjectStatePage &page = getWriteablePage(offset);
+      unsigned i = offset % pageSize;
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(page.concreteStore[i], Expr::Int8));
         markByteSymbolic(offset);
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       page.knownSymbolics[i]);
         setKnownSymbolic(offset, 0);
       }
 
-      flushMask->unset(offset);
+      if (!page.flushMask) page.flushMask = new BitArray(page.size, true);
+      page.flushMask->unset(i);
     } else {
       // flushed bytes that are written over still need
       // to be marked out
@@ -335,49 +391,80 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
 }
 
 bool ObjectState::isByteConcrete(unsigned offset) const {
-  return !concreteMask || concreteMask->get(offset);
+  const ObjectStatePage &page = getPage(offset);
+  return !page.concreteMask || page.concreteMask->get(offset % pageSize);
 }
 
 bool ObjectState::isByteFlushed(unsigned offset) const {
-  return flushMask && !flushMask->get(offset);
+  const ObjectStatePage &page = getPage(offset);
+  return page.flushMask && !page.flushMask->get(offset % pageSize);
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  const ObjectStatePage &page = getPage(offset);
+  return page.knownSymbolics && page.knownSymbolics[offset % pageSize].get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
-  if (concreteMask)
-    concreteMask->set(offset);
+  if (getPage(offset).concreteMask)
+    getWriteablePage(offset).concreteMask->set(offset % pageSize);
 }
 
 void ObjectState::markByteSymbolic(unsigned offset) {
-  if (!concreteMask)
-    concreteMask = new BitArray(size, true);
-  concreteMask->unset(offset);
+  ObjectStatePage &page = getWriteablePage(offset);
+  if (!page.concreteMask)
+    page.concreteMask = new BitArray(page.size, true);
+  page.concreteMask->unset(offset % pageSize);
 }
 
 void ObjectState::markByteUnflushed(unsigned offset) {
-  if (flushMask)
-    flushMask->set(offset);
+  if (getPage(offset).flushMask)
+    getWriteablePage(offset).flushMask->set(offset % pageSize);
 }
 
 void ObjectState::markByteFlushed(unsigned offset) {
-  if (!flushMask) {
-    flushMask = new BitArray(size, false);
+  ObjectStatePage &page = getWriteablePage(offset);
+  if (!page.flushMask) {
+    page.flushMask = new BitArray(page.size, false);
   } else {
-    flushMask->unset(offset);
+    page.flushMask->unset(offset % pageSize);
   }
 }
 
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
-  if (knownSymbolics) {
-    knownSymbolics[offset] = value;
-  } else {
-    if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+  const ObjectStatePage &p = getPage(offset);
+  if (!p.knownSymbolics && !value)
+    return;
+
+  ObjectStatePage &page = getWriteablePage(offset);
+  if (!page.knownSymbolics)
+    page.knownSymbolics = new ref<Expr>[page.size];
+  page.knownSymbolics[offset % pageSize] = value;
+}
+
+void ObjectState::readConcreteStore(uint8_t *dst) const {
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    const ObjectStatePage &page = getPage(offset);
+    memcpy(dst + offset, page.concreteStore, page.size);
+  }
+}
+
+bool ObjectState::equalsConcreteStore(const uint8_t *src) const {
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    const ObjectStatePage &page = getPage(offset);
+    if (memcmp(src + offset, page.concreteStore, page.size) != 0)
+      return false;
+  }
+  return true;
+}
+
+void ObjectState::writeConcreteStore(const uint8_t *src) {
+  for (unsigned offset = 0; offset < size; offset += pageSize) {
+    if (memcmp(src + offset, getPage(offset).concreteStore,
+               getPage(offset).size) != 0) {
+      ObjectStatePage &page = getWriteablePage(offset);
+      memcpy(page.concreteStore, src + offset, page.size);
     }
   }
 }
@@ -386,9 +473,10 @@ void ObjectState::setKnownSymbolic(unsigned offset,
 
 ref<Expr> ObjectState::read8(unsigned offset) const {
   if (isByteConcrete(offset)) {
-    return ConstantExpr::create(concreteStore[offset], Expr::Int8);
+    return ConstantExpr::create(getPage(offset).concreteStore[offset % pageSize],
+                                Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return getPage(offset).knownSymbolics[offset % pageSize];
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
     
@@ -416,7 +504,7 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  getWriteablePage(offset).concreteStore[offset % pageSize] = value;
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -143,6 +143,28 @@ public:
   }
 };
 
+/// A fixed-size part of the contents of an object state, shared by copies of
+/// the object state until one of them modifies it.
+class ObjectStatePage {
+  friend class ObjectState;
+
+  unsigned refCount;
+  unsigned size;
+
+  uint8_t *concreteStore;
+  // XXX cleanup name of flushMask (its backwards or something)
+  BitArray *concreteMask;
+  BitArray *flushMask;
+  ref<Expr> *knownSymbolics;
+
+  explicit ObjectStatePage(unsigned size);
+  ObjectStatePage(const ObjectStatePage &p);
+  ~ObjectStatePage();
+
+  // DO NOT IMPLEMENT
+  ObjectStatePage &operator=(const ObjectStatePage &p);
+};
+
 class ObjectState {
 private:
   friend class AddressSpace;
@@ -153,14 +175,12 @@ private:
 
   const MemoryObject *object;
 
-  uint8_t *concreteStore;
-  // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
+  /// Size in bytes of the pages of the contents. Copying an object state only
+  /// shares its pages, which are then copied on their first modification.
+  static const unsigned pageSize = 4096;
 
-  // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
-
-  ref<Expr> *knownSymbolics;
+  // mutable because pages may need flushed, thus copied, during read of const
+  mutable std::vector<ObjectStatePage *> pages;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
@@ -205,7 +225,23 @@ public:
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
 
+  /// Copies the concrete cache of the contents to \arg dst.
+  void readConcreteStore(uint8_t *dst) const;
+  /// Whether the concrete cache of the contents equals \arg src.
+  bool equalsConcreteStore(const uint8_t *src) const;
+  /// Sets the concrete cache of the contents from \arg src, copying only the
+  /// pages which differ.
+  void writeConcreteStore(const uint8_t *src);
+
 private:
+  const ObjectStatePage &getPage(unsigned offset) const {
+    return *pages[offset / pageSize];
+  }
+  /// Returns the page holding \arg offset, first copying it if it is shared
+  /// with another object state.
+  ObjectStatePage &getWriteablePage(unsigned offset) const;
+  void allocatePages();
+
   const UpdateList &getUpdates() const;
 
   void makeConcrete();
@@ -35,19 +35,36 @@ PTree::split(Node *n,
 
 void PTree::remove(Node *n) {
   assert(!n->left && !n->right);
-  do {
-    Node *p = n->parent;
-    if (p) {
-      if (n == p->left) {
-        p->left = 0;
-      } else {
-        assert(n == p->right);
-        p->right = 0;
-      }
-    }
+  Node *p = n->parent;
+  if (!p) {
+    assert(n == root);
     delete n;
-    n = p;
-  } while (n && !n->left && !n->right);
+    root = 0;
+    return;
+  }
+
+  // The sibling of the removed node takes the place of their parent
+  Node *sibling;
+  if (n == p->left) {
+    sibling = p->right;
+  } else {
+    assert(n == p->right);
+    sibling = p->left;
+  }
+  assert(sibling && "parent node with a single child");
+  delete n;
+
+  Node *g = p->parent;
+  sibling->parent = g;
+  if (!g) {
+    root = sibling;
+  } else if (p == g->left) {
+    g->left = sibling;
+  } else {
+    assert(p == g->right);
+    g->right = sibling;
+  }
+  delete p;
 }
 
 void PTree::dump(llvm::raw_ostream &os) {
@@ -61,7 +78,8 @@ void PTree::dump(llvm::raw_ostream &os) {
   os << "\tnode [style=\"filled\",width=.1,height=.1,fontname=\"Terminus\"]\n";
   os << "\tedge [arrowsize=.3]\n";
   std::vector<PTree::Node*> stack;
-  stack.push_back(root);
+  if (root)
+    stack.push_back(root);
   while (!stack.empty()) {
     PTree::Node *n = stack.back();
     stack.pop_back();
@@ -15,6 +15,10 @@
 namespace klee {
   class ExecutionState;
 
+  /// PTree - The tree of forks of the states. The states are the leaves,
+  /// and every other node has exactly two children: when a state terminates,
+  /// its sibling takes the place of their parent, so no chain of single
+  /// children is left behind.
   class PTree { 
     typedef ExecutionState* data_type;
 
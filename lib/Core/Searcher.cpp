@@ -281,19 +281,16 @@ ExecutionState &RandomPathSearcher::selectState() {
   unsigned flips=0, bits=0;
   PTree::Node *n = executor.processTree->root;
   
+  // Nodes without a state have two children, so each step down consumes
+  // one random bit
   while (!n->data) {
-    if (!n->left) {
-      n = n->right;
-    } else if (!n->right) {
-      n = n->left;
-    } else {
-      if (bits==0) {
-        flips = theRNG.getInt32();
-        bits = 32;
-      }
-      --bits;
-      n = (flips&(1<<bits)) ? n->left : n->right;
+    assert(n->left && n->right);
+    if (bits==0) {
+      flips = theRNG.getInt32();
+      bits = 32;
     }
+    --bits;
+    n = (flips&(1<<bits)) ? n->left : n->right;
   }
 
   return *n->data;
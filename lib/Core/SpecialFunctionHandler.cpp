@@ -452,7 +452,12 @@ SpecialFunctionHandler::handleBoundError(ExecutionState &state,
         target->inst, bound, name, inputErrorList);
 
 #ifdef ENABLE_Z3
-    if (ComputeErrorBound != NO_COMPUTATION) {
+    if (ComputeErrorBound != NO_COMPUTATION && BatchErrorBound) {
+      // The bounds of all calls on this path are computed together when the
+      // path terminates
+      state.symbolicError->deferErrorBound(cm, state.constraints,
+                                           inputErrorList);
+    } else if (ComputeErrorBound != NO_COMPUTATION) {
       std::vector<const Array *> objects;
       for (std::vector<ref<Expr> >::const_iterator it = inputErrorList.begin(),
                                                    ie = inputErrorList.end();
@@ -57,7 +57,12 @@
 #include "llvm/IR/CFG.h"
 #endif
 
+#include <errno.h>
 #include <fstream>
+#include <functional>
+#include <queue>
+#include <stdio.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 using namespace klee;
@@ -101,6 +106,12 @@ namespace {
       cl::desc("Write istats after each n instructions, 0 to disable "
                "(default=0)"));
 
+  cl::opt<bool>
+  IStatsWriteFork("istats-write-fork",
+                  cl::init(true),
+                  cl::desc("Write istats from a forked process, so that "
+                           "execution goes on meanwhile (default=on)"));
+
   // XXX I really would like to have dynamic rate control for something like this.
   cl::opt<double>
   UncoveredUpdateInterval("uncovered-update-interval",
@@ -183,7 +194,8 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   : executor(_executor),
     objectFilename(_objectFilename),
     statsFile(0),
-    istatsFile(0),
+    pid(getpid()),
+    istatsWriter(0),
     startWallTime(util::getWallTime()),
     numBranches(0),
     fullBranches(0),
@@ -262,9 +274,6 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   }
 
   if (OutputIStats) {
-    istatsFile = executor.interpreterHandler->openOutputFile("run.istats");
-    assert(istatsFile && "unable to open istats file");
-
     if (IStatsWriteInterval > 0)
       executor.addTimer(new WriteIStatsTimer(this), IStatsWriteInterval);
   }
@@ -273,8 +282,7 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
 StatsTracker::~StatsTracker() {  
   if (statsFile)
     delete statsFile;
-  if (istatsFile)
-    delete istatsFile;
+  waitForIStatsWriter(true);
 }
 
 void StatsTracker::done() {
@@ -284,7 +292,10 @@ void StatsTracker::done() {
   if (OutputIStats) {
     if (updateMinDistToUncovered)
       computeReachableUncovered();
-    writeIStats();
+    // The final statistics are written in this process, after any earlier
+    // write has been renamed into place.
+    waitForIStatsWriter(true);
+    writeIStatsFile();
   }
 }
 
@@ -330,6 +341,8 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
         es.instsSinceCovNew = 1;
 	++stats::coveredInstructions;
 	stats::uncoveredInstructions += (uint64_t)-1;
+        if (updateMinDistToUncovered)
+          newlyCovered.push_back(ii.id);
       }
     }
   }
@@ -338,7 +351,7 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
       stats::instructions % StatsWriteAfterInstructions.getValue() == 0)
     writeStatsLine();
 
-  if (istatsFile && IStatsWriteAfterInstructions &&
+  if (OutputIStats && IStatsWriteAfterInstructions &&
       stats::instructions % IStatsWriteAfterInstructions.getValue() == 0)
     writeIStats();
 }
@@ -421,6 +434,12 @@ void StatsTracker::writeStatsHeader() {
              << "'CexCacheTime',"
              << "'ForkTime',"
              << "'ResolveTime',"
+             << "'ErrorSolverTime',"
+             << "'ErrorOptimizeQueries',"
+             << "'ErrorOptimizeTime',"
+             << "'ErrorModelQueries',"
+             << "'ErrorModelTime',"
+             << "'ErrorAssertions',"
 #ifdef DEBUG
 	     << "'ArrayHashTime',"
 #endif
@@ -451,6 +470,13 @@ void StatsTracker::writeStatsLine() {
              << "," << stats::cexCacheTime / 1000000.
              << "," << stats::forkTime / 1000000.
              << "," << stats::resolveTime / 1000000.
+             << "," << (stats::errorOptimizeTime + stats::errorModelTime) /
+                           1000000.
+             << "," << stats::errorOptimizeQueries
+             << "," << stats::errorOptimizeTime / 1000000.
+             << "," << stats::errorModelQueries
+             << "," << stats::errorModelTime / 1000000.
+             << "," << stats::errorAssertions
 #ifdef DEBUG
              << "," << stats::arrayHashTime / 1000000.
 #endif
@@ -469,44 +495,96 @@ void StatsTracker::updateStateStatistics(uint64_t addend) {
   }
 }
 
+bool StatsTracker::waitForIStatsWriter(bool block) {
+  if (!istatsWriter)
+    return true;
+
+  int status;
+  pid_t res;
+  while ((res = waitpid(istatsWriter, &status, block ? 0 : WNOHANG)) < 0 &&
+         errno == EINTR)
+    ;
+  if (res == 0)
+    return false;
+  if (res < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+    klee_warning("unable to write istats file in the background");
+  istatsWriter = 0;
+  return true;
+}
+
 void StatsTracker::writeIStats() {
+  if (!IStatsWriteFork) {
+    writeIStatsFile();
+    return;
+  }
+
+  // Formatting the statistics of every instruction takes seconds on large
+  // modules. A forked child does it on a copy-on-write snapshot of the
+  // statistics instead, while execution goes on. If the previous write is
+  // not done yet, this one is skipped.
+  if (!waitForIStatsWriter(false))
+    return;
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t child = fork();
+  if (child == -1) {
+    writeIStatsFile();
+  } else if (child == 0) {
+    _exit(writeIStatsFile() ? 0 : 1);
+  } else {
+    istatsWriter = child;
+  }
+}
+
+bool StatsTracker::writeIStatsFile() {
   Module *m = executor.kmodule->module;
   uint64_t istatsMask = 0;
-  llvm::raw_fd_ostream &of = *istatsFile;
-  
-  // We assume that we didn't move the file pointer
-  unsigned istatsSize = of.tell();
 
-  of.seek(0);
+  // The file is written under a temporary name and renamed into place, so
+  // that readers never see it partially written.
+  llvm::raw_fd_ostream *istatsFile =
+      executor.interpreterHandler->openOutputFile("run.istats.tmp");
+  if (!istatsFile) {
+    klee_warning("unable to open istats file");
+    return false;
+  }
+  llvm::raw_fd_ostream &of = *istatsFile;
 
   of << "version: 1\n";
   of << "creator: klee\n";
-  of << "pid: " << getpid() << "\n";
+  of << "pid: " << pid << "\n";
   of << "cmd: " << m->getModuleIdentifier() << "\n\n";
   of << "\n";
   
   StatisticManager &sm = *theStatisticManager;
   unsigned nStats = sm.getNumStatistics();
 
-  // Max is 13, sadly
-  istatsMask |= 1<<sm.getStatisticID("Queries");
-  istatsMask |= 1<<sm.getStatisticID("QueriesValid");
-  istatsMask |= 1<<sm.getStatisticID("QueriesInvalid");
-  istatsMask |= 1<<sm.getStatisticID("QueryTime");
-  istatsMask |= 1<<sm.getStatisticID("ResolveTime");
-  istatsMask |= 1<<sm.getStatisticID("Instructions");
-  istatsMask |= 1<<sm.getStatisticID("InstructionTimes");
-  istatsMask |= 1<<sm.getStatisticID("InstructionRealTimes");
-  istatsMask |= 1<<sm.getStatisticID("Forks");
-  istatsMask |= 1<<sm.getStatisticID("CoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("UncoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("States");
-  istatsMask |= 1<<sm.getStatisticID("MinDistToUncovered");
+  // The mask holds at most 64 statistics
+  assert(nStats <= 64 && "too many statistics for the istats mask");
+  istatsMask |= 1ULL<<sm.getStatisticID("Queries");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueriesValid");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueriesInvalid");
+  istatsMask |= 1ULL<<sm.getStatisticID("QueryTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("ResolveTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("Instructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("InstructionTimes");
+  istatsMask |= 1ULL<<sm.getStatisticID("InstructionRealTimes");
+  istatsMask |= 1ULL<<sm.getStatisticID("Forks");
+  istatsMask |= 1ULL<<sm.getStatisticID("CoveredInstructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("UncoveredInstructions");
+  istatsMask |= 1ULL<<sm.getStatisticID("States");
+  istatsMask |= 1ULL<<sm.getStatisticID("MinDistToUncovered");
+  istatsMask |= 1ULL<<sm.getStatisticID("ErrorOptimizeQueries");
+  istatsMask |= 1ULL<<sm.getStatisticID("ErrorOptimizeTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("ErrorModelQueries");
+  istatsMask |= 1ULL<<sm.getStatisticID("ErrorModelTime");
+  istatsMask |= 1ULL<<sm.getStatisticID("ErrorAssertions");
 
   of << "positions: instr line\n";
 
   for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask & (1<<i)) {
+    if (istatsMask & (1ULL<<i)) {
       Statistic &s = sm.getStatistic(i);
       of << "event: " << s.getShortName() << " : " 
          << s.getName() << "\n";
@@ -515,14 +593,14 @@ void StatsTracker::writeIStats() {
 
   of << "events: ";
   for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask & (1<<i))
+    if (istatsMask & (1ULL<<i))
       of << sm.getStatistic(i).getShortName() << " ";
   }
   of << "\n";
   
   // set state counts, decremented after we process so that we don't
   // have to zero all records each time.
-  if (istatsMask & (1<<stats::states.getID()))
+  if (istatsMask & (1ULL<<stats::states.getID()))
     updateStateStatistics(1);
 
   std::string sourceFile = "";
@@ -561,7 +639,7 @@ void StatsTracker::writeIStats() {
           of << ii.assemblyLine << " ";
           of << ii.line << " ";
           for (unsigned i=0; i<nStats; i++)
-            if (istatsMask&(1<<i))
+            if (istatsMask&(1ULL<<i))
               of << sm.getIndexedValue(sm.getStatistic(i), index) << " ";
           of << "\n";
 
@@ -587,7 +665,7 @@ void StatsTracker::writeIStats() {
                 of << ii.assemblyLine << " ";
                 of << ii.line << " ";
                 for (unsigned i=0; i<nStats; i++) {
-                  if (istatsMask&(1<<i)) {
+                  if (istatsMask&(1ULL<<i)) {
                     Statistic &s = sm.getStatistic(i);
                     uint64_t value;
 
@@ -611,15 +689,20 @@ void StatsTracker::writeIStats() {
     }
   }
 
-  if (istatsMask & (1<<stats::states.getID()))
+  if (istatsMask & (1ULL<<stats::states.getID()))
     updateStateStatistics((uint64_t)-1);
-  
-  // Clear then end of the file if necessary (no truncate op?).
-  unsigned pos = of.tell();
-  for (unsigned i=pos; i<istatsSize; ++i)
-    of << '\n';
-  
+
   of.flush();
+  bool failed = of.has_error();
+  of.clear_error();
+  delete istatsFile;
+  InterpreterHandler *ih = executor.interpreterHandler;
+  if (failed || rename(ih->getOutputFilename("run.istats.tmp").c_str(),
+                       ih->getOutputFilename("run.istats").c_str()) < 0) {
+    klee_warning("unable to write istats file");
+    return false;
+  }
+  return true;
 }
 
 ///
@@ -630,6 +713,21 @@ static calltargets_ty callTargets;
 static std::map<Function*, std::vector<Instruction*> > functionCallers;
 static std::map<Function*, unsigned> functionShortestPath;
 
+/// Weighted edge of the graph on which distances to uncovered instructions
+/// are computed, between instruction ids
+struct DistEdge {
+  unsigned node;
+  unsigned weight;
+  DistEdge(unsigned _node, unsigned _weight) : node(_node), weight(_weight) {}
+};
+
+/// Edges from each instruction to its successors, weighted by the distance
+/// through the instruction, and from each call to the entry of its callees,
+/// weighted 1; and the same edges reversed.
+static std::vector<std::vector<DistEdge> > distSuccs, distPreds;
+/// Scratch marks of the instructions whose distance is being recomputed
+static std::vector<unsigned char> distAffected;
+
 static std::vector<Instruction*> getSuccs(Instruction *i) {
   BasicBlock *bb = i->getParent();
   std::vector<Instruction*> res;
@@ -806,40 +904,16 @@ void StatsTracker::computeReachableUncovered() {
         }
       }
     } while (changed);
-  }
 
-  // compute minDistToUncovered, 0 is unreachable
-  std::vector<Instruction *> instructions;
-  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
-       fnIt != fn_ie; ++fnIt) {
-    // Not sure if I should bother to preorder here.
-    for (Function::iterator bbIt = fnIt->begin(), bb_ie = fnIt->end(); 
-         bbIt != bb_ie; ++bbIt) {
-      for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
-           it != ie; ++it) {
-        Instruction *inst = static_cast<Instruction *>(it);
-        unsigned id = infos.getInfo(inst).id;
-        instructions.push_back(inst);
-        sm.setIndexedValue(stats::minDistToUncovered, 
-                           id, 
-                           sm.getIndexedValue(stats::uncoveredInstructions, id));
-      }
-    }
-  }
-  
-  std::reverse(instructions.begin(), instructions.end());
-  
-  // I'm so lazy it's not even worklisted.
-  bool changed;
-  do {
-    changed = false;
+    // Build the graph of distances to uncovered instructions
+    distSuccs.resize(infos.getMaxID());
+    distPreds.resize(infos.getMaxID());
     for (std::vector<Instruction*>::iterator it = instructions.begin(),
            ie = instructions.end(); it != ie; ++it) {
       Instruction *inst = *it;
-      uint64_t best, cur = best = sm.getIndexedValue(stats::minDistToUncovered, 
-                                                     infos.getInfo(inst).id);
+      unsigned id = infos.getInfo(inst).id;
       unsigned bestThrough = 0;
-      
+
       if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
         std::vector<Function*> &targets = callTargets[inst];
         for (std::vector<Function*>::iterator fnIt = targets.begin(),
@@ -852,41 +926,110 @@ void StatsTracker::computeReachableUncovered() {
           }
 
           if (!(*fnIt)->isDeclaration()) {
-            uint64_t calleeDist = sm.getIndexedValue(stats::minDistToUncovered,
-                                                     infos.getFunctionInfo(*fnIt).id);
-            if (calleeDist) {
-              calleeDist = 1+calleeDist; // count instruction itself
-              if (best==0 || calleeDist<best)
-                best = calleeDist;
-            }
+            unsigned entry = infos.getFunctionInfo(*fnIt).id;
+            distSuccs[id].push_back(DistEdge(entry, 1));
+            distPreds[entry].push_back(DistEdge(id, 1));
           }
         }
       } else {
         bestThrough = 1;
       }
-      
+
       if (bestThrough) {
         std::vector<Instruction*> succs = getSuccs(inst);
         for (std::vector<Instruction*>::iterator it2 = succs.begin(),
                ie = succs.end(); it2 != ie; ++it2) {
-          uint64_t dist = sm.getIndexedValue(stats::minDistToUncovered,
-                                             infos.getInfo(*it2).id);
-          if (dist) {
-            uint64_t val = bestThrough + dist;
-            if (best==0 || val<best)
-              best = val;
-          }
+          unsigned succ = infos.getInfo(*it2).id;
+          distSuccs[id].push_back(DistEdge(succ, bestThrough));
+          distPreds[succ].push_back(DistEdge(id, bestThrough));
+        }
+      }
+    }
+  }
+
+  // compute minDistToUncovered, 0 is unreachable. Covering instructions
+  // only removes targets, so distances only grow, and only for the
+  // instructions whose shortest paths all went through a newly covered
+  // one. Those are found by walking back from the newly covered
+  // instructions along the edges of shortest paths, and their distances
+  // are recomputed from the unaffected instructions around them.
+  std::vector<unsigned> affected;
+  if (distAffected.empty()) {
+    distAffected.resize(distSuccs.size(), 1);
+    for (unsigned id = 0; id < distSuccs.size(); ++id)
+      affected.push_back(id);
+  } else {
+    for (std::vector<unsigned>::iterator it = newlyCovered.begin(),
+           ie = newlyCovered.end(); it != ie; ++it) {
+      if (!distAffected[*it]) {
+        distAffected[*it] = 1;
+        affected.push_back(*it);
+      }
+    }
+    for (unsigned i = 0; i < affected.size(); ++i) {
+      unsigned id = affected[i];
+      uint64_t dist = sm.getIndexedValue(stats::minDistToUncovered, id);
+      if (!dist)
+        continue;
+      std::vector<DistEdge> &preds = distPreds[id];
+      for (std::vector<DistEdge>::iterator it = preds.begin(),
+             ie = preds.end(); it != ie; ++it) {
+        if (!distAffected[it->node] &&
+            sm.getIndexedValue(stats::minDistToUncovered, it->node) ==
+                it->weight + dist) {
+          distAffected[it->node] = 1;
+          affected.push_back(it->node);
         }
       }
+    }
+  }
+  newlyCovered.clear();
+
+  // Shortest paths to the remaining targets, from the affected instructions
+  typedef std::pair<uint64_t, unsigned> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry> > queue;
+  for (std::vector<unsigned>::iterator it = affected.begin(),
+         ie = affected.end(); it != ie; ++it) {
+    uint64_t best = sm.getIndexedValue(stats::uncoveredInstructions, *it);
+    std::vector<DistEdge> &succs = distSuccs[*it];
+    for (std::vector<DistEdge>::iterator it2 = succs.begin(),
+           ie2 = succs.end(); it2 != ie2; ++it2) {
+      if (distAffected[it2->node])
+        continue;
+      uint64_t dist = sm.getIndexedValue(stats::minDistToUncovered,
+                                         it2->node);
+      if (dist && (best == 0 || it2->weight + dist < best))
+        best = it2->weight + dist;
+    }
+    sm.setIndexedValue(stats::minDistToUncovered, *it, best);
+    if (best)
+      queue.push(QueueEntry(best, *it));
+  }
 
-      if (best != cur) {
-        sm.setIndexedValue(stats::minDistToUncovered, 
-                           infos.getInfo(inst).id, 
-                           best);
-        changed = true;
+  while (!queue.empty()) {
+    QueueEntry entry = queue.top();
+    queue.pop();
+    if (entry.first != sm.getIndexedValue(stats::minDistToUncovered,
+                                          entry.second))
+      continue;
+    std::vector<DistEdge> &preds = distPreds[entry.second];
+    for (std::vector<DistEdge>::iterator it = preds.begin(),
+           ie = preds.end(); it != ie; ++it) {
+      if (!distAffected[it->node])
+        continue;
+      uint64_t dist = entry.first + it->weight;
+      uint64_t cur = sm.getIndexedValue(stats::minDistToUncovered, it->node);
+      if (cur == 0 || dist < cur) {
+        sm.setIndexedValue(stats::minDistToUncovered, it->node, dist);
+        queue.push(QueueEntry(dist, it->node));
       }
     }
-  } while (changed);
+  }
+
+  for (std::vector<unsigned>::iterator it = affected.begin(),
+         ie = affected.end(); it != ie; ++it)
+    distAffected[*it] = 0;
 
   for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
          ie = executor.states.end(); it != ie; ++it) {
@@ -13,6 +13,8 @@
 #include "CallPathManager.h"
 
 #include <set>
+#include <vector>
+#include <sys/types.h>
 
 namespace llvm {
   class BranchInst;
@@ -36,7 +38,10 @@ namespace klee {
     Executor &executor;
     std::string objectFilename;
 
-    llvm::raw_fd_ostream *statsFile, *istatsFile;
+    llvm::raw_fd_ostream *statsFile;
+    /// Process running the executor, and child process writing run.istats
+    /// or 0
+    pid_t pid, istatsWriter;
     double startWallTime;
     
     unsigned numBranches;
@@ -45,6 +50,9 @@ namespace klee {
     CallPathManager callPathManager;    
 
     bool updateMinDistToUncovered;
+    /// Ids of the instructions covered since the last update of the
+    /// distances to uncovered instructions
+    std::vector<unsigned> newlyCovered;
 
   public:
     static bool useStatistics();
@@ -54,6 +62,10 @@ namespace klee {
     void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
+    bool writeIStatsFile();
+    /// Wait for the child process writing run.istats, if any. Returns false
+    /// if it is still running and \arg block is false.
+    bool waitForIStatsWriter(bool block);
 
   public:
     StatsTracker(Executor &_executor, std::string _objectFilename,
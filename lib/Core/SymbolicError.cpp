@@ -83,7 +83,7 @@ bool SymbolicError::breakLoop(Executor *executor, ExecutionState &state,
                  ie1 = writesStack.back().end();
              it1 != ie1; ++it1) {
           Cell addressCell;
-          addressCell.value = it1->first;
+          addressCell.setValue(it1->first);
 
           // We retrieve the error stored in the address
           std::pair<ref<Expr>, ref<Expr> > errorAndMore =
@@ -251,6 +251,7 @@ SymbolicError::~SymbolicError() {
 }
 
 void SymbolicError::executeStore(ref<Expr> base, ref<Expr> address,
+                                 ref<Expr> offset, unsigned objectSize,
                                  ref<Expr> value, ref<Expr> error,
                                  ref<Expr> valueWithError,
                                  llvm::Instruction *inst) {
@@ -268,6 +269,10 @@ void SymbolicError::executeStore(ref<Expr> base, ref<Expr> address,
         }
       }
     }
+    if (!llvm::isa<ConstantExpr>(address)) {
+      errorState->executeStoreSymbolic(base, objectSize, offset, error);
+      return;
+    }
     storeError(base, address, value, error, valueWithError, inst);
 }
 
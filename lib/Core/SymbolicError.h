@@ -119,6 +119,21 @@ public:
     errorState->outputComputedErrorBound(bounds);
   }
 
+  void deferErrorBound(const ConstraintManager &constraints,
+                       const ConstraintManager &pathConstraints,
+                       const std::vector<ref<Expr> > &inputErrors) {
+    errorState->deferErrorBound(constraints, pathConstraints, inputErrors);
+  }
+
+  std::vector<ErrorState::DeferredErrorBound> &getDeferredErrorBounds() {
+    return errorState->getDeferredErrorBounds();
+  }
+
+  void outputDeferredErrorBounds(
+      const std::vector<std::vector<std::pair<int, double> > > &bounds) {
+    errorState->outputDeferredErrorBounds(bounds);
+  }
+
   ConstraintManager outputErrorBound(llvm::Instruction *inst, double bound,
                                      std::string name,
                                      std::vector<ref<Expr> > &inputErrorList) {
@@ -140,9 +155,11 @@ public:
 
   std::string &getOutputString() { return errorState->getOutputString(); }
 
-  void executeStore(ref<Expr> base, ref<Expr> address, ref<Expr> value,
-                    ref<Expr> error, ref<Expr> valueWithError,
-                    llvm::Instruction *inst);
+  /// \brief Record the error of a store. The offset and size of the written
+  /// object are used to track stores to symbolic addresses within it.
+  void executeStore(ref<Expr> base, ref<Expr> address, ref<Expr> offset,
+                    unsigned objectSize, ref<Expr> value, ref<Expr> error,
+                    ref<Expr> valueWithError, llvm::Instruction *inst);
 
   void storeError(ref<Expr> base, ref<Expr> address, ref<Expr> value,
                   ref<Expr> error, ref<Expr> errorWithValue,
@@ -155,6 +172,8 @@ public:
     errorState->declareInputError(address, error);
   }
 
+  void freeObject(uint64_t address) { errorState->freeObject(address); }
+
   std::pair<ref<Expr>, ref<Expr> > executeLoad(llvm::Instruction *inst,
                                                ref<Expr> base,
                                                ref<Expr> address,
@@ -11,6 +11,7 @@
 #include "klee/CommandLine.h"
 
 #include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
 #include "llvm/IR/Function.h"
@@ -20,7 +21,9 @@
 #include "llvm/Support/CommandLine.h"
 #include "klee/Internal/Module/KModule.h"
 
+#include <algorithm>
 #include <map>
+#include <set>
 
 using namespace klee;
 
@@ -76,6 +79,251 @@ public:
   }
 };
 
+namespace klee {
+
+/// ConstraintFactors - A union-find partition of a list of constraints into
+/// factors which share no array element, as IndependentSolver defines them:
+/// reads at a constant index access a single element, and reads at a
+/// symbolic index the whole array.
+class ConstraintFactors {
+public:
+  unsigned refCount;
+
+private:
+  // union-find forest over the constraint indices; paths are compressed
+  // when searched
+  mutable std::vector<unsigned> parent;
+  // the constraints of each factor, indexed by its root
+  std::vector< std::vector<unsigned> > members;
+  // constraints reading each array; only one is kept once the array is
+  // read at a symbolic index, since all of them are then in one factor
+  std::map<const Array*, std::vector<unsigned> > readers;
+  // a constraint reading each array at a symbolic index
+  std::map<const Array*, unsigned> wholeReaders;
+  // a constraint reading each array element
+  std::map<std::pair<const Array*, unsigned>, unsigned> elementReaders;
+
+  typedef std::vector< std::pair<const Array*, unsigned> > elements_ty;
+
+  static void getReads(ref<Expr> e, std::vector<const Array*> &whole,
+                       elements_ty &elements) {
+    std::vector< ref<ReadExpr> > reads;
+    findReads(e, /* visitUpdates= */ true, reads);
+    for (unsigned i = 0; i != reads.size(); ++i) {
+      ReadExpr *re = reads[i].get();
+      // Reads of a constant array don't alias.
+      if (re->updates.root->isConstantArray() && !re->updates.head)
+        continue;
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index))
+        elements.push_back(std::make_pair(re->updates.root,
+                                          (unsigned) CE->getZExtValue(32)));
+      else
+        whole.push_back(re->updates.root);
+    }
+  }
+
+  unsigned find(unsigned i) const {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  void unite(unsigned a, unsigned b) {
+    a = find(a);
+    b = find(b);
+    if (a == b)
+      return;
+    if (members[a].size() < members[b].size())
+      std::swap(a, b);
+    parent[b] = a;
+    members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+    std::vector<unsigned>().swap(members[b]);
+  }
+
+  /// Collect the roots of the factors \arg e shares an element with
+  void getRoots(ref<Expr> e, std::set<unsigned> &roots) const {
+    std::vector<const Array*> whole;
+    elements_ty elements;
+    getReads(e, whole, elements);
+
+    for (unsigned i = 0; i != whole.size(); ++i) {
+      std::map<const Array*, std::vector<unsigned> >::const_iterator it =
+        readers.find(whole[i]);
+      if (it != readers.end())
+        for (unsigned j = 0; j != it->second.size(); ++j)
+          roots.insert(find(it->second[j]));
+    }
+    for (unsigned i = 0; i != elements.size(); ++i) {
+      std::map<const Array*, unsigned>::const_iterator wit =
+        wholeReaders.find(elements[i].first);
+      if (wit != wholeReaders.end()) {
+        roots.insert(find(wit->second));
+        continue;
+      }
+      std::map<std::pair<const Array*, unsigned>, unsigned>::const_iterator
+        eit = elementReaders.find(elements[i]);
+      if (eit != elementReaders.end())
+        roots.insert(find(eit->second));
+    }
+  }
+
+public:
+  ConstraintFactors() : refCount(0) {}
+  ConstraintFactors(const ConstraintFactors &f)
+    : refCount(0), parent(f.parent), members(f.members), readers(f.readers),
+      wholeReaders(f.wholeReaders), elementReaders(f.elementReaders) {}
+
+  size_t size() const { return parent.size(); }
+
+  /// Add the next constraint, \arg e, to the partition
+  void add(ref<Expr> e) {
+    unsigned index = parent.size();
+    parent.push_back(index);
+    members.push_back(std::vector<unsigned>(1, index));
+
+    std::vector<const Array*> whole;
+    elements_ty elements;
+    getReads(e, whole, elements);
+
+    for (unsigned i = 0; i != whole.size(); ++i) {
+      std::vector<unsigned> &r = readers[whole[i]];
+      for (unsigned j = 0; j != r.size(); ++j)
+        unite(index, r[j]);
+      r.assign(1, index);
+      wholeReaders.insert(std::make_pair(whole[i], index));
+    }
+    for (unsigned i = 0; i != elements.size(); ++i) {
+      std::map<const Array*, unsigned>::iterator wit =
+        wholeReaders.find(elements[i].first);
+      if (wit != wholeReaders.end()) {
+        unite(index, wit->second);
+        continue;
+      }
+      std::pair<std::map<std::pair<const Array*, unsigned>,
+                         unsigned>::iterator, bool> res =
+        elementReaders.insert(std::make_pair(elements[i], index));
+      if (!res.second)
+        unite(index, res.first->second);
+      std::vector<unsigned> &r = readers[elements[i].first];
+      if (r.empty() || r.back() != index)
+        r.push_back(index);
+    }
+  }
+
+  /// Collect, in order, the indices of the constraints in the factors
+  /// \arg e shares an element with
+  void getFactor(ref<Expr> e, std::vector<unsigned> &result) const {
+    std::set<unsigned> roots;
+    getRoots(e, roots);
+    for (std::set<unsigned>::iterator it = roots.begin(), ie = roots.end();
+         it != ie; ++it)
+      result.insert(result.end(), members[*it].begin(), members[*it].end());
+    std::sort(result.begin(), result.end());
+  }
+
+  /// Partition the constraint indices into factors, those \arg e shares an
+  /// element with being merged into the first one.
+  void getFactors(ref<Expr> e,
+                  std::vector< std::vector<unsigned> > &result) const {
+    std::set<unsigned> roots;
+    if (!e.isNull())
+      getRoots(e, roots);
+
+    result.push_back(std::vector<unsigned>());
+    for (unsigned i = 0; i != parent.size(); ++i) {
+      unsigned root = find(i);
+      if (roots.count(root)) {
+        result[0].push_back(i);
+      } else if (root == i) {
+        result.push_back(members[i]);
+        std::sort(result.back().begin(), result.back().end());
+      }
+    }
+  }
+};
+
+}
+
+uint64_t ConstraintManager::newId() {
+  static uint64_t lastId = 0;
+  return ++lastId;
+}
+
+ConstraintManager::ConstraintManager(const ConstraintManager &cs)
+  : constraints(cs.constraints), factors(cs.factors),
+    keepFactors(cs.keepFactors), id(cs.id) {
+  if (factors)
+    ++factors->refCount;
+}
+
+ConstraintManager &ConstraintManager::operator=(const ConstraintManager &cs) {
+  if (cs.factors)
+    ++cs.factors->refCount;
+  releaseFactors();
+  constraints = cs.constraints;
+  factors = cs.factors;
+  keepFactors = cs.keepFactors;
+  id = cs.id;
+  return *this;
+}
+
+ConstraintManager::~ConstraintManager() {
+  releaseFactors();
+}
+
+void ConstraintManager::releaseFactors() const {
+  if (factors && --factors->refCount == 0)
+    delete factors;
+  factors = 0;
+}
+
+void ConstraintManager::updateFactors() const {
+  assert(keepFactors && "constraint factors are not maintained");
+  if (factors && factors->size() == constraints.size())
+    return;
+
+  if (!factors) {
+    factors = new ConstraintFactors();
+    ++factors->refCount;
+  } else if (factors->refCount > 1) {
+    // Shared with the state this one was forked from
+    ConstraintFactors *copy = new ConstraintFactors(*factors);
+    releaseFactors();
+    factors = copy;
+    ++factors->refCount;
+  }
+
+  for (size_t i = factors->size(); i < constraints.size(); ++i)
+    factors->add(constraints[i]);
+}
+
+void ConstraintManager::getIndependentConstraints(
+    ref<Expr> e, std::vector< ref<Expr> > &result) const {
+  updateFactors();
+  std::vector<unsigned> indices;
+  factors->getFactor(e, indices);
+  for (unsigned i = 0; i != indices.size(); ++i)
+    result.push_back(constraints[indices[i]]);
+}
+
+void ConstraintManager::getIndependentFactors(
+    ref<Expr> e, std::vector< std::vector< ref<Expr> > > &result) const {
+  updateFactors();
+  std::vector< std::vector<unsigned> > indices;
+  factors->getFactors(e, indices);
+  for (unsigned i = 0; i != indices.size(); ++i) {
+    if (i == 0 && e.isNull() && indices[0].empty())
+      continue;
+    result.push_back(std::vector< ref<Expr> >());
+    if (i == 0 && !e.isNull())
+      result.back().push_back(e);
+    for (unsigned j = 0; j != indices[i].size(); ++j)
+      result.back().push_back(constraints[indices[i][j]]);
+  }
+}
+
 bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
   ConstraintManager::constraints_ty old;
   bool changed = false;
@@ -94,6 +342,10 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
     }
   }
 
+  // The factors are recomputed once the new constraint has been added
+  if (changed)
+    releaseFactors();
+
   return changed;
 }
 
@@ -171,4 +423,6 @@ void ConstraintManager::addConstraintInternal(ref<Expr> e) {
 void ConstraintManager::addConstraint(ref<Expr> e) {
   e = simplifyExpr(e);
   addConstraintInternal(e);
+  keepFactors = true;
+  id = newId();
 }
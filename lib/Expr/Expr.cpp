@@ -21,7 +21,13 @@
 
 #include "klee/util/ExprPPrinter.h"
 
+#include <ciso646>
 #include <sstream>
+#ifdef _LIBCPP_VERSION
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
 
 using namespace klee;
 using namespace llvm;
@@ -31,11 +37,34 @@ namespace {
   ConstArrayOpt("const-array-opt",
 	 cl::init(false),
 	 cl::desc("Enable various optimizations involving all-constant arrays."));
+
+  cl::opt<bool, true>
+  InternExprs("intern-exprs",
+              cl::location(Expr::interning),
+              cl::init(false),
+              cl::desc("Share a single node between structurally equal "
+                       "expressions (default=off)."));
+
+  /// Canonical nodes by hash. The table holds no references: nodes remove
+  /// themselves when destroyed.
+#ifdef _LIBCPP_VERSION
+  typedef std::unordered_multimap<unsigned, Expr *> InternTable;
+#else
+  typedef std::tr1::unordered_multimap<unsigned, Expr *> InternTable;
+#endif
+
+  /// The table is never freed, as expressions held by static objects may be
+  /// destroyed after it would be.
+  InternTable &getInternTable() {
+    static InternTable *table = new InternTable();
+    return *table;
+  }
 }
 
 /***/
 
 unsigned Expr::count = 0;
+bool Expr::interning = false;
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
@@ -94,6 +123,10 @@ int Expr::compare(const Expr &b) const {
 int Expr::compare(const Expr &b, ExprEquivSet &equivs) const {
   if (this == &b) return 0;
 
+  // Distinct canonical nodes are never equal, only their order is left to
+  // find, and their shared kids are compared as pointers.
+  bool canonical = interned && b.interned;
+
   const Expr *ap, *bp;
   if (this < &b) {
     ap = this; bp = &b;
@@ -101,7 +134,7 @@ int Expr::compare(const Expr &b, ExprEquivSet &equivs) const {
     ap = &b; bp = this;
   }
 
-  if (equivs.count(std::make_pair(ap, bp)))
+  if (!canonical && equivs.count(std::make_pair(ap, bp)))
     return 0;
 
   Kind ak = getKind(), bk = b.getKind();
@@ -119,10 +152,54 @@ int Expr::compare(const Expr &b, ExprEquivSet &equivs) const {
     if (int res = getKid(i)->compare(*b.getKid(i), equivs))
       return res;
 
+  assert(!canonical && "structurally equal expressions interned twice");
   equivs.insert(std::make_pair(ap, bp));
   return 0;
 }
 
+bool Expr::isShallowEqual(const Expr &a, const Expr &b) {
+  if (a.getKind() != b.getKind() || a.hashValue != b.hashValue ||
+      a.compareContents(b))
+    return false;
+
+  for (unsigned i = 0, e = a.getNumKids(); i != e; ++i) {
+    ref<Expr> ak = a.getKid(i), bk = b.getKid(i);
+    if (ak.get() != bk.get() && ak->compare(*bk))
+      return false;
+  }
+  return true;
+}
+
+ref<Expr> Expr::intern(const ref<Expr> &e) {
+  if (!interning)
+    return e;
+
+  InternTable &table = getInternTable();
+  std::pair<InternTable::iterator, InternTable::iterator> range =
+      table.equal_range(e->hashValue);
+  for (InternTable::iterator it = range.first; it != range.second; ++it)
+    if (isShallowEqual(*it->second, *e))
+      return it->second;
+
+  table.insert(std::make_pair(e->hashValue, e.get()));
+  e->interned = true;
+  return e;
+}
+
+void Expr::unintern() {
+  // Only the Expr part of the node is left, so the node is found by address.
+  InternTable &table = getInternTable();
+  std::pair<InternTable::iterator, InternTable::iterator> range =
+      table.equal_range(hashValue);
+  for (InternTable::iterator it = range.first; it != range.second; ++it) {
+    if (it->second == this) {
+      table.erase(it);
+      return;
+    }
+  }
+  assert(0 && "interned expression missing from the table");
+}
+
 void Expr::printKind(llvm::raw_ostream &os, Kind k) {
   switch(k) {
 #define X(C) case C: os << #C; break
@@ -46,45 +46,60 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Support/ErrorHandling.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace klee;
 
+namespace {
+/// Output stream discarding the text written to it, counting its lines
+class LineCountingStream : public llvm::raw_ostream {
+  unsigned lines;
+  uint64_t pos;
+
+  void write_impl(const char *ptr, size_t size) {
+    lines += std::count(ptr, ptr + size, '\n');
+    pos += size;
+  }
+  uint64_t current_pos() const { return pos; }
+
+public:
+  LineCountingStream() : lines(0), pos(0) {}
+  unsigned getLines() const { return lines; }
+};
+
+typedef std::vector<std::pair<const Instruction*, unsigned> > LineTable;
+
+/// Records the line of the printed module on which each instruction starts
 class InstructionToLineAnnotator : public llvm::AssemblyAnnotationWriter {
+  LineCountingStream &stream;
+  LineTable &lines;
+
 public:
+  InstructionToLineAnnotator(LineCountingStream &_stream, LineTable &_lines)
+    : stream(_stream), lines(_lines) {}
+
   void emitInstructionAnnot(const Instruction *i,
                             llvm::formatted_raw_ostream &os) {
-    os << "%%%";
-    os << (uintptr_t) i;
+    // Count the text printed so far
+    os.flush();
+    stream.flush();
+    lines.push_back(std::make_pair(i, stream.getLines() + 1));
   }
 };
-        
-static void buildInstructionToLineMap(Module *m,
-                                      std::map<const Instruction*, unsigned> &out) {  
-  InstructionToLineAnnotator a;
-  std::string str;
-  llvm::raw_string_ostream os(str);
+}
+
+/// List the line of each instruction in the printed module, as written to
+/// assembly.ll, in the order the instructions are printed. The module is
+/// printed to a stream which only counts lines, rather than to memory, as
+/// modules can be large.
+static void buildInstructionToLineMap(Module *m, LineTable &out) {
+  LineCountingStream os;
+  InstructionToLineAnnotator a(os, out);
   m->print(os, &a);
-  os.flush();
-  const char *s;
-
-  unsigned line = 1;
-  for (s=str.c_str(); *s; s++) {
-    if (*s=='\n') {
-      line++;
-      if (s[1]=='%' && s[2]=='%' && s[3]=='%') {
-        s += 4;
-        char *end;
-        unsigned long long value = strtoull(s, &end, 10);
-        if (end!=s) {
-          out.insert(std::make_pair((const Instruction*) value, line));
-        }
-        s = end;
-      }
-    }
-  }
 }
 
 static std::string getDSPIPath(DILocation Loc) {
@@ -115,8 +130,10 @@ bool InstructionInfoTable::getInstructionDebugInfo(const llvm::Instruction *I,
 InstructionInfoTable::InstructionInfoTable(Module *m) 
   : dummyString(""), dummyInfo(0, dummyString, 0, 0) {
   unsigned id = 0;
-  std::map<const Instruction*, unsigned> lineTable;
+  LineTable lineTable;
   buildInstructionToLineMap(m, lineTable);
+  // Instructions are printed in the order they are visited here
+  LineTable::iterator nextLine = lineTable.begin();
 
   for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
        fnIt != fn_ie; ++fnIt) {
@@ -139,7 +156,9 @@ InstructionInfoTable::InstructionInfoTable(Module *m)
     for (inst_iterator it = inst_begin(fn), ie = inst_end(fn); it != ie;
         ++it) {
       Instruction *instr = &*it;
-      unsigned assemblyLine = lineTable[instr];
+      unsigned assemblyLine = 0;
+      if (nextLine != lineTable.end() && nextLine->first == instr)
+        assemblyLine = (nextLine++)->second;
 
       // Update our source level debug information.
       getInstructionDebugInfo(instr, file, line);
@@ -0,0 +1,609 @@
+//===-- BinaryQueryLog.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/BinaryQueryLog.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <string.h>
+
+using namespace klee;
+
+namespace {
+
+const char logMagic[] = "KLEE-QUERY-LOG";
+const unsigned logVersion = 1;
+
+enum RecordTag {
+  ArrayTag = 1,
+  UpdateTag = 2,
+  QueryTag = 3,
+  ResetTag = 4,
+  /// An expression of kind k is defined by tag ExprTag + k
+  ExprTag = 16
+};
+
+void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out += (char)((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += (char)value;
+}
+
+void writeConstant(std::string &out, const ref<ConstantExpr> &c) {
+  const llvm::APInt &value = c->getAPValue();
+  const uint64_t *words = value.getRawData();
+  for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+    writeVarint(out, words[i]);
+}
+
+unsigned getNumKids(unsigned kind) {
+  switch (kind) {
+  case Expr::Constant:
+    return 0;
+  case Expr::Select:
+    return 3;
+  case Expr::Concat:
+    return 2;
+  case Expr::NotOptimized:
+  case Expr::Read:
+  case Expr::Extract:
+  case Expr::ZExt:
+  case Expr::SExt:
+  case Expr::Not:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+}
+
+BinaryQueryLogWriter::BinaryQueryLogWriter(unsigned _maxDefinitions)
+    : maxDefinitions(_maxDefinitions) {}
+
+void BinaryQueryLogWriter::writeHeader(std::string &out) {
+  out.append(logMagic, sizeof(logMagic) - 1);
+  writeVarint(out, logVersion);
+}
+
+unsigned BinaryQueryLogWriter::defineArray(const Array *array,
+                                           std::string &out) {
+  // Arrays are keyed by address, as they live as long as the array cache
+  // which created them
+  std::map<const Array *, unsigned>::iterator it = arrayIds.find(array);
+  if (it != arrayIds.end())
+    return it->second;
+
+  unsigned id = arrayIds.size();
+  out += (char)ArrayTag;
+  writeVarint(out, array->name.size());
+  out += array->name;
+  writeVarint(out, array->size);
+  writeVarint(out, array->domain);
+  writeVarint(out, array->range);
+  writeVarint(out, array->constantValues.size());
+  for (std::vector<ref<ConstantExpr> >::const_iterator
+           cit = array->constantValues.begin(),
+           cie = array->constantValues.end();
+       cit != cie; ++cit)
+    writeConstant(out, *cit);
+  arrayIds.insert(std::make_pair(array, id));
+  return id;
+}
+
+unsigned BinaryQueryLogWriter::defineUpdates(const UpdateList &updates,
+                                             std::string &out) {
+  // Find the newest node already defined, then define the newer ones
+  // oldest first. Update lists can be long, so this does not recurse.
+  std::vector<const UpdateNode *> pending;
+  unsigned next = 0;
+  for (const UpdateNode *un = updates.head; un; un = un->next) {
+    std::map<const UpdateNode *, unsigned>::iterator it = updateIds.find(un);
+    if (it != updateIds.end()) {
+      next = it->second + 1;
+      break;
+    }
+    pending.push_back(un);
+  }
+  if (pending.empty())
+    return next;
+
+  updateLists.push_back(updates);
+  for (std::vector<const UpdateNode *>::reverse_iterator it = pending.rbegin(),
+                                                         ie = pending.rend();
+       it != ie; ++it) {
+    unsigned index = defineExpr((*it)->index, out);
+    unsigned value = defineExpr((*it)->value, out);
+    unsigned id = updateIds.size();
+    out += (char)UpdateTag;
+    writeVarint(out, next);
+    writeVarint(out, index);
+    writeVarint(out, value);
+    updateIds.insert(std::make_pair(*it, id));
+    next = id + 1;
+  }
+  return next;
+}
+
+unsigned BinaryQueryLogWriter::defineExpr(const ref<Expr> &e,
+                                          std::string &out) {
+  ExprHashMap<unsigned>::iterator it = exprIds.find(e);
+  if (it != exprIds.end())
+    return it->second;
+
+  unsigned array = 0, updates = 0;
+  if (ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    array = defineArray(re->updates.root, out);
+    updates = defineUpdates(re->updates, out);
+  }
+  unsigned kids[3];
+  unsigned numKids = e->getNumKids();
+  assert(numKids <= 3 && numKids == getNumKids(e->getKind()));
+  for (unsigned i = 0; i != numKids; ++i)
+    kids[i] = defineExpr(e->getKid(i), out);
+
+  unsigned id = exprIds.size();
+  out += (char)(ExprTag + e->getKind());
+  switch (e->getKind()) {
+  case Expr::Constant:
+    writeVarint(out, e->getWidth());
+    writeConstant(out, cast<ConstantExpr>(e));
+    break;
+  case Expr::Read:
+    writeVarint(out, array);
+    writeVarint(out, updates);
+    break;
+  case Expr::Extract:
+    writeVarint(out, cast<ExtractExpr>(e)->offset);
+    writeVarint(out, e->getWidth());
+    break;
+  case Expr::ZExt:
+  case Expr::SExt:
+    writeVarint(out, e->getWidth());
+    break;
+  default:
+    break;
+  }
+  // Kids are referred to by their distance back from this expression,
+  // which is usually short
+  for (unsigned i = 0; i != numKids; ++i)
+    writeVarint(out, id - kids[i]);
+  exprIds.insert(std::make_pair(e, id));
+  return id;
+}
+
+void BinaryQueryLogWriter::reset(std::string &out) {
+  out += (char)ResetTag;
+  exprIds.clear();
+  arrayIds.clear();
+  updateIds.clear();
+  updateLists.clear();
+}
+
+void BinaryQueryLogWriter::write(const BinaryQueryLogRecord &record,
+                                 std::string &out) {
+  if (exprIds.size() + updateIds.size() + arrayIds.size() > maxDefinitions)
+    reset(out);
+
+  std::vector<unsigned> constraints;
+  for (std::vector<ref<Expr> >::const_iterator
+           it = record.constraints.begin(),
+           ie = record.constraints.end();
+       it != ie; ++it)
+    constraints.push_back(defineExpr(*it, out));
+  unsigned expr = defineExpr(record.expr, out);
+  std::vector<unsigned> objects;
+  for (std::vector<const Array *>::const_iterator
+           it = record.objects.begin(),
+           ie = record.objects.end();
+       it != ie; ++it)
+    objects.push_back(defineArray(*it, out));
+  unsigned value = 0;
+  if (record.success && record.kind == BinaryQueryLogRecord::Value)
+    value = defineExpr(record.value, out);
+
+  out += (char)QueryTag;
+  out += (char)record.kind;
+  out += (char)record.success;
+  out += (char)record.status;
+  uint64_t time;
+  memcpy(&time, &record.time, sizeof(time));
+  for (unsigned i = 0; i != 8; ++i)
+    out += (char)(time >> (8 * i));
+  writeVarint(out, record.instructions);
+  writeVarint(out, constraints.size());
+  for (unsigned i = 0, e = constraints.size(); i != e; ++i)
+    writeVarint(out, constraints[i]);
+  writeVarint(out, expr);
+  if (record.kind == BinaryQueryLogRecord::InitialValues) {
+    writeVarint(out, objects.size());
+    for (unsigned i = 0, e = objects.size(); i != e; ++i)
+      writeVarint(out, objects[i]);
+  }
+
+  if (!record.success)
+    return;
+  switch (record.kind) {
+  case BinaryQueryLogRecord::Truth:
+    out += (char)record.isValid;
+    break;
+  case BinaryQueryLogRecord::Validity:
+    out += (char)(record.validity + 1);
+    break;
+  case BinaryQueryLogRecord::Value:
+    writeVarint(out, value);
+    break;
+  case BinaryQueryLogRecord::InitialValues:
+    out += (char)record.hasSolution;
+    if (record.hasSolution) {
+      for (std::vector<std::vector<unsigned char> >::const_iterator
+               it = record.values.begin(),
+               ie = record.values.end();
+           it != ie; ++it) {
+        writeVarint(out, it->size());
+        out.append(it->begin(), it->end());
+      }
+    }
+    break;
+  }
+}
+
+/***/
+
+BinaryQueryLogReader::BinaryQueryLogReader(const char *begin, const char *end)
+    : pos((const unsigned char *)begin), end((const unsigned char *)end) {
+  unsigned version;
+  if (!isBinaryQueryLog(begin, end)) {
+    fail("not a binary query log");
+    return;
+  }
+  pos += sizeof(logMagic) - 1;
+  if (!readUnsigned(version))
+    return;
+  if (version != logVersion)
+    fail("unsupported binary query log version");
+}
+
+bool BinaryQueryLogReader::isBinaryQueryLog(const char *begin,
+                                            const char *end) {
+  size_t length = sizeof(logMagic) - 1;
+  return (size_t)(end - begin) >= length &&
+         memcmp(begin, logMagic, length) == 0;
+}
+
+bool BinaryQueryLogReader::fail(const char *message) {
+  if (error.empty())
+    error = message;
+  pos = end;
+  return false;
+}
+
+bool BinaryQueryLogReader::readVarint(uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (pos == end)
+      return fail("truncated binary query log");
+    unsigned char byte = *pos++;
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return fail("invalid integer in binary query log");
+}
+
+bool BinaryQueryLogReader::readUnsigned(unsigned &value) {
+  uint64_t v;
+  if (!readVarint(v))
+    return false;
+  if (v > ~0U)
+    return fail("invalid integer in binary query log");
+  value = v;
+  return true;
+}
+
+bool BinaryQueryLogReader::readByte(unsigned char &value) {
+  if (pos == end)
+    return fail("truncated binary query log");
+  value = *pos++;
+  return true;
+}
+
+bool BinaryQueryLogReader::readConstant(Expr::Width width,
+                                        ref<ConstantExpr> &value) {
+  if (width == 0)
+    return fail("invalid constant in binary query log");
+  std::vector<uint64_t> words((width + 63) / 64);
+  for (unsigned i = 0, e = words.size(); i != e; ++i)
+    if (!readVarint(words[i]))
+      return false;
+  value = ConstantExpr::alloc(llvm::APInt(width, words));
+  return true;
+}
+
+bool BinaryQueryLogReader::readArrayId(const Array *&array) {
+  unsigned id;
+  if (!readUnsigned(id))
+    return false;
+  if (id >= arrays.size())
+    return fail("undefined array in binary query log");
+  array = arrays[id];
+  return true;
+}
+
+bool BinaryQueryLogReader::readExprId(ref<Expr> &e) {
+  unsigned id;
+  if (!readUnsigned(id))
+    return false;
+  if (id >= exprs.size())
+    return fail("undefined expression in binary query log");
+  e = exprs[id];
+  return true;
+}
+
+bool BinaryQueryLogReader::readArray() {
+  unsigned length, size, domain, range, numConstants;
+  if (!readUnsigned(length))
+    return false;
+  if ((size_t)(end - pos) < length)
+    return fail("truncated binary query log");
+  std::string name((const char *)pos, length);
+  pos += length;
+  if (!readUnsigned(size) || !readUnsigned(domain) || !readUnsigned(range) ||
+      !readUnsigned(numConstants))
+    return false;
+  if (numConstants && numConstants != size)
+    return fail("invalid array in binary query log");
+
+  std::vector<ref<ConstantExpr> > constants(numConstants);
+  for (unsigned i = 0; i != numConstants; ++i)
+    if (!readConstant(range, constants[i]))
+      return false;
+  if (constants.empty())
+    arrays.push_back(
+        arrayCache.CreateArray(name, size, 0, 0, domain, range));
+  else
+    arrays.push_back(arrayCache.CreateArray(
+        name, size, &constants[0], &constants[0] + numConstants, domain,
+        range));
+  return true;
+}
+
+bool BinaryQueryLogReader::readUpdate() {
+  unsigned next;
+  ref<Expr> index, value;
+  if (!readUnsigned(next) || !readExprId(index) || !readExprId(value))
+    return false;
+  if (next > updates.size())
+    return fail("undefined update in binary query log");
+
+  UpdateList list(0, next ? updates[next - 1].head : 0);
+  list.extend(index, value);
+  updates.push_back(list);
+  return true;
+}
+
+bool BinaryQueryLogReader::readExpr(unsigned kind) {
+  if (kind > Expr::LastKind || kind == Expr::NotOptimized + 1)
+    return fail("invalid expression in binary query log");
+
+  unsigned width = 0, offset = 0;
+  const Array *array = 0;
+  unsigned head = 0;
+  ref<ConstantExpr> constant;
+  switch (kind) {
+  case Expr::Constant:
+    if (!readUnsigned(width) || !readConstant(width, constant))
+      return false;
+    exprs.push_back(constant);
+    return true;
+  case Expr::Read:
+    if (!readArrayId(array) || !readUnsigned(head))
+      return false;
+    if (head > updates.size())
+      return fail("undefined update in binary query log");
+    break;
+  case Expr::Extract:
+    if (!readUnsigned(offset) || !readUnsigned(width))
+      return false;
+    break;
+  case Expr::ZExt:
+  case Expr::SExt:
+    if (!readUnsigned(width))
+      return false;
+    break;
+  default:
+    break;
+  }
+
+  ref<Expr> kids[3];
+  for (unsigned i = 0, e = getNumKids(kind); i != e; ++i) {
+    unsigned distance;
+    if (!readUnsigned(distance))
+      return false;
+    if (distance == 0 || distance > exprs.size())
+      return fail("undefined expression in binary query log");
+    kids[i] = exprs[exprs.size() - distance];
+  }
+
+  // The expressions are rebuilt as they were logged, without simplification
+  ref<Expr> e;
+  switch (kind) {
+  case Expr::NotOptimized:
+    e = NotOptimizedExpr::alloc(kids[0]);
+    break;
+  case Expr::Read:
+    e = ReadExpr::alloc(
+        UpdateList(array, head ? updates[head - 1].head : 0), kids[0]);
+    break;
+  case Expr::Select:
+    e = SelectExpr::alloc(kids[0], kids[1], kids[2]);
+    break;
+  case Expr::Concat:
+    e = ConcatExpr::alloc(kids[0], kids[1]);
+    break;
+  case Expr::Extract:
+    e = ExtractExpr::alloc(kids[0], offset, width);
+    break;
+  case Expr::ZExt:
+    e = ZExtExpr::alloc(kids[0], width);
+    break;
+  case Expr::SExt:
+    e = SExtExpr::alloc(kids[0], width);
+    break;
+  case Expr::Not:
+    e = NotExpr::alloc(kids[0]);
+    break;
+#define BINARY_EXPR_CASE(_class_kind)                                          \
+  case Expr::_class_kind:                                                      \
+    e = _class_kind##Expr::alloc(kids[0], kids[1]);                            \
+    break;
+  BINARY_EXPR_CASE(Add)
+  BINARY_EXPR_CASE(Sub)
+  BINARY_EXPR_CASE(Mul)
+  BINARY_EXPR_CASE(UDiv)
+  BINARY_EXPR_CASE(SDiv)
+  BINARY_EXPR_CASE(URem)
+  BINARY_EXPR_CASE(SRem)
+  BINARY_EXPR_CASE(And)
+  BINARY_EXPR_CASE(Or)
+  BINARY_EXPR_CASE(Xor)
+  BINARY_EXPR_CASE(Shl)
+  BINARY_EXPR_CASE(LShr)
+  BINARY_EXPR_CASE(AShr)
+  BINARY_EXPR_CASE(Eq)
+  BINARY_EXPR_CASE(Ne)
+  BINARY_EXPR_CASE(Ult)
+  BINARY_EXPR_CASE(Ule)
+  BINARY_EXPR_CASE(Ugt)
+  BINARY_EXPR_CASE(Uge)
+  BINARY_EXPR_CASE(Slt)
+  BINARY_EXPR_CASE(Sle)
+  BINARY_EXPR_CASE(Sgt)
+  BINARY_EXPR_CASE(Sge)
+#undef BINARY_EXPR_CASE
+  default:
+    return fail("invalid expression in binary query log");
+  }
+  exprs.push_back(e);
+  return true;
+}
+
+bool BinaryQueryLogReader::readQuery(BinaryQueryLogRecord &record) {
+  unsigned char kind, success, status;
+  if (!readByte(kind) || !readByte(success) || !readByte(status))
+    return false;
+  if (kind > BinaryQueryLogRecord::InitialValues ||
+      status > SolverImpl::SOLVER_RUN_STATUS_WAITPID_FAILED)
+    return fail("invalid query in binary query log");
+  record.kind = (BinaryQueryLogRecord::Kind)kind;
+  record.success = success;
+  record.status = (SolverImpl::SolverRunStatus)status;
+
+  if ((size_t)(end - pos) < 8)
+    return fail("truncated binary query log");
+  uint64_t time = 0;
+  for (unsigned i = 0; i != 8; ++i)
+    time |= (uint64_t)*pos++ << (8 * i);
+  memcpy(&record.time, &time, sizeof(time));
+
+  unsigned numConstraints;
+  if (!readVarint(record.instructions) || !readUnsigned(numConstraints))
+    return false;
+  record.constraints.resize(numConstraints);
+  for (unsigned i = 0; i != numConstraints; ++i)
+    if (!readExprId(record.constraints[i]))
+      return false;
+  if (!readExprId(record.expr))
+    return false;
+
+  record.objects.clear();
+  if (record.kind == BinaryQueryLogRecord::InitialValues) {
+    unsigned numObjects;
+    if (!readUnsigned(numObjects))
+      return false;
+    record.objects.resize(numObjects);
+    for (unsigned i = 0; i != numObjects; ++i)
+      if (!readArrayId(record.objects[i]))
+        return false;
+  }
+
+  record.values.clear();
+  if (!record.success)
+    return true;
+  unsigned char byte;
+  switch (record.kind) {
+  case BinaryQueryLogRecord::Truth:
+    if (!readByte(byte))
+      return false;
+    record.isValid = byte;
+    break;
+  case BinaryQueryLogRecord::Validity:
+    if (!readByte(byte))
+      return false;
+    if (byte > 2)
+      return fail("invalid query in binary query log");
+    record.validity = (Solver::Validity)(byte - 1);
+    break;
+  case BinaryQueryLogRecord::Value:
+    if (!readExprId(record.value))
+      return false;
+    break;
+  case BinaryQueryLogRecord::InitialValues:
+    if (!readByte(byte))
+      return false;
+    record.hasSolution = byte;
+    if (record.hasSolution) {
+      record.values.resize(record.objects.size());
+      for (unsigned i = 0, e = record.objects.size(); i != e; ++i) {
+        unsigned size;
+        if (!readUnsigned(size))
+          return false;
+        if ((size_t)(end - pos) < size)
+          return fail("truncated binary query log");
+        record.values[i].assign(pos, pos + size);
+        pos += size;
+      }
+    }
+    break;
+  }
+  return true;
+}
+
+bool BinaryQueryLogReader::next(BinaryQueryLogRecord &record) {
+  while (pos != end) {
+    unsigned char tag = *pos++;
+    bool success;
+    switch (tag) {
+    case ArrayTag:
+      success = readArray();
+      break;
+    case UpdateTag:
+      success = readUpdate();
+      break;
+    case QueryTag:
+      return readQuery(record);
+    case ResetTag:
+      arrays.clear();
+      updates.clear();
+      exprs.clear();
+      success = true;
+      break;
+    default:
+      if (tag < ExprTag)
+        return fail("invalid record in binary query log");
+      success = readExpr(tag - ExprTag);
+      break;
+    }
+    if (!success)
+      return false;
+  }
+  return false;
+}
@@ -0,0 +1,170 @@
+//===-- BinaryQueryLoggingSolver.cpp --------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Logs queries in the binary query log format. Unlike the text logging
+// solvers, queries are serialized after the solver returns, out of the timed
+// region, and the log is written to disk by a background thread.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/SolverImpl.h"
+#include "klee/Statistics.h"
+#include "klee/Internal/Support/AsyncFileWriter.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/util/BinaryQueryLog.h"
+
+using namespace klee;
+
+namespace {
+
+/// Size of the records buffered before they are handed to the writer thread
+const size_t logChunkSize = 64 << 10;
+
+class BinaryQueryLoggingSolver : public SolverImpl {
+  Solver *solver;
+  std::string path;
+  int minQueryTimeToLog;
+
+  BinaryQueryLogWriter log;
+  /// Records not yet handed to the writer thread
+  std::string buffer;
+  AsyncFileWriter writer;
+
+  double startTime;
+
+  void startQuery(BinaryQueryLogRecord &record,
+                  BinaryQueryLogRecord::Kind kind, const Query &query);
+  void finishQuery(BinaryQueryLogRecord &record, bool success);
+
+public:
+  BinaryQueryLoggingSolver(Solver *_solver, const std::string &_path,
+                           int queryTimeToLog);
+  ~BinaryQueryLoggingSolver();
+
+  bool computeTruth(const Query &query, bool &isValid);
+  bool computeValidity(const Query &query, Solver::Validity &result);
+  bool computeValue(const Query &query, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+BinaryQueryLoggingSolver::BinaryQueryLoggingSolver(Solver *_solver,
+                                                   const std::string &_path,
+                                                   int queryTimeToLog)
+    : solver(_solver), path(_path), minQueryTimeToLog(queryTimeToLog),
+      startTime(0) {
+  assert(0 != solver);
+  BinaryQueryLogWriter::writeHeader(buffer);
+  writer.write(path, buffer);
+  // Report an unwritable log now rather than with the first queries
+  writer.flush();
+}
+
+BinaryQueryLoggingSolver::~BinaryQueryLoggingSolver() {
+  writer.append(path, buffer);
+  delete solver;
+}
+
+void BinaryQueryLoggingSolver::startQuery(BinaryQueryLogRecord &record,
+                                          BinaryQueryLogRecord::Kind kind,
+                                          const Query &query) {
+  Statistic *S = theStatisticManager->getStatisticByName("Instructions");
+  record.kind = kind;
+  record.instructions = S ? S->getValue() : 0;
+  record.constraints.assign(query.constraints.begin(),
+                            query.constraints.end());
+  record.expr = query.expr;
+  startTime = util::getWallTime();
+}
+
+void BinaryQueryLoggingSolver::finishQuery(BinaryQueryLogRecord &record,
+                                           bool success) {
+  record.time = util::getWallTime() - startTime;
+  record.success = success;
+  record.status = solver->impl->getOperationStatusCode();
+
+  // Same selection as the text logging solvers
+  if (minQueryTimeToLog != 0 &&
+      static_cast<int>(record.time * 1000) <= minQueryTimeToLog)
+    return;
+  if (minQueryTimeToLog < 0 &&
+      record.status != SOLVER_RUN_STATUS_TIMEOUT)
+    return;
+
+  log.write(record, buffer);
+  if (buffer.size() >= logChunkSize)
+    writer.append(path, buffer);
+}
+
+bool BinaryQueryLoggingSolver::computeTruth(const Query &query,
+                                            bool &isValid) {
+  BinaryQueryLogRecord record;
+  startQuery(record, BinaryQueryLogRecord::Truth, query);
+  bool success = solver->impl->computeTruth(query, isValid);
+  record.isValid = isValid;
+  finishQuery(record, success);
+  return success;
+}
+
+bool BinaryQueryLoggingSolver::computeValidity(const Query &query,
+                                               Solver::Validity &result) {
+  BinaryQueryLogRecord record;
+  startQuery(record, BinaryQueryLogRecord::Validity, query);
+  bool success = solver->impl->computeValidity(query, result);
+  record.validity = result;
+  finishQuery(record, success);
+  return success;
+}
+
+bool BinaryQueryLoggingSolver::computeValue(const Query &query,
+                                            ref<Expr> &result) {
+  BinaryQueryLogRecord record;
+  startQuery(record, BinaryQueryLogRecord::Value, query);
+  bool success = solver->impl->computeValue(query, result);
+  record.value = result;
+  finishQuery(record, success);
+  return success;
+}
+
+bool BinaryQueryLoggingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  BinaryQueryLogRecord record;
+  startQuery(record, BinaryQueryLogRecord::InitialValues, query);
+  bool success =
+      solver->impl->computeInitialValues(query, objects, values, hasSolution);
+  record.hasSolution = hasSolution;
+  record.objects = objects;
+  if (success && hasSolution)
+    record.values = values;
+  finishQuery(record, success);
+  return success;
+}
+
+}
+
+Solver *klee::createBinaryQueryLoggingSolver(Solver *_solver, std::string path,
+                                             int minQueryTimeToLog) {
+  return new Solver(
+      new BinaryQueryLoggingSolver(_solver, path, minQueryTimeToLog));
+}
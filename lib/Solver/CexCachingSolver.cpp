@@ -14,9 +14,10 @@
 #include "klee/SolverImpl.h"
 #include "klee/TimerStatIncrementer.h"
 #include "klee/util/Assignment.h"
+#include "klee/util/ExprHashMap.h"
 #include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
-#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/SetIndex.h"
 
 #include "klee/SolverStats.h"
 
@@ -48,7 +49,12 @@ namespace {
 
 ///
 
-typedef std::set< ref<Expr> > KeyType;
+/// The key of a query: its constraints and negated expression, along with
+/// their ids in the cache index.
+struct KeyType {
+  std::vector< ref<Expr> > exprs;
+  SetIndex<Assignment*>::key_ty ids;
+};
 
 struct AssignmentLessThan {
   bool operator()(const Assignment *a, const Assignment *b) {
@@ -62,10 +68,14 @@ class CexCachingSolver : public SolverImpl {
 
   Solver *solver;
   
-  MapOfSets<ref<Expr>, Assignment*> cache;
+  SetIndex<Assignment*> cache;
+  // ids of the expressions in cache keys
+  ExprHashMap<unsigned> exprIds;
   // memo table
   assignmentsTable_ty assignmentsTable;
 
+  void addToKey(KeyType &key, ref<Expr> e);
+
   bool searchForAssignment(KeyType &key, 
                            Assignment *&result);
   
@@ -110,10 +120,19 @@ struct NullOrSatisfyingAssignment {
   NullOrSatisfyingAssignment(KeyType &_key) : key(_key) {}
 
   bool operator()(Assignment *a) const { 
-    return !a || a->satisfies(key.begin(), key.end()); 
+    return !a || a->satisfies(key.exprs.begin(), key.exprs.end()); 
   }
 };
 
+/// addToKey - Add an expression to a key under construction, interning it if
+/// needed.
+void CexCachingSolver::addToKey(KeyType &key, ref<Expr> e) {
+  std::pair<ExprHashMap<unsigned>::iterator, bool> res =
+      exprIds.insert(std::make_pair(e, (unsigned)exprIds.size()));
+  key.exprs.push_back(e);
+  key.ids.push_back(res.first->second);
+}
+
 /// searchForAssignment - Look for a cached solution for a query.
 ///
 /// \param key - The query to look up.
@@ -122,7 +141,7 @@ struct NullOrSatisfyingAssignment {
 /// unsatisfiable query).
 /// \return - True if a cached result was found.
 bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
-  Assignment * const *lookup = cache.lookup(key);
+  Assignment * const *lookup = cache.lookup(key.ids);
   if (lookup) {
     result = *lookup;
     return true;
@@ -133,11 +152,11 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // assignment for any subset.
     Assignment **lookup = 0;
     if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+      lookup = cache.findSuperset(key.ids, NonNullAssignment());
 
     // Otherwise, look for a subset which is unsatisfiable, see below.
     if (!lookup) 
-      lookup = cache.findSubset(key, NullAssignment());
+      lookup = cache.findSubset(key.ids, NullAssignment());
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
@@ -150,7 +169,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
            ie = assignmentsTable.end(); it != ie; ++it) {
       Assignment *a = *it;
-      if (a->satisfies(key.begin(), key.end())) {
+      if (a->satisfies(key.exprs.begin(), key.exprs.end())) {
         result = a;
         return true;
       }
@@ -162,7 +181,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // assignment for any subset.
     Assignment **lookup = 0;
     if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+      lookup = cache.findSuperset(key.ids, NonNullAssignment());
 
     // Otherwise, look for a subset which is unsatisfiable -- if the subset is
     // unsatisfiable then no additional constraints can produce a valid
@@ -170,7 +189,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // satisfiable subsets to see if they solve the current query and return
     // them if so. This is cheap and frequently succeeds.
     if (!lookup) 
-      lookup = cache.findSubset(key, NullOrSatisfyingAssignment(key));
+      lookup = cache.findSubset(key.ids, NullOrSatisfyingAssignment(key));
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
@@ -193,7 +212,10 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
 bool CexCachingSolver::lookupAssignment(const Query &query, 
                                         KeyType &key,
                                         Assignment *&result) {
-  key = KeyType(query.constraints.begin(), query.constraints.end());
+  key = KeyType();
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+         ie = query.constraints.end(); it != ie; ++it)
+    addToKey(key, *it);
   ref<Expr> neg = Expr::createIsZero(query.expr);
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(neg)) {
     if (CE->isFalse()) {
@@ -202,8 +224,10 @@ bool CexCachingSolver::lookupAssignment(const Query &query,
       return true;
     }
   } else {
-    key.insert(neg);
+    addToKey(key, neg);
   }
+  std::sort(key.ids.begin(), key.ids.end());
+  key.ids.erase(std::unique(key.ids.begin(), key.ids.end()), key.ids.end());
 
   bool found = searchForAssignment(key, result);
   if (found)
@@ -219,7 +243,7 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
     return true;
 
   std::vector<const Array*> objects;
-  findSymbolicObjects(key.begin(), key.end(), objects);
+  findSymbolicObjects(key.exprs.begin(), key.exprs.end(), objects);
 
   std::vector< std::vector<unsigned char> > values;
   bool hasSolution;
@@ -240,7 +264,7 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
     }
     
     if (DebugCexCacheCheckBinding)
-      if (!binding->satisfies(key.begin(), key.end())) {
+      if (!binding->satisfies(key.exprs.begin(), key.exprs.end())) {
         query.dump();
         binding->dump();
         klee_error("Generated assignment doesn't match query");
@@ -250,7 +274,7 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
   }
   
   result = binding;
-  cache.insert(key, binding);
+  cache.insert(key.ids, binding);
 
   return true;
 }
@@ -13,6 +13,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include <string>
+#include <vector>
 
 #ifdef ENABLE_METASMT
 
@@ -90,6 +91,34 @@ Solver *createCoreSolver(CoreSolverType cst) {
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER: {
+    std::vector<CoreSolverType> types(SolverPortfolio.begin(),
+                                      SolverPortfolio.end());
+    if (types.empty()) {
+      types.push_back(STP_SOLVER);
+      types.push_back(Z3_SOLVER);
+    }
+    std::vector<Solver *> solvers;
+    std::vector<CoreSolverType> available;
+    for (unsigned i = 0; i < types.size(); ++i) {
+      if (types[i] == PORTFOLIO_SOLVER)
+        continue;
+      if (Solver *s = createCoreSolver(types[i])) {
+        solvers.push_back(s);
+        available.push_back(types[i]);
+      }
+    }
+    if (solvers.empty()) {
+      klee_message("No solver available for the portfolio");
+      return NULL;
+    }
+    // Racing a single solver only adds the cost of forking
+    if (solvers.size() == 1)
+      return solvers[0];
+    klee_message("Using portfolio of %u solver backends",
+                 (unsigned)solvers.size());
+    return createPortfolioSolver(solvers, available);
+  }
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
@@ -264,6 +264,23 @@ static std::list<IndependentElementSet>*
 getAllIndependentConstraintsSets(const Query &query) {
   std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
   ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
+
+  // Constraints of an execution state are partitioned as they are added
+  if (query.constraints.hasFactors()) {
+    ref<Expr> neg;
+    if (!CE)
+      neg = Expr::createIsZero(query.expr);
+    std::vector< std::vector< ref<Expr> > > exprs;
+    query.constraints.getIndependentFactors(neg, exprs);
+    for (unsigned i = 0; i != exprs.size(); ++i) {
+      IndependentElementSet factor(exprs[i][0]);
+      for (unsigned j = 1; j < exprs[i].size(); ++j)
+        factor.add(IndependentElementSet(exprs[i][j]));
+      factors->push_back(factor);
+    }
+    return factors;
+  }
+
   if (CE) {
     assert(CE && CE->isFalse() && "the expr should always be false and "
                                   "therefore not included in factors");
@@ -320,9 +337,15 @@ getAllIndependentConstraintsSets(const Query &query) {
   return factors;
 }
 
-static 
-IndependentElementSet getIndependentConstraints(const Query& query,
-                                                std::vector< ref<Expr> > &result) {
+static
+void getIndependentConstraints(const Query& query,
+                               std::vector< ref<Expr> > &result) {
+  // Constraints of an execution state are partitioned as they are added
+  if (query.constraints.hasFactors()) {
+    query.constraints.getIndependentConstraints(query.expr, result);
+    return;
+  }
+
   IndependentElementSet eltsClosure(query.expr);
   std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
 
@@ -364,9 +387,6 @@ IndependentElementSet getIndependentConstraints(const Query& query,
     }
     errs() << "elts closure: " << eltsClosure << "\n";
  );
-
-
-  return eltsClosure;
 }
 
 
@@ -414,8 +434,7 @@ public:
 bool IndependentSolver::computeValidity(const Query& query,
                                         Solver::Validity &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure =
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValidity(Query(tmp, query.expr), 
                                        result);
@@ -423,8 +442,7 @@ bool IndependentSolver::computeValidity(const Query& query,
 
 bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeTruth(Query(tmp, query.expr), 
                                     isValid);
@@ -432,8 +450,7 @@ bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
 
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValue(Query(tmp, query.expr), result);
 }
@@ -0,0 +1,533 @@
+//===-- PersistentCachingSolver.cpp -----------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A query cache kept in a memory mapped file, so that answers survive the
+// process and are shared by all klee and kleaver runs using the same file.
+//
+// Queries are keyed by a 128-bit structural hash which does not depend on
+// addresses, and in which the constraints are hashed as a set. The file holds
+// an index of buckets followed by a data region used as a ring buffer: new
+// records overwrite the oldest ones, which bounds the size of the cache. A
+// bucket whose record has been overwritten is treated as empty.
+//
+// Concurrent processes serialize their accesses with flock(), shared for
+// lookups and exclusive for insertions. Each record repeats its key and
+// carries a checksum, so records left incomplete by a killed process are
+// ignored.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+const uint64_t cacheMagic = 0x4b4c454551434143ULL; // "KLEEQCAC"
+const uint32_t cacheVersion = 1;
+
+/// Number of consecutive buckets a key may be stored in
+const unsigned bucketProbes = 8;
+
+/// A 128-bit key; two independently seeded 64-bit hashes
+struct CacheKey {
+  uint64_t h[2];
+
+  bool operator==(const CacheKey &b) const {
+    return h[0] == b.h[0] && h[1] == b.h[1];
+  }
+  bool operator<(const CacheKey &b) const {
+    return h[0] < b.h[0] || (h[0] == b.h[0] && h[1] < b.h[1]);
+  }
+};
+
+struct CacheHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t numBuckets;
+  uint64_t dataSize;
+  /// Logical position of the next record in the data region; it only grows,
+  /// the physical offset is taken modulo dataSize.
+  uint64_t writePos;
+};
+
+struct CacheBucket {
+  CacheKey key;
+  uint64_t position;
+  uint32_t length; ///< 0 for an empty bucket
+  uint32_t unused;
+};
+
+struct RecordHeader {
+  CacheKey key;
+  uint32_t length; ///< Length of the payload
+  uint32_t checksum;
+};
+
+/// Kind of answer stored in a record; also part of the key
+enum RecordKind { TRUTH_RECORD = 1, VALUE_RECORD, INITIAL_VALUES_RECORD };
+
+uint32_t checksum(const unsigned char *data, size_t length) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; ++i)
+    h = (h ^ data[i]) * 16777619u;
+  return h;
+}
+
+/// Incrementally hashes values into a CacheKey
+class KeyBuilder {
+  CacheKey key;
+
+  static uint64_t mix(uint64_t h, uint64_t v, uint64_t m) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h *= m;
+    return h ^ (h >> 31);
+  }
+
+public:
+  KeyBuilder() {
+    key.h[0] = 0xcbf29ce484222325ULL;
+    key.h[1] = 0x84222325cbf29ce4ULL;
+  }
+
+  KeyBuilder &add(uint64_t v) {
+    key.h[0] = mix(key.h[0], v, 0xff51afd7ed558ccdULL);
+    key.h[1] = mix(key.h[1], v, 0xc4ceb9fe1a85ec53ULL);
+    return *this;
+  }
+  KeyBuilder &add(const CacheKey &k) { return add(k.h[0]).add(k.h[1]); }
+  KeyBuilder &add(const std::string &s) {
+    add(s.size());
+    for (unsigned i = 0; i < s.size(); ++i)
+      add((unsigned char)s[i]);
+    return *this;
+  }
+
+  const CacheKey &get() const { return key; }
+};
+
+class PersistentCachingSolver : public SolverImpl {
+  Solver *solver;
+  int fd;
+  unsigned char *memory;
+  size_t mappedSize;
+
+  /// Hashes of the expressions seen so far
+  ExprHashMap<CacheKey> exprKeys;
+
+  CacheHeader *header() { return (CacheHeader *)memory; }
+  CacheBucket *buckets() {
+    return (CacheBucket *)(memory + sizeof(CacheHeader));
+  }
+  unsigned char *data() {
+    return memory + sizeof(CacheHeader) +
+           header()->numBuckets * sizeof(CacheBucket);
+  }
+
+  bool open(const std::string &path, size_t size);
+  bool recordIsLive(const CacheBucket &b);
+
+  CacheKey exprKey(const ref<Expr> &e);
+  CacheKey updateKey(const UpdateNode *un);
+  CacheKey arrayKey(const Array *array);
+  CacheKey queryKey(RecordKind kind, const Query &query,
+                    const std::vector<const Array *> *objects);
+
+  bool lookup(const CacheKey &key, std::vector<unsigned char> &payload);
+  void insert(const CacheKey &key, const std::vector<unsigned char> &payload);
+
+public:
+  PersistentCachingSolver(Solver *_solver, const std::string &path,
+                          size_t size);
+  ~PersistentCachingSolver();
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+PersistentCachingSolver::PersistentCachingSolver(Solver *_solver,
+                                                 const std::string &path,
+                                                 size_t size)
+    : solver(_solver), fd(-1), memory(0), mappedSize(0) {
+  if (!open(path, size)) {
+    klee_warning("unable to open persistent query cache %s: %s", path.c_str(),
+                 strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+  }
+}
+
+PersistentCachingSolver::~PersistentCachingSolver() {
+  if (memory)
+    munmap(memory, mappedSize);
+  if (fd >= 0)
+    close(fd);
+  delete solver;
+}
+
+bool PersistentCachingSolver::open(const std::string &path, size_t size) {
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+
+  // Creating or resizing the file excludes all other users
+  if (flock(fd, LOCK_EX) < 0)
+    return false;
+
+  CacheHeader existing;
+  ssize_t r = pread(fd, &existing, sizeof(existing), 0);
+  struct stat st;
+  bool valid = r == sizeof(existing) && existing.magic == cacheMagic &&
+               existing.version == cacheVersion && fstat(fd, &st) == 0;
+  if (valid) {
+    // A cache created with another size keeps its geometry
+    size = sizeof(CacheHeader) + existing.numBuckets * sizeof(CacheBucket) +
+           existing.dataSize;
+    valid = (size_t)st.st_size == size;
+  }
+
+  if (!valid) {
+    if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0) {
+      flock(fd, LOCK_UN);
+      return false;
+    }
+  }
+
+  mappedSize = size;
+  void *m = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (m == MAP_FAILED) {
+    flock(fd, LOCK_UN);
+    return false;
+  }
+  memory = (unsigned char *)m;
+
+  if (!valid) {
+    // An eighth of the file indexes the records in the rest of it
+    uint32_t numBuckets = std::max<size_t>(
+        bucketProbes, size / 8 / sizeof(CacheBucket));
+    CacheHeader *h = header();
+    h->numBuckets = numBuckets;
+    h->dataSize = size - sizeof(CacheHeader) - numBuckets * sizeof(CacheBucket);
+    h->writePos = 0;
+    h->version = cacheVersion;
+    h->magic = cacheMagic;
+  }
+
+  flock(fd, LOCK_UN);
+  return true;
+}
+
+bool PersistentCachingSolver::recordIsLive(const CacheBucket &b) {
+  return b.length != 0 && header()->writePos <= b.position + header()->dataSize;
+}
+
+CacheKey PersistentCachingSolver::arrayKey(const Array *array) {
+  KeyBuilder k;
+  k.add(array->name).add(array->size).add(array->domain).add(array->range);
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    k.add(exprKey(array->constantValues[i]));
+  return k.get();
+}
+
+CacheKey PersistentCachingSolver::updateKey(const UpdateNode *un) {
+  // Update lists can be long, so they are hashed from the oldest update on
+  // without recursing.
+  std::vector<const UpdateNode *> nodes;
+  for (; un; un = un->next)
+    nodes.push_back(un);
+
+  KeyBuilder k;
+  k.add(nodes.size());
+  for (std::vector<const UpdateNode *>::reverse_iterator it = nodes.rbegin(),
+                                                         ie = nodes.rend();
+       it != ie; ++it)
+    k.add(exprKey((*it)->index)).add(exprKey((*it)->value));
+  return k.get();
+}
+
+CacheKey PersistentCachingSolver::exprKey(const ref<Expr> &e) {
+  ExprHashMap<CacheKey>::iterator it = exprKeys.find(e);
+  if (it != exprKeys.end())
+    return it->second;
+
+  KeyBuilder k;
+  k.add(e->getKind()).add(e->getWidth());
+  if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+    const llvm::APInt &v = ce->getAPValue();
+    for (unsigned i = 0; i < v.getNumWords(); ++i)
+      k.add(v.getRawData()[i]);
+  } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    k.add(arrayKey(re->updates.root)).add(updateKey(re->updates.head));
+  } else if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e)) {
+    k.add(ee->offset);
+  }
+  for (unsigned i = 0; i < e->getNumKids(); ++i)
+    k.add(exprKey(e->getKid(i)));
+
+  exprKeys.insert(std::make_pair(e, k.get()));
+  return k.get();
+}
+
+CacheKey
+PersistentCachingSolver::queryKey(RecordKind kind, const Query &query,
+                                  const std::vector<const Array *> *objects) {
+  // The memo holds references to every expression hashed; drop it from time
+  // to time instead of keeping all of them alive.
+  if (exprKeys.size() > (1 << 18))
+    exprKeys.clear();
+
+  // Constraints are hashed as a set, independently of their order
+  std::vector<CacheKey> constraints;
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                         ie = query.constraints.end();
+       it != ie; ++it)
+    constraints.push_back(exprKey(*it));
+  std::sort(constraints.begin(), constraints.end());
+  constraints.erase(std::unique(constraints.begin(), constraints.end()),
+                    constraints.end());
+
+  KeyBuilder k;
+  k.add(kind).add(constraints.size());
+  for (unsigned i = 0; i < constraints.size(); ++i)
+    k.add(constraints[i]);
+  k.add(exprKey(query.expr));
+  if (objects) {
+    k.add(objects->size());
+    for (unsigned i = 0; i < objects->size(); ++i)
+      k.add(arrayKey((*objects)[i]));
+  }
+  return k.get();
+}
+
+bool PersistentCachingSolver::lookup(const CacheKey &key,
+                                     std::vector<unsigned char> &payload) {
+  if (!memory)
+    return false;
+
+  bool found = false;
+  flock(fd, LOCK_SH);
+  CacheHeader *h = header();
+  for (unsigned i = 0; i < bucketProbes && !found; ++i) {
+    CacheBucket &b = buckets()[(key.h[0] + i) % h->numBuckets];
+    if (!(b.key == key) || !recordIsLive(b))
+      continue;
+
+    const unsigned char *record = data() + b.position % h->dataSize;
+    RecordHeader rh;
+    memcpy(&rh, record, sizeof(rh));
+    if (!(rh.key == key) || rh.length + sizeof(RecordHeader) != b.length)
+      continue;
+    const unsigned char *p = record + sizeof(RecordHeader);
+    if (checksum(p, rh.length) != rh.checksum)
+      continue;
+    payload.assign(p, p + rh.length);
+    found = true;
+  }
+  flock(fd, LOCK_UN);
+  return found;
+}
+
+void PersistentCachingSolver::insert(const CacheKey &key,
+                                     const std::vector<unsigned char> &payload) {
+  if (!memory)
+    return;
+
+  CacheHeader *h = header();
+  uint64_t length = sizeof(RecordHeader) + payload.size();
+  if (length > h->dataSize / 4)
+    return;
+
+  flock(fd, LOCK_EX);
+
+  // Replace the same key, a dead record, or else the oldest record among
+  // the buckets the key may be stored in.
+  CacheBucket *target = 0;
+  for (unsigned i = 0; i < bucketProbes; ++i) {
+    CacheBucket &b = buckets()[(key.h[0] + i) % h->numBuckets];
+    if (b.key == key || !recordIsLive(b)) {
+      target = &b;
+      break;
+    }
+    if (!target || b.position < target->position)
+      target = &b;
+  }
+
+  // Records never wrap around the end of the data region
+  uint64_t pos = h->writePos;
+  if (pos % h->dataSize + length > h->dataSize)
+    pos += h->dataSize - pos % h->dataSize;
+
+  // Invalidate the bucket before its record is written, and publish the
+  // record only once complete.
+  target->length = 0;
+  h->writePos = pos + length;
+
+  RecordHeader rh;
+  rh.key = key;
+  rh.length = payload.size();
+  rh.checksum = checksum(payload.empty() ? 0 : &payload[0], payload.size());
+  unsigned char *record = data() + pos % h->dataSize;
+  memcpy(record, &rh, sizeof(rh));
+  if (!payload.empty())
+    memcpy(record + sizeof(rh), &payload[0], payload.size());
+
+  target->key = key;
+  target->position = pos;
+  target->length = length;
+
+  flock(fd, LOCK_UN);
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query, bool &isValid) {
+  CacheKey key;
+  {
+    TimerStatIncrementer t(stats::persistentCacheTime);
+    key = queryKey(TRUTH_RECORD, query, 0);
+    std::vector<unsigned char> payload;
+    if (lookup(key, payload) && payload.size() == 1) {
+      ++stats::queryPersistentCacheHits;
+      isValid = payload[0];
+      return true;
+    }
+  }
+  ++stats::queryPersistentCacheMisses;
+
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+
+  TimerStatIncrementer t(stats::persistentCacheTime);
+  insert(key, std::vector<unsigned char>(1, isValid));
+  return true;
+}
+
+bool PersistentCachingSolver::computeValue(const Query &query,
+                                           ref<Expr> &result) {
+  Expr::Width width = query.expr->getWidth();
+  // Only values fitting in 64 bits are cached
+  if (width > 64)
+    return solver->impl->computeValue(query, result);
+
+  CacheKey key;
+  {
+    TimerStatIncrementer t(stats::persistentCacheTime);
+    key = queryKey(VALUE_RECORD, query, 0);
+    std::vector<unsigned char> payload;
+    if (lookup(key, payload) && payload.size() == sizeof(uint64_t)) {
+      ++stats::queryPersistentCacheHits;
+      uint64_t value;
+      memcpy(&value, &payload[0], sizeof(value));
+      result = ConstantExpr::create(value, width);
+      return true;
+    }
+  }
+  ++stats::queryPersistentCacheMisses;
+
+  if (!solver->impl->computeValue(query, result))
+    return false;
+
+  if (ConstantExpr *ce = dyn_cast<ConstantExpr>(result)) {
+    TimerStatIncrementer t(stats::persistentCacheTime);
+    uint64_t value = ce->getZExtValue();
+    std::vector<unsigned char> payload(sizeof(value));
+    memcpy(&payload[0], &value, sizeof(value));
+    insert(key, payload);
+  }
+  return true;
+}
+
+bool PersistentCachingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  size_t total = 0;
+  for (unsigned i = 0; i < objects.size(); ++i)
+    total += objects[i]->size;
+
+  CacheKey key;
+  {
+    TimerStatIncrementer t(stats::persistentCacheTime);
+    key = queryKey(INITIAL_VALUES_RECORD, query, &objects);
+    std::vector<unsigned char> payload;
+    // The payload is the solution flag followed by the values of the
+    // objects, if any, in order.
+    if (lookup(key, payload) && !payload.empty() &&
+        payload.size() == 1 + (payload[0] ? total : 0)) {
+      ++stats::queryPersistentCacheHits;
+      hasSolution = payload[0];
+      values.clear();
+      if (hasSolution) {
+        const unsigned char *p = &payload[1];
+        for (unsigned i = 0; i < objects.size(); ++i) {
+          values.push_back(
+              std::vector<unsigned char>(p, p + objects[i]->size));
+          p += objects[i]->size;
+        }
+      }
+      return true;
+    }
+  }
+  ++stats::queryPersistentCacheMisses;
+
+  if (!solver->impl->computeInitialValues(query, objects, values,
+                                          hasSolution))
+    return false;
+
+  TimerStatIncrementer t(stats::persistentCacheTime);
+  std::vector<unsigned char> payload(1, hasSolution);
+  if (hasSolution) {
+    for (unsigned i = 0; i < values.size(); ++i) {
+      // Some solvers leave unconstrained arrays without a value
+      if (values[i].size() != objects[i]->size)
+        return true;
+      payload.insert(payload.end(), values[i].begin(), values[i].end());
+    }
+  }
+  insert(key, payload);
+  return true;
+}
+
+} // namespace
+
+Solver *klee::createPersistentCachingSolver(Solver *s, std::string path,
+                                            size_t size) {
+  return new Solver(new PersistentCachingSolver(s, path, size));
+}
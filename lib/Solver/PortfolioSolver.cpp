@@ -0,0 +1,331 @@
+//===-- PortfolioSolver.cpp -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A core solver that races several backends on every query and takes the
+// answer of the first one to finish.
+//
+// Expressions are reference counted without synchronization, so the backends
+// cannot safely build their queries on threads sharing the expression DAG.
+// Instead, as with the forked STP solver, each backend runs in a forked child
+// process which reports its answer through shared memory. The parent kills
+// the remaining children as soon as one has answered. Each child leads a
+// process group of its own, so that a backend forking a solver process of
+// its own, such as STP, has it killed along with the child.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Statistics.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprUtil.h"
+
+#include "llvm/Support/ErrorHandling.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// Size of the shared memory slot of each backend, which holds its answer
+/// and counterexample.
+const size_t slotSize = 1 << 20;
+
+/// Answer of a backend, stored at the start of its slot. A counterexample
+/// follows, as the size and the bytes of the value of each object.
+enum PortfolioAnswer { ANSWER_FALSE = 0, ANSWER_TRUE = 1, ANSWER_FAILED = 2 };
+
+class PortfolioSolverImpl : public SolverImpl {
+  std::vector<Solver *> solvers;
+  std::vector<std::string> names;
+  std::vector<uint64_t> wins;
+  std::vector<Statistic *> winStats;
+  unsigned char *sharedMemory;
+  SolverRunStatus runStatusCode;
+
+  /// Run each backend on the query in a child process. Returns the index of
+  /// the first backend to answer, or -1 if all of them failed.
+  int race(const Query &query, const std::vector<const Array *> *objects);
+
+  /// Answer the query with the given backend, storing the answer (and the
+  /// counterexample if \arg objects is given) in \arg slot.
+  static void solve(Solver *solver, const Query &query,
+                    const std::vector<const Array *> *objects,
+                    unsigned char *slot);
+
+public:
+  PortfolioSolverImpl(const std::vector<Solver *> &_solvers,
+                      const std::vector<CoreSolverType> &types);
+  ~PortfolioSolverImpl();
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() { return runStatusCode; }
+  char *getConstraintLog(const Query &query) {
+    return solvers[0]->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    for (unsigned i = 0; i < solvers.size(); ++i)
+      solvers[i]->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+PortfolioSolverImpl::PortfolioSolverImpl(
+    const std::vector<Solver *> &_solvers,
+    const std::vector<CoreSolverType> &types)
+    : solvers(_solvers), wins(_solvers.size(), 0),
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+  assert(!solvers.empty() && "portfolio without solvers");
+  for (unsigned i = 0; i < types.size(); ++i) {
+    switch (types[i]) {
+    case STP_SOLVER:
+      names.push_back("stp");
+      winStats.push_back(&stats::portfolioWinsSTP);
+      break;
+    case Z3_SOLVER:
+      names.push_back("z3");
+      winStats.push_back(&stats::portfolioWinsZ3);
+      break;
+    case METASMT_SOLVER:
+      names.push_back("metasmt");
+      winStats.push_back(&stats::portfolioWinsMetaSMT);
+      break;
+    default:
+      names.push_back("other");
+      winStats.push_back(0);
+      break;
+    }
+  }
+
+  sharedMemory = (unsigned char *)mmap(NULL, solvers.size() * slotSize,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (sharedMemory == MAP_FAILED)
+    llvm::report_fatal_error("unable to allocate shared memory region");
+}
+
+PortfolioSolverImpl::~PortfolioSolverImpl() {
+  std::string summary;
+  for (unsigned i = 0; i < solvers.size(); ++i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s%s: %lu", i ? ", " : "", names[i].c_str(),
+             (unsigned long)wins[i]);
+    summary += buf;
+    delete solvers[i];
+  }
+  klee_message("Solver portfolio wins: %s", summary.c_str());
+  munmap(sharedMemory, solvers.size() * slotSize);
+}
+
+void PortfolioSolverImpl::solve(Solver *solver, const Query &query,
+                                const std::vector<const Array *> *objects,
+                                unsigned char *slot) {
+  unsigned char *pos = slot + 1;
+  bool answer;
+  bool success;
+
+  if (objects) {
+    std::vector<std::vector<unsigned char> > values;
+    success = solver->impl->computeInitialValues(query, *objects, values,
+                                                 answer);
+    if (success && answer) {
+      for (unsigned i = 0; i < objects->size(); ++i) {
+        uint32_t size = i < values.size() ? values[i].size() : 0;
+        memcpy(pos, &size, sizeof(size));
+        pos += sizeof(size);
+        if (size)
+          memcpy(pos, &values[i][0], size);
+        pos += size;
+      }
+    }
+  } else {
+    success = solver->impl->computeTruth(query, answer);
+  }
+
+  slot[0] = success ? (answer ? ANSWER_TRUE : ANSWER_FALSE) : ANSWER_FAILED;
+}
+
+int PortfolioSolverImpl::race(const Query &query,
+                              const std::vector<const Array *> *objects) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    klee_warning("pipe failed (for solver portfolio)");
+    return -1;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  std::vector<pid_t> pids;
+  for (unsigned i = 0; i < solvers.size(); ++i) {
+    unsigned char *slot = sharedMemory + i * slotSize;
+    slot[0] = ANSWER_FAILED;
+
+    pid_t pid = fork();
+    if (pid == -1) {
+      klee_warning("fork failed (for solver portfolio)");
+      continue;
+    }
+    if (pid == 0) {
+      setpgid(0, 0);
+      close(fds[0]);
+      solve(solvers[i], query, objects, slot);
+      unsigned char index = i;
+      ssize_t written = write(fds[1], &index, 1);
+      (void)written;
+      _exit(0);
+    }
+    // Also set by the parent, in case it kills the child before the child
+    // could set it
+    setpgid(pid, pid);
+    pids.push_back(pid);
+  }
+  close(fds[1]);
+
+  // Every child reports its index once done; the pipe reaches end of file
+  // when all children have exited, including the ones that crashed.
+  int winner = -1;
+  for (unsigned reports = 0; winner < 0 && reports < pids.size();) {
+    unsigned char index;
+    ssize_t r = read(fds[0], &index, 1);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      break;
+    ++reports;
+    if (sharedMemory[index * slotSize] != ANSWER_FAILED)
+      winner = index;
+  }
+  close(fds[0]);
+
+  for (std::vector<pid_t>::iterator it = pids.begin(), ie = pids.end();
+       it != ie; ++it) {
+    kill(-*it, SIGKILL);
+    int status;
+    while (waitpid(*it, &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+
+  if (winner >= 0) {
+    ++wins[winner];
+    if (winStats[winner])
+      ++*winStats[winner];
+  }
+  return winner;
+}
+
+bool PortfolioSolverImpl::computeTruth(const Query &query, bool &isValid) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+
+  int winner = race(query, 0);
+  if (winner < 0)
+    return false;
+
+  isValid = sharedMemory[winner * slotSize] == ANSWER_TRUE;
+  if (isValid)
+    ++stats::queriesValid;
+  else
+    ++stats::queriesInvalid;
+  runStatusCode = isValid ? SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE
+                          : SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  return true;
+}
+
+bool PortfolioSolverImpl::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool PortfolioSolverImpl::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  // Counterexamples too large for a slot are computed by the first backend
+  // alone, without racing.
+  size_t sum = 1;
+  for (std::vector<const Array *>::const_iterator it = objects.begin(),
+                                                  ie = objects.end();
+       it != ie; ++it)
+    sum += sizeof(uint32_t) + (*it)->size;
+  if (sum > slotSize) {
+    bool success = solvers[0]->impl->computeInitialValues(query, objects,
+                                                          values, hasSolution);
+    runStatusCode = solvers[0]->impl->getOperationStatusCode();
+    return success;
+  }
+
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  ++stats::queryCounterexamples;
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+
+  int winner = race(query, &objects);
+  if (winner < 0)
+    return false;
+
+  unsigned char *slot = sharedMemory + winner * slotSize;
+  // The query is asked as a validity query, so a counterexample means the
+  // negated query expression is satisfiable.
+  hasSolution = slot[0] == ANSWER_TRUE;
+  if (hasSolution) {
+    ++stats::queriesInvalid;
+    unsigned char *pos = slot + 1;
+    values.clear();
+    for (unsigned i = 0; i < objects.size(); ++i) {
+      uint32_t size;
+      memcpy(&size, pos, sizeof(size));
+      pos += sizeof(size);
+      assert(size <= objects[i]->size && "invalid counterexample");
+      values.push_back(std::vector<unsigned char>(pos, pos + size));
+      pos += size;
+    }
+  } else {
+    ++stats::queriesValid;
+  }
+  runStatusCode = hasSolution ? SOLVER_RUN_STATUS_SUCCESS_SOLVABLE
+                              : SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+  return true;
+}
+
+} // namespace
+
+Solver *klee::createPortfolioSolver(const std::vector<Solver *> &solvers,
+                                    const std::vector<CoreSolverType> &types) {
+  return new Solver(new PortfolioSolverImpl(solvers, types));
+}
@@ -0,0 +1,254 @@
+//===-- RealCachingSolver.cpp ----------------------------------*- C++ -*-====//
+//
+// The KLEE Symbolic Virtual Machine with Numerical Error Analysis Extension
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Counterexample cache and independence slicer for real-number solutions.
+//
+// The models produced by the error solver bind each array to a single real
+// value (encoded as the eight bytes of a double), so they cannot be checked by
+// evaluating the bit-vector constraints as CexCachingSolver and
+// IndependentSolver do. This solver therefore slices at whole-array
+// granularity and only applies the cache rules that hold in any domain:
+// exact hits, models of supersets, and unsatisfiable subsets.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprUtil.h"
+#include "klee/Internal/ADT/MapOfSets.h"
+
+#include <list>
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+typedef std::set<ref<Expr> > KeyType;
+
+/// RealFactor - A set of constraints which share no array with the
+/// constraints of any other factor.
+struct RealFactor {
+  std::set<const Array *> arrays;
+  KeyType exprs;
+
+  bool intersects(const std::set<const Array *> &other) const {
+    for (std::set<const Array *>::const_iterator it = other.begin(),
+                                                 ie = other.end();
+         it != ie; ++it)
+      if (arrays.count(*it))
+        return true;
+    return false;
+  }
+
+  void merge(const RealFactor &other) {
+    arrays.insert(other.arrays.begin(), other.arrays.end());
+    exprs.insert(other.exprs.begin(), other.exprs.end());
+  }
+};
+
+struct NullAssignment {
+  bool operator()(Assignment *a) const { return !a; }
+};
+
+struct NonNullAssignment {
+  bool operator()(Assignment *a) const { return a != 0; }
+};
+
+class RealCachingSolver : public SolverImpl {
+  Solver *solver;
+
+  MapOfSets<ref<Expr>, Assignment *> cache;
+  std::vector<Assignment *> assignments;
+
+  void computeFactors(const Query &query, std::list<RealFactor> &factors);
+  bool lookupAssignment(const KeyType &key, Assignment *&result);
+  bool getAssignment(const RealFactor &factor, Assignment *&result);
+
+public:
+  RealCachingSolver(Solver *_solver) : solver(_solver) {}
+  ~RealCachingSolver();
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    return solver->impl->computeTruth(query, isValid);
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+RealCachingSolver::~RealCachingSolver() {
+  cache.clear();
+  delete solver;
+  for (std::vector<Assignment *>::iterator it = assignments.begin(),
+                                           ie = assignments.end();
+       it != ie; ++it)
+    delete *it;
+}
+
+/// computeFactors - Partition the constraints of the query (together with the
+/// negated query expression) into factors that do not share any array.
+void RealCachingSolver::computeFactors(const Query &query,
+                                       std::list<RealFactor> &factors) {
+  std::vector<ref<Expr> > exprs(query.constraints.begin(),
+                                query.constraints.end());
+  ref<Expr> neg = Expr::createIsZero(query.expr);
+  if (!isa<ConstantExpr>(neg))
+    exprs.push_back(neg);
+
+  for (std::vector<ref<Expr> >::iterator it = exprs.begin(), ie = exprs.end();
+       it != ie; ++it) {
+    std::vector<const Array *> objects;
+    findSymbolicObjects(*it, objects);
+
+    RealFactor current;
+    current.arrays.insert(objects.begin(), objects.end());
+    current.exprs.insert(*it);
+
+    for (std::list<RealFactor>::iterator fit = factors.begin();
+         fit != factors.end();) {
+      if (fit->intersects(current.arrays)) {
+        current.merge(*fit);
+        fit = factors.erase(fit);
+      } else {
+        ++fit;
+      }
+    }
+    factors.push_back(current);
+  }
+}
+
+/// lookupAssignment - Look for a cached real model of the given constraint
+/// set. On success \arg result is either the model, or 0 when the constraint
+/// set is known to be unsatisfiable.
+bool RealCachingSolver::lookupAssignment(const KeyType &key,
+                                         Assignment *&result) {
+  Assignment *const *lookup = cache.lookup(key);
+
+  // A model of a superset is trivially a model of any of its subsets.
+  if (!lookup)
+    lookup = cache.findSuperset(key, NonNullAssignment());
+
+  // If a subset is unsatisfiable, no additional constraint can make it
+  // satisfiable.
+  if (!lookup)
+    lookup = cache.findSubset(key, NullAssignment());
+
+  if (!lookup)
+    return false;
+
+  result = *lookup;
+  return true;
+}
+
+bool RealCachingSolver::getAssignment(const RealFactor &factor,
+                                      Assignment *&result) {
+  if (lookupAssignment(factor.exprs, result)) {
+    ++stats::queryRealCacheHits;
+    return true;
+  }
+  ++stats::queryRealCacheMisses;
+
+  std::vector<const Array *> objects(factor.arrays.begin(),
+                                     factor.arrays.end());
+  std::vector<std::vector<unsigned char> > values;
+  bool hasSolution;
+  ConstraintManager constraints(
+      std::vector<ref<Expr> >(factor.exprs.begin(), factor.exprs.end()));
+  if (!solver->impl->computeInitialValues(
+          Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+          values, hasSolution))
+    return false;
+
+  Assignment *binding = 0;
+  if (hasSolution) {
+    binding = new Assignment(objects, values);
+    assignments.push_back(binding);
+  }
+
+  result = binding;
+  cache.insert(factor.exprs, binding);
+  return true;
+}
+
+bool RealCachingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  TimerStatIncrementer t(stats::realCacheTime);
+
+  std::list<RealFactor> factors;
+  computeFactors(query, factors);
+
+  hasSolution = true;
+  Assignment::bindings_ty bindings;
+  for (std::list<RealFactor>::iterator it = factors.begin(),
+                                       ie = factors.end();
+       it != ie; ++it) {
+    if (it->arrays.empty())
+      continue;
+
+    Assignment *a;
+    if (!getAssignment(*it, a))
+      return false;
+    if (!a) {
+      hasSolution = false;
+      return true;
+    }
+    // A cached superset model may bind more arrays than the factor needs;
+    // only take those belonging to the factor.
+    for (std::set<const Array *>::iterator ait = it->arrays.begin(),
+                                           aie = it->arrays.end();
+         ait != aie; ++ait) {
+      Assignment::bindings_ty::iterator bit = a->bindings.find(*ait);
+      if (bit != a->bindings.end())
+        bindings.insert(*bit);
+    }
+  }
+
+  // Arrays not constrained by the query are left without a value, exactly as
+  // the error solver does for constants missing from its model.
+  values.clear();
+  values.reserve(objects.size());
+  for (std::vector<const Array *>::const_iterator it = objects.begin(),
+                                                  ie = objects.end();
+       it != ie; ++it) {
+    Assignment::bindings_ty::iterator bit = bindings.find(*it);
+    if (bit == bindings.end())
+      values.push_back(std::vector<unsigned char>());
+    else
+      values.push_back(bit->second);
+  }
+  return true;
+}
+
+} // namespace
+
+Solver *klee::createRealCachingSolver(Solver *s) {
+  return new Solver(new RealCachingSolver(s));
+}
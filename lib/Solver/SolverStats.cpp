@@ -12,6 +12,27 @@
 using namespace klee;
 
 Statistic stats::cexCacheTime("CexCacheTime", "CCtime");
+Statistic stats::errorAssertions("ErrorAssertions", "EA");
+Statistic stats::errorConstructCacheEvictions("ErrorConstructCacheEvictions",
+                                              "ECevict");
+Statistic stats::errorConstructCacheHits("ErrorConstructCacheHits", "EChits");
+Statistic stats::errorConstructCacheMisses("ErrorConstructCacheMisses",
+                                           "ECmisses");
+Statistic stats::errorModelQueries("ErrorModelQueries", "EMQ");
+Statistic stats::errorModelTime("ErrorModelTime", "EMtime");
+Statistic stats::errorOptimizeQueries("ErrorOptimizeQueries", "EOQ");
+Statistic stats::errorOptimizeTime("ErrorOptimizeTime", "EOtime");
+Statistic stats::incrementalAssertedConstraints(
+    "IncrementalAssertedConstraints", "IAsserted");
+Statistic stats::incrementalReusedConstraints("IncrementalReusedConstraints",
+                                              "IReused");
+Statistic stats::incrementalSolverHits("IncrementalSolverHits", "ISHits");
+Statistic stats::incrementalSolverMisses("IncrementalSolverMisses",
+                                         "ISMisses");
+Statistic stats::persistentCacheTime("PersistentCacheTime", "PCtime");
+Statistic stats::portfolioWinsMetaSMT("PortfolioWinsMetaSMT", "PWmetasmt");
+Statistic stats::portfolioWinsSTP("PortfolioWinsSTP", "PWstp");
+Statistic stats::portfolioWinsZ3("PortfolioWinsZ3", "PWz3");
 Statistic stats::queries("Queries", "Q");
 Statistic stats::queriesInvalid("QueriesInvalid", "Qiv");
 Statistic stats::queriesValid("QueriesValid", "Qv");
@@ -22,7 +43,14 @@ Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
 Statistic stats::queryConstructTime("QueryConstructTime", "QBtime") ;
 Statistic stats::queryConstructs("QueriesConstructs", "QB");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
+Statistic stats::queryPersistentCacheHits("QueryPersistentCacheHits",
+                                          "QPersistentHits");
+Statistic stats::queryPersistentCacheMisses("QueryPersistentCacheMisses",
+                                            "QPersistentMisses");
 Statistic stats::queryTime("QueryTime", "Qtime");
+Statistic stats::queryRealCacheHits("QueryRealCacheHits", "QRealHits");
+Statistic stats::queryRealCacheMisses("QueryRealCacheMisses", "QRealMisses");
+Statistic stats::realCacheTime("RealCacheTime", "RCtime");
 
 #ifdef DEBUG
 Statistic stats::arrayHashTime("ArrayHashTime", "AHtime");
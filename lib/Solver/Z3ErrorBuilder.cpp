@@ -12,6 +12,7 @@
 
 #include "klee/Expr.h"
 #include "klee/Solver.h"
+#include "klee/SolverStats.h"
 #include "klee/util/Bits.h"
 #include "klee/util/PrettyExpressionBuilder.h"
 #include "ConstantDivision.h"
@@ -57,8 +58,10 @@ void Z3ErrorArrayExprHash::clear() {
 }
 
 Z3ErrorBuilder::Z3ErrorBuilder(bool _viaIntegerSolving,
-                               bool autoClearConstructCache)
-    : viaIntegerSolving(_viaIntegerSolving),
+                               bool autoClearConstructCache,
+                               unsigned constructCacheCapacity)
+    : constructCacheCapacity(constructCacheCapacity),
+      viaIntegerSolving(_viaIntegerSolving),
       autoClearConstructCache(autoClearConstructCache) {
   // FIXME: Should probably let the client pass in a Z3_config instead
   Z3_config cfg = Z3_mk_config();
@@ -215,15 +218,33 @@ Z3ErrorASTHandle Z3ErrorBuilder::orExpr(Z3ErrorASTHandle lhs,
   return Z3ErrorASTHandle(Z3_mk_or(ctx, 2, args), ctx);
 }
 
+Z3ErrorASTHandle Z3ErrorBuilder::coerce(Z3ErrorASTHandle expr,
+                                        Z3SortHandle sort) {
+  Z3_sort_kind from = Z3_get_sort_kind(ctx, Z3_get_sort(ctx, expr));
+  Z3_sort_kind to = Z3_get_sort_kind(ctx, sort);
+  if (from == Z3_INT_SORT && to == Z3_REAL_SORT)
+    return Z3ErrorASTHandle(Z3_mk_int2real(ctx, expr), ctx);
+  if (from == Z3_REAL_SORT && to == Z3_INT_SORT)
+    return Z3ErrorASTHandle(Z3_mk_real2int(ctx, expr), ctx);
+  return expr;
+}
+
 Z3ErrorASTHandle Z3ErrorBuilder::writeExpr(Z3ErrorASTHandle array,
                                            Z3ErrorASTHandle index,
                                            Z3ErrorASTHandle value) {
-  return Z3ErrorASTHandle(Z3_mk_store(ctx, array, index, value), ctx);
+  // Indices and values may have been built in either arithmetic sort, so
+  // bring them to the sorts of the array.
+  Z3_sort arraySort = Z3_get_sort(ctx, array);
+  Z3SortHandle rangeSort(Z3_get_array_sort_range(ctx, arraySort), ctx);
+  return Z3ErrorASTHandle(Z3_mk_store(ctx, array, coerce(index, getIntSort()),
+                                      coerce(value, rangeSort)),
+                          ctx);
 }
 
 Z3ErrorASTHandle Z3ErrorBuilder::readExpr(Z3ErrorASTHandle array,
                                           Z3ErrorASTHandle index) {
-  return Z3ErrorASTHandle(Z3_mk_select(ctx, array, index), ctx);
+  return Z3ErrorASTHandle(
+      Z3_mk_select(ctx, array, coerce(index, getIntSort())), ctx);
 }
 
 Z3ErrorASTHandle Z3ErrorBuilder::iteExpr(Z3ErrorASTHandle condition,
@@ -322,17 +343,44 @@ Z3ErrorASTHandle Z3ErrorBuilder::constructInternal(ref<Expr> e) {
   if (!UseConstructHashZ3Error || isa<ConstantExpr>(e)) {
     return constructActual(e);
   } else {
-    ExprHashMap<Z3ErrorASTHandle>::iterator it = constructed.find(e);
+    ExprHashMap<ConstructEntry>::iterator it = constructed.find(e);
     if (it != constructed.end()) {
-      return it->second;
+      ++stats::errorConstructCacheHits;
+      // Move to the most recently used end
+      constructedLRU.splice(constructedLRU.end(), constructedLRU,
+                            it->second.second);
+      return it->second.first;
     } else {
+      ++stats::errorConstructCacheMisses;
       Z3ErrorASTHandle res = constructActual(e);
-      constructed.insert(std::make_pair(e, res));
+      ConstructLRU::iterator pos =
+          constructedLRU.insert(constructedLRU.end(), e);
+      constructed.insert(std::make_pair(e, ConstructEntry(res, pos)));
       return res;
     }
   }
 }
 
+void Z3ErrorBuilder::trimConstructCache() {
+  if (!constructCacheCapacity)
+    return;
+  while (constructed.size() > constructCacheCapacity) {
+    // Erasing the entry drops its Z3 reference.
+    constructed.erase(constructedLRU.front());
+    constructedLRU.pop_front();
+    ++stats::errorConstructCacheEvictions;
+  }
+}
+
+size_t Z3ErrorBuilder::getConstructCacheMemoryUsage() const {
+  // Each entry has a hash table node (payload and next pointer) and a list
+  // node (key and two links).
+  size_t entry = sizeof(std::pair<const ref<Expr>, ConstructEntry>) +
+                 sizeof(ref<Expr>) + 3 * sizeof(void *);
+  return constructed.size() * entry +
+         constructed.bucket_count() * sizeof(void *);
+}
+
 /** if *width_out!=1 then result is a bitvector,
     otherwise it is a bool */
 Z3ErrorASTHandle Z3ErrorBuilder::constructActual(ref<Expr> e) {
@@ -361,7 +409,12 @@ Z3ErrorASTHandle Z3ErrorBuilder::constructActual(ref<Expr> e) {
 
     std::string name(re->updates.root->name);
 
-    if (ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(re->index)) {
+    // Reads of symbolic arrays at a constant index denote a single real
+    // variable. Constant arrays, such as shadow error memory written at
+    // symbolic offsets, are instead modelled as Z3 arrays so that their
+    // updates are taken into account.
+    ConstantExpr *ce = llvm::dyn_cast<ConstantExpr>(re->index);
+    if (ce && !re->updates.root->isConstantArray()) {
       uint64_t index = ce->getZExtValue();
       const std::string array_prefix8 = ARRAY_PREFIX8;
       const std::string array_prefix16 = ARRAY_PREFIX16;
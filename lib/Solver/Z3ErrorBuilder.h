@@ -13,6 +13,7 @@
 #include "klee/util/ExprHashMap.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
+#include <list>
 #include <z3.h>
 
 namespace klee {
@@ -106,7 +107,14 @@ public:
 };
 
 class Z3ErrorBuilder {
-  ExprHashMap<Z3ErrorASTHandle> constructed;
+  // The construct cache is kept in least recently used order so that it can
+  // survive across queries while staying bounded. Each entry holds a Z3
+  // reference through its Z3ErrorASTHandle which is released on eviction.
+  typedef std::list<ref<Expr> > ConstructLRU;
+  typedef std::pair<Z3ErrorASTHandle, ConstructLRU::iterator> ConstructEntry;
+  ExprHashMap<ConstructEntry> constructed;
+  ConstructLRU constructedLRU;
+  unsigned constructCacheCapacity;
   Z3ErrorArrayExprHash _arr_hash;
 
 private:
@@ -122,6 +130,9 @@ private:
                            unsigned bottom);
   Z3ErrorASTHandle eqExpr(Z3ErrorASTHandle a, Z3ErrorASTHandle b);
 
+  // Convert between integer and real sorts
+  Z3ErrorASTHandle coerce(Z3ErrorASTHandle expr, Z3SortHandle sort);
+
   // logical left and right shift (not arithmetic)
   Z3ErrorASTHandle leftShift(Z3ErrorASTHandle expr, unsigned shift);
   Z3ErrorASTHandle rightShift(Z3ErrorASTHandle expr, unsigned shift);
@@ -167,7 +178,10 @@ private:
 public:
   Z3_context ctx;
 
-  Z3ErrorBuilder(bool _viaIntegerSolving, bool autoClearConstructCache = true);
+  /// \param constructCacheCapacity - The maximum number of expressions kept
+  /// by trimConstructCache(), 0 means unbounded.
+  Z3ErrorBuilder(bool _viaIntegerSolving, bool autoClearConstructCache = true,
+                 unsigned constructCacheCapacity = 0);
   ~Z3ErrorBuilder();
 
   Z3ErrorASTHandle getTrue();
@@ -183,7 +197,23 @@ public:
     return res;
   }
 
-  void clearConstructCache() { constructed.clear(); }
+  void clearConstructCache() {
+    constructed.clear();
+    constructedLRU.clear();
+  }
+
+  /// trimConstructCache - Evict the least recently used expressions until the
+  /// cache is within its capacity. This is meant to be called between queries
+  /// so that sharing within a single query is never lost.
+  void trimConstructCache();
+
+  /// getConstructCacheSize - Return the number of cached expressions.
+  size_t getConstructCacheSize() const { return constructed.size(); }
+
+  /// getConstructCacheMemoryUsage - Return an estimate, in bytes, of the
+  /// memory held by the cache bookkeeping. This does not include the Z3 ASTs
+  /// themselves.
+  size_t getConstructCacheMemoryUsage() const;
 };
 }
 
@@ -16,8 +16,18 @@
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprUtil.h"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 
+namespace {
+llvm::cl::opt<unsigned> Z3ErrorConstructCacheSize(
+    "z3-error-construct-cache-size",
+    llvm::cl::desc("Maximum number of expressions whose Z3 translation is "
+                   "kept across error solver queries, 0 means unbounded "
+                   "(default=65536)"),
+    llvm::cl::init(65536));
+}
+
 namespace klee {
 
 class Z3ErrorSolverImpl : public SolverImpl {
@@ -27,6 +37,7 @@ private:
   double timeout;
   SolverRunStatus runStatusCode;
   ::Z3_params errorBoundSolverParameter;
+  ::Z3_params boxErrorBoundSolverParameter;
   ::Z3_params pathConditionSolverParameter;
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
@@ -36,7 +47,7 @@ private:
                          std::vector<std::vector<unsigned char> > *values,
                          bool &hasSolution);
 
-  bool internalRunOptimize(const Query &,
+  bool internalRunOptimize(const Query &, ::Z3_params params,
                            const std::vector<const Array *> *objects,
                            std::vector<bool> *infinity,
                            std::vector<std::pair<int, double> > *values,
@@ -56,6 +67,8 @@ public:
       timeoutInMilliSeconds = UINT_MAX;
     Z3_params_set_uint(errorBoundBuilder->ctx, errorBoundSolverParameter,
                        timeoutParamStrSymbol, timeoutInMilliSeconds);
+    Z3_params_set_uint(errorBoundBuilder->ctx, boxErrorBoundSolverParameter,
+                       timeoutParamStrSymbol, timeoutInMilliSeconds);
     Z3_params_set_uint(pathConditionBuilder->ctx, pathConditionSolverParameter,
                        timeoutParamStrSymbol, timeoutInMilliSeconds);
   }
@@ -71,6 +84,10 @@ public:
                             std::vector<bool> &infinity,
                             std::vector<std::pair<int, double> > &values,
                             std::vector<bool> &epsilon, bool &hasSolution);
+  bool computeIndependentOptimalValues(
+      const Query &, const std::vector<const Array *> &objects,
+      std::vector<bool> &infinity, std::vector<std::pair<int, double> > &values,
+      std::vector<bool> &epsilon, bool &hasSolution);
   SolverRunStatus
   handleSolverResponse(::Z3_solver theSolver, ::Z3_lbool satisfiable,
                        const std::vector<const Array *> *objects,
@@ -87,33 +104,56 @@ public:
 
 Z3ErrorSolverImpl::Z3ErrorSolverImpl()
     : errorBoundBuilder(new Z3ErrorBuilder(ComputeErrorBound == VIA_INTEGER,
-                                           /*autoClearConstructCache=*/false)),
-      pathConditionBuilder(
-          new Z3ErrorBuilder(false, /*autoClearConstructCache=*/false)),
+                                           /*autoClearConstructCache=*/false,
+                                           Z3ErrorConstructCacheSize)),
+      pathConditionBuilder(new Z3ErrorBuilder(
+          false, /*autoClearConstructCache=*/false, Z3ErrorConstructCacheSize)),
       timeout(0.0), runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
   assert(errorBoundBuilder && "unable to create Z3Builder");
   errorBoundSolverParameter = Z3_mk_params(errorBoundBuilder->ctx);
+  boxErrorBoundSolverParameter = Z3_mk_params(errorBoundBuilder->ctx);
   pathConditionSolverParameter = Z3_mk_params(pathConditionBuilder->ctx);
   Z3_params_inc_ref(errorBoundBuilder->ctx, errorBoundSolverParameter);
+  Z3_params_inc_ref(errorBoundBuilder->ctx, boxErrorBoundSolverParameter);
   Z3_params_inc_ref(errorBoundBuilder->ctx, pathConditionSolverParameter);
   timeoutParamStrSymbol =
       Z3_mk_string_symbol(errorBoundBuilder->ctx, "timeout");
   setCoreSolverTimeout(timeout);
 
+  ::Z3_symbol priorityParamStrSymbol =
+      Z3_mk_string_symbol(errorBoundBuilder->ctx, "priority");
   if (!UniformInputError) {
     // Set pareto optimality as priority strategy
-    ::Z3_symbol priorityParamStrSymbol =
-        Z3_mk_string_symbol(errorBoundBuilder->ctx, "priority");
     ::Z3_symbol pareto = Z3_mk_string_symbol(errorBoundBuilder->ctx, "pareto");
     Z3_params_set_symbol(errorBoundBuilder->ctx, errorBoundSolverParameter,
                          priorityParamStrSymbol, pareto);
   }
+  // Batched error bounds optimize each objective on its own
+  ::Z3_symbol box = Z3_mk_string_symbol(errorBoundBuilder->ctx, "box");
+  Z3_params_set_symbol(errorBoundBuilder->ctx, boxErrorBoundSolverParameter,
+                       priorityParamStrSymbol, box);
 }
 
 Z3ErrorSolverImpl::~Z3ErrorSolverImpl() {
+  if (DebugPrecision) {
+    uint64_t hits = stats::errorConstructCacheHits;
+    uint64_t lookups = hits + stats::errorConstructCacheMisses;
+    klee_message("Z3 error construct cache: %.1f%% hit rate, %lu entries "
+                 "(~%lu KiB) for path conditions, %lu entries (~%lu KiB) for "
+                 "error bounds",
+                 lookups ? (100.0 * hits) / lookups : 0.0,
+                 (unsigned long)pathConditionBuilder->getConstructCacheSize(),
+                 (unsigned long)(pathConditionBuilder
+                                     ->getConstructCacheMemoryUsage() >> 10),
+                 (unsigned long)errorBoundBuilder->getConstructCacheSize(),
+                 (unsigned long)(errorBoundBuilder
+                                     ->getConstructCacheMemoryUsage() >> 10));
+  }
   Z3_params_dec_ref(errorBoundBuilder->ctx, errorBoundSolverParameter);
+  Z3_params_dec_ref(errorBoundBuilder->ctx, boxErrorBoundSolverParameter);
   Z3_params_dec_ref(pathConditionBuilder->ctx, pathConditionSolverParameter);
   delete errorBoundBuilder;
+  delete pathConditionBuilder;
 }
 
 Z3ErrorSolver::Z3ErrorSolver() : Solver(new Z3ErrorSolverImpl()) {}
@@ -135,6 +175,15 @@ bool Z3ErrorSolver::computeOptimalValues(
                                           epsilon, hasSolution);
 }
 
+bool Z3ErrorSolver::computeIndependentOptimalValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<bool> &infinity, std::vector<std::pair<int, double> > &values,
+    std::vector<bool> &epsilon, bool &hasSolution) {
+  Z3ErrorSolverImpl *solverImpl = (Z3ErrorSolverImpl *)impl;
+  return solverImpl->computeIndependentOptimalValues(
+      query, objects, infinity, values, epsilon, hasSolution);
+}
+
 char *Z3ErrorSolverImpl::getConstraintLog(const Query &query) {
   std::vector<Z3ErrorASTHandle> assumptions;
   for (std::vector<ref<Expr> >::const_iterator it = query.constraints.begin(),
@@ -214,14 +263,22 @@ bool Z3ErrorSolverImpl::computeOptimalValues(
     const Query &query, const std::vector<const Array *> &objects,
     std::vector<bool> &infinity, std::vector<std::pair<int, double> > &values,
     std::vector<bool> &epsilon, bool &hasSolution) {
-  return internalRunOptimize(query, &objects, &infinity, &values, &epsilon,
-                             hasSolution);
+  return internalRunOptimize(query, errorBoundSolverParameter, &objects,
+                             &infinity, &values, &epsilon, hasSolution);
+}
+
+bool Z3ErrorSolverImpl::computeIndependentOptimalValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<bool> &infinity, std::vector<std::pair<int, double> > &values,
+    std::vector<bool> &epsilon, bool &hasSolution) {
+  return internalRunOptimize(query, boxErrorBoundSolverParameter, &objects,
+                             &infinity, &values, &epsilon, hasSolution);
 }
 
 bool Z3ErrorSolverImpl::internalRunSolver(
     const Query &query, const std::vector<const Array *> *objects,
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
-  TimerStatIncrementer t(stats::queryTime);
+  TimerStatIncrementer t(stats::errorModelTime);
   // TODO: Does making a new solver for each query have a performance
   // impact vs making one global solver and using push and pop?
   // TODO: is the "simple_solver" the right solver to use for
@@ -239,9 +296,8 @@ bool Z3ErrorSolverImpl::internalRunSolver(
     Z3_solver_assert(pathConditionBuilder->ctx, theSolver,
                      pathConditionBuilder->construct(*it));
   }
-  ++stats::queries;
-  if (objects)
-    ++stats::queryCounterexamples;
+  ++stats::errorModelQueries;
+  stats::errorAssertions += query.constraints.size() + 1;
 
   Z3ErrorASTHandle z3QueryExpr = Z3ErrorASTHandle(
       pathConditionBuilder->construct(query.expr), pathConditionBuilder->ctx);
@@ -262,38 +318,30 @@ bool Z3ErrorSolverImpl::internalRunSolver(
                                        hasSolution);
 
   Z3_solver_dec_ref(pathConditionBuilder->ctx, theSolver);
-  // Clear the builder's cache to prevent memory usage exploding.
-  // By using ``autoClearConstructCache=false`` and clearning now
+  // Bound the builder's cache to prevent memory usage exploding.
+  // By using ``autoClearConstructCache=false`` and trimming now
   // we allow Z3_ast expressions to be shared from an entire
-  // ``Query`` rather than only sharing within a single call to
-  // ``builder->construct()``.
-  pathConditionBuilder->clearConstructCache();
-
-  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
-      runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
-    if (hasSolution) {
-      ++stats::queriesInvalid;
-    } else {
-      ++stats::queriesValid;
-    }
-    return true; // success
-  }
-  return false; // failed
+  // ``Query``, and path-condition constraints to be shared with
+  // later queries while they remain in the cache.
+  pathConditionBuilder->trimConstructCache();
+
+  return runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+         runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
 }
 
 bool Z3ErrorSolverImpl::internalRunOptimize(
-    const Query &query, const std::vector<const Array *> *objects,
+    const Query &query, ::Z3_params params,
+    const std::vector<const Array *> *objects,
     std::vector<bool> *infinity, std::vector<std::pair<int, double> > *values,
     std::vector<bool> *epsilon, bool &hasSolution) {
-  TimerStatIncrementer t(stats::queryTime);
+  TimerStatIncrementer t(stats::errorOptimizeTime);
   // TODO: Does making a new solver for each query have a performance
   // impact vs making one global solver and using push and pop?
   // TODO: is the "simple_solver" the right solver to use for
   // best performance?
   Z3_optimize theSolver = Z3_mk_optimize(errorBoundBuilder->ctx);
   Z3_optimize_inc_ref(errorBoundBuilder->ctx, theSolver);
-  Z3_optimize_set_params(errorBoundBuilder->ctx, theSolver,
-                         errorBoundSolverParameter);
+  Z3_optimize_set_params(errorBoundBuilder->ctx, theSolver, params);
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
@@ -303,9 +351,8 @@ bool Z3ErrorSolverImpl::internalRunOptimize(
     Z3_optimize_assert(errorBoundBuilder->ctx, theSolver,
                        errorBoundBuilder->construct(*it));
   }
-  ++stats::queries;
-  if (objects)
-    ++stats::queryCounterexamples;
+  ++stats::errorOptimizeQueries;
+  stats::errorAssertions += query.constraints.size();
 
   // Objective functions here
   for (std::vector<const Array *>::const_iterator it = objects->begin(),
@@ -342,23 +389,11 @@ bool Z3ErrorSolverImpl::internalRunOptimize(
       theSolver, satisfiable, objects, infinity, values, epsilon, hasSolution);
 
   Z3_optimize_dec_ref(errorBoundBuilder->ctx, theSolver);
-  // Clear the builder's cache to prevent memory usage exploding.
-  // By using ``autoClearConstructCache=false`` and clearning now
-  // we allow Z3_ast expressions to be shared from an entire
-  // ``Query`` rather than only sharing within a single call to
-  // ``builder->construct()``.
-  errorBoundBuilder->clearConstructCache();
-
-  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
-      runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
-    if (hasSolution) {
-      ++stats::queriesInvalid;
-    } else {
-      ++stats::queriesValid;
-    }
-    return true; // success
-  }
-  return false; // failed
+  // Bound the builder's cache, see internalRunSolver().
+  errorBoundBuilder->trimConstructCache();
+
+  return runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+         runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
 }
 
 SolverImpl::SolverRunStatus Z3ErrorSolverImpl::handleSolverResponse(
@@ -443,12 +478,13 @@ SolverImpl::SolverRunStatus Z3ErrorSolverImpl::handleSolverResponse(
               }
             }
 
-            values->push_back(data);
-
             break;
           }
         }
       }
+      // Keep values aligned with objects even when the array is missing
+      // from the model.
+      values->push_back(data);
     }
 
     Z3_model_dec_ref(pathConditionBuilder->ctx, theModel);
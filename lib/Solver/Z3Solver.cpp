@@ -13,13 +13,39 @@
 #include "klee/Constraints.h"
 #include "klee/Solver.h"
 #include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprUtil.h"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 
+#include <algorithm>
+
+namespace {
+llvm::cl::opt<bool> Z3IncrementalSolving(
+    "z3-incremental",
+    llvm::cl::desc("Keep Z3 solvers alive across queries, asserting only the "
+                   "constraints not shared with a previous query (default=off)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> Z3IncrementalSolvers(
+    "z3-incremental-solvers",
+    llvm::cl::desc("Number of incremental Z3 solvers kept for the most "
+                   "recently queried constraint sets (default=4)"),
+    llvm::cl::init(4));
+}
+
 namespace klee {
 
+/// A Z3 solver whose assertions are the constraints of an earlier query, each
+/// asserted in its own scope so that any suffix of them can be popped.
+struct Z3IncrementalSolver {
+  ::Z3_solver solver;
+  std::vector<ref<Expr> > asserted;
+  uint64_t lastUse;
+};
+
 class Z3SolverImpl : public SolverImpl {
 private:
   Z3Builder *builder;
@@ -28,6 +54,13 @@ private:
   ::Z3_params solverParameters;
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
+  std::vector<Z3IncrementalSolver> incrementalSolvers;
+  uint64_t incrementalUses;
+
+  /// Return an incremental solver asserting exactly the constraints of the
+  /// query, reusing the one sharing the longest constraint prefix.
+  Z3IncrementalSolver &getIncrementalSolver(const Query &);
+  void resetIncrementalSolver(Z3IncrementalSolver &);
 
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
@@ -66,7 +99,7 @@ public:
 
 Z3SolverImpl::Z3SolverImpl()
     : builder(new Z3Builder(/*autoClearConstructCache=*/false)), timeout(0.0),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), incrementalUses(0) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -75,6 +108,8 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  for (unsigned i = 0; i < incrementalSolvers.size(); ++i)
+    Z3_solver_dec_ref(builder->ctx, incrementalSolvers[i].solver);
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
@@ -162,24 +197,101 @@ bool Z3SolverImpl::computeInitialValues(
   return internalRunSolver(query, &objects, &values, hasSolution);
 }
 
+void Z3SolverImpl::resetIncrementalSolver(Z3IncrementalSolver &s) {
+  Z3_solver_reset(builder->ctx, s.solver);
+  s.asserted.clear();
+}
+
+Z3IncrementalSolver &Z3SolverImpl::getIncrementalSolver(const Query &query) {
+  ConstraintManager::const_iterator constraints = query.constraints.begin();
+  size_t numConstraints = query.constraints.size();
+
+  // Successive queries of a state, and of the states forked from it, share
+  // the constraints added before they diverged.
+  Z3IncrementalSolver *best = NULL;
+  size_t bestShared = 0;
+  for (unsigned i = 0; i < incrementalSolvers.size(); ++i) {
+    Z3IncrementalSolver &s = incrementalSolvers[i];
+    size_t shared = 0;
+    size_t limit = std::min(s.asserted.size(), numConstraints);
+    while (shared < limit && s.asserted[shared] == constraints[shared])
+      ++shared;
+    if (!best || shared > bestShared ||
+        (shared == bestShared && s.lastUse > best->lastUse)) {
+      best = &s;
+      bestShared = shared;
+    }
+  }
+
+  // Popping more constraints than are kept costs more than asserting the
+  // query from scratch, so such solvers are only reused if none is free.
+  if (!best || bestShared == 0 ||
+      best->asserted.size() - bestShared > bestShared) {
+    ++stats::incrementalSolverMisses;
+    unsigned maxSolvers = std::max(1u, unsigned(Z3IncrementalSolvers));
+    if (incrementalSolvers.size() < maxSolvers) {
+      Z3IncrementalSolver s;
+      s.solver = Z3_mk_simple_solver(builder->ctx);
+      Z3_solver_inc_ref(builder->ctx, s.solver);
+      incrementalSolvers.push_back(s);
+      best = &incrementalSolvers.back();
+    } else {
+      best = &incrementalSolvers[0];
+      for (unsigned i = 1; i < incrementalSolvers.size(); ++i)
+        if (incrementalSolvers[i].lastUse < best->lastUse)
+          best = &incrementalSolvers[i];
+      resetIncrementalSolver(*best);
+    }
+    bestShared = 0;
+  } else {
+    ++stats::incrementalSolverHits;
+    if (best->asserted.size() > bestShared) {
+      Z3_solver_pop(builder->ctx, best->solver,
+                    best->asserted.size() - bestShared);
+      best->asserted.resize(bestShared);
+    }
+    stats::incrementalReusedConstraints += bestShared;
+  }
+
+  for (size_t i = bestShared; i < numConstraints; ++i) {
+    Z3_solver_push(builder->ctx, best->solver);
+    Z3_solver_assert(builder->ctx, best->solver,
+                     builder->construct(constraints[i]));
+    best->asserted.push_back(constraints[i]);
+  }
+  stats::incrementalAssertedConstraints += numConstraints - bestShared;
+
+  best->lastUse = ++incrementalUses;
+  return *best;
+}
+
 bool Z3SolverImpl::internalRunSolver(
     const Query &query, const std::vector<const Array *> *objects,
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
   TimerStatIncrementer t(stats::queryTime);
-  // TODO: Does making a new solver for each query have a performance
-  // impact vs making one global solver and using push and pop?
   // TODO: is the "simple_solver" the right solver to use for
   // best performance?
-  Z3_solver theSolver = Z3_mk_simple_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
+  Z3_solver theSolver;
+  Z3IncrementalSolver *incremental = NULL;
+  if (Z3IncrementalSolving) {
+    incremental = &getIncrementalSolver(query);
+    theSolver = incremental->solver;
+    // The query expression is popped once answered
+    Z3_solver_push(builder->ctx, theSolver);
+  } else {
+    theSolver = Z3_mk_simple_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+  }
   Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
+  if (!incremental) {
+    for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                           ie = query.constraints.end();
+         it != ie; ++it) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
+    }
   }
   ++stats::queries;
   if (objects)
@@ -201,7 +313,15 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
+  if (incremental) {
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+    // Do not rely on the state of a solver that was interrupted
+    if (runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+        runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+      resetIncrementalSolver(*incremental);
+  } else {
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+  }
   // Clear the builder's cache to prevent memory usage exploding.
   // By using ``autoClearConstructCache=false`` and clearning now
   // we allow Z3_ast expressions to be shared from an entire
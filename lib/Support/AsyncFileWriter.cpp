@@ -0,0 +1,151 @@
+//===-- AsyncFileWriter.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Support/AsyncFileWriter.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace klee;
+
+AsyncFileWriter::AsyncFileWriter(size_t _maxQueued)
+    : maxQueued(_maxQueued), queued(0), busy(false), stopping(false) {
+  pthread_mutex_init(&mutex, 0);
+  pthread_cond_init(&queuedCond, 0);
+  pthread_cond_init(&writtenCond, 0);
+  if (pthread_create(&thread, 0, run, this))
+    klee_error("unable to create file writer thread");
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  pthread_cond_signal(&queuedCond);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, 0);
+
+  // The thread has written every request before stopping
+  reportFailures();
+  pthread_cond_destroy(&writtenCond);
+  pthread_cond_destroy(&queuedCond);
+  pthread_mutex_destroy(&mutex);
+}
+
+void *AsyncFileWriter::run(void *writer) {
+  static_cast<AsyncFileWriter *>(writer)->writeRequests();
+  return 0;
+}
+
+void AsyncFileWriter::writeRequests() {
+  pthread_mutex_lock(&mutex);
+  for (;;) {
+    while (requests.empty() && !stopping)
+      pthread_cond_wait(&queuedCond, &mutex);
+    if (requests.empty())
+      break;
+
+    Request request;
+    request.path.swap(requests.front().path);
+    request.contents.swap(requests.front().contents);
+    request.append = requests.front().append;
+    requests.pop_front();
+    busy = true;
+    pthread_mutex_unlock(&mutex);
+
+    bool success = writeFile(request);
+
+    pthread_mutex_lock(&mutex);
+    busy = false;
+    queued -= request.contents.size();
+    if (!success)
+      failures.push_back(request.path);
+    pthread_cond_broadcast(&writtenCond);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+bool AsyncFileWriter::writeFile(const Request &request) {
+  int flags = O_WRONLY | O_CREAT | (request.append ? O_APPEND : O_TRUNC);
+  int fd = open(request.path.c_str(), flags, 0644);
+  if (fd < 0)
+    return false;
+
+  const char *pos = request.contents.data();
+  size_t left = request.contents.size();
+  while (left) {
+    ssize_t written = ::write(fd, pos, left);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      close(fd);
+      return false;
+    }
+    pos += written;
+    left -= written;
+  }
+  return close(fd) == 0;
+}
+
+void AsyncFileWriter::reportFailures() {
+  for (std::vector<std::string>::iterator it = failures.begin(),
+                                          ie = failures.end();
+       it != ie; ++it)
+    klee_warning("unable to write file: %s", it->c_str());
+  failures.clear();
+}
+
+void AsyncFileWriter::queue(const std::string &path, std::string &contents,
+                            bool append) {
+  pthread_mutex_lock(&mutex);
+  reportFailures();
+  // A file larger than the bound is queued alone
+  while (queued && queued + contents.size() > maxQueued)
+    pthread_cond_wait(&writtenCond, &mutex);
+
+  requests.push_back(Request());
+  requests.back().path = path;
+  requests.back().contents.swap(contents);
+  requests.back().append = append;
+  queued += requests.back().contents.size();
+  pthread_cond_signal(&queuedCond);
+  pthread_mutex_unlock(&mutex);
+}
+
+void AsyncFileWriter::write(const std::string &path, std::string &contents) {
+  queue(path, contents, false);
+}
+
+void AsyncFileWriter::append(const std::string &path, std::string &contents) {
+  queue(path, contents, true);
+}
+
+void AsyncFileWriter::flush() {
+  pthread_mutex_lock(&mutex);
+  while (!requests.empty() || busy)
+    pthread_cond_wait(&writtenCond, &mutex);
+  reportFailures();
+  pthread_mutex_unlock(&mutex);
+}
+
+/***/
+
+async_file_ostream::async_file_ostream(AsyncFileWriter &_writer,
+                                       const std::string &_path)
+    : writer(_writer), path(_path) {}
+
+async_file_ostream::~async_file_ostream() {
+  flush();
+  writer.write(path, contents);
+}
+
+void async_file_ostream::write_impl(const char *Ptr, size_t Size) {
+  contents.append(Ptr, Size);
+}
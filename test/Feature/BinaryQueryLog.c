@@ -0,0 +1,43 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --use-cex-cache=false --use-query-log=all:binary,solver:binary %t1.bc 2> %t2.log
+// RUN: %kleaver %t.klee-out/all-queries.qlog > %t3.log
+// RUN: FileCheck %s < %t3.log
+// RUN: %kleaver %t.klee-out/solver-queries.qlog > %t4.log
+// RUN: FileCheck %s < %t4.log
+
+/* kleaver replays the binary logs, and gets the answers of the log. */
+
+// CHECK-NOT: result differs from the log
+// CHECK: replayed queries = {{[1-9][0-9]*}}
+// CHECK: failed queries = 0
+// CHECK: mismatched results = 0
+
+#include <assert.h>
+
+int constantArr[16] = {
+  1 <<  0, 1 <<  1, 1 <<  2, 1 <<  3,
+  1 <<  4, 1 <<  5, 1 <<  6, 1 <<  7,
+  1 <<  8, 1 <<  9, 1 << 10, 1 << 11,
+  1 << 12, 1 << 13, 1 << 14, 1 << 15
+};
+
+int main() {
+  char buf[4];
+  klee_make_symbolic(buf, sizeof buf);
+
+  buf[1] = 'a';
+
+  constantArr[klee_range(0, 16, "idx.0")] = buf[0];
+
+  // Use this to trigger an interior update list usage.
+  int y = constantArr[klee_range(0, 16, "idx.1")];
+
+  constantArr[klee_range(0, 16, "idx.2")] = buf[3];
+
+  buf[klee_range(0, 4, "idx.3")] = 0;
+  if (buf[0] == 'h' && y != (1 << 5))
+    assert(0);
+
+  return 0;
+}
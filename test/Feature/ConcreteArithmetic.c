@@ -0,0 +1,63 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t1.bc
+
+/* Checks the concrete fast paths of the interpreter against the same
+ * operations on symbolic operands, which build expressions.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#define CHECK(op, type, a, b)                                                  \
+  do {                                                                         \
+    type ca = a, cb = b, sa = a, sb = b;                                       \
+    klee_make_symbolic(&sa, sizeof(sa), "sa");                                 \
+    klee_make_symbolic(&sb, sizeof(sb), "sb");                                 \
+    klee_assume(sa == a);                                                      \
+    klee_assume(sb == b);                                                      \
+    assert((type)(ca op cb) == (type)(sa op sb));                              \
+  } while (0)
+
+#define CHECK_ALL(type, a, b)                                                  \
+  do {                                                                         \
+    CHECK(+, type, a, b);                                                      \
+    CHECK(-, type, a, b);                                                      \
+    CHECK(*, type, a, b);                                                      \
+    CHECK(&, type, a, b);                                                      \
+    CHECK(|, type, a, b);                                                      \
+    CHECK(^, type, a, b);                                                      \
+    CHECK(==, type, a, b);                                                     \
+    CHECK(!=, type, a, b);                                                     \
+    CHECK(<, type, a, b);                                                      \
+    CHECK(<=, type, a, b);                                                     \
+    CHECK(>, type, a, b);                                                      \
+    CHECK(>=, type, a, b);                                                     \
+  } while (0)
+
+int main() {
+  CHECK_ALL(int8_t, -128, 127);
+  CHECK_ALL(uint8_t, 200, 100);
+  CHECK_ALL(int16_t, -3, 7);
+  CHECK_ALL(uint32_t, 0xffffffffu, 2);
+  CHECK_ALL(int32_t, -2147483647 - 1, -1);
+  CHECK_ALL(int64_t, -5, 3);
+  CHECK_ALL(uint64_t, 0x8000000000000000ull, 0xffffffffffffffffull);
+
+  CHECK(<<, uint32_t, 0x80000001u, 31);
+  CHECK(>>, uint32_t, 0x80000001u, 31);
+  CHECK(>>, int32_t, -7, 1);
+  CHECK(>>, int64_t, -1, 63);
+  CHECK(<<, uint8_t, 0x81, 7);
+
+  /* Conversions */
+  int8_t c = -2;
+  int8_t sc = c;
+  klee_make_symbolic(&sc, sizeof(sc), "sc");
+  klee_assume(sc == -2);
+  assert((int64_t)c == (int64_t)sc);
+  assert((uint64_t)(uint8_t)c == (uint64_t)(uint8_t)sc);
+  assert((int16_t)(int64_t)c == (int16_t)(int64_t)sc);
+
+  return 0;
+}
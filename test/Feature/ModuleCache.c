@@ -0,0 +1,26 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-cached %t.cache
+// RUN: %klee --output-dir=%t.klee-out --module-cache-dir=%t.cache --libc=klee %t1.bc 2> %t.log
+// RUN: not grep "Using prepared module" %t.log
+// RUN: grep "completed paths = 3" %t.log
+// RUN: ls %t.cache | FileCheck %s
+// RUN: %klee --output-dir=%t.klee-out-cached --module-cache-dir=%t.cache --libc=klee %t1.bc 2> %t.cached.log
+// RUN: grep "Using prepared module" %t.cached.log
+// RUN: grep "completed paths = 3" %t.cached.log
+
+/* The second run loads the module prepared by the first one, with
+ * klee-libc linked in, from the cache.
+ */
+
+// CHECK: {{^[0-9a-f]+\.bc$}}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  if (x > 10) {
+    if (x > 20)
+      return 2;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-nocache
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t1.bc 2> %t.log
+// RUN: grep "completed paths = 4" %t.log
+// RUN: %klee --output-dir=%t.klee-out-nocache --resolution-cache-size=0 --exit-on-error %t1.bc 2> %t.nocache.log
+// RUN: grep "completed paths = 4" %t.nocache.log
+
+/* The same symbolic pointers are resolved repeatedly under unchanged
+ * constraints, which the resolution cache answers without the solver.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+int *make_int(int i) {
+  int *x = malloc(sizeof(*x));
+  *x = i;
+  return x;
+}
+
+int main() {
+  int a[8] = { 0 };
+  int *buf[4];
+  unsigned i, j, s;
+
+  klee_make_symbolic(&i, sizeof(i), "i");
+  klee_assume(i < 8);
+  for (j = 0; j < 10; j++)
+    a[i] += 1;
+  assert(a[i] == 10);
+
+  for (j = 0; j < 4; j++)
+    buf[j] = make_int(j * 2);
+
+  klee_make_symbolic(&s, sizeof(s), "s");
+  klee_assume(s < 4);
+  for (j = 0; j < 3; j++)
+    assert(*buf[s] == s * 2);
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --workers=2 --allocate-determ %t1.bc
+// RUN: grep "completed paths = 16" %t.klee-out/info
+// RUN: grep "generated tests = 16" %t.klee-out/info
+// RUN: ls %t.klee-out | FileCheck %s
+
+/* The paths are split between the workers, whose test cases are moved
+ * into the output directory and numbered in sequence. A worker runs
+ * several prefixes, each of which reads a constant array at a symbolic
+ * index.
+ */
+
+// CHECK: run.stats
+// CHECK: test000001.ktest
+// CHECK: test000016.ktest
+// CHECK-NOT: test000017.ktest
+// CHECK: worker0
+// CHECK: worker1
+
+#include <stdio.h>
+
+static const unsigned char weights[4] = { 0, 1, 1, 2 };
+
+int main() {
+  unsigned x, i, n = 0;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  for (i = 0; i < 2; i++) {
+    if (x & (1 << i))
+      n++;
+    switch ((x >> (8 + 2 * i)) & 3) {
+    case 1:
+      n += 2;
+      break;
+    default:
+      break;
+    }
+  }
+  n += weights[x >> 30];
+  printf("%u\n", n);
+  return 0;
+}
@@ -22,7 +22,9 @@
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprVisitor.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
+#include "klee/util/BinaryQueryLog.h"
 #include "klee/Internal/Support/PrintVersion.h"
+#include "klee/Internal/System/Time.h"
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
@@ -194,6 +196,24 @@ static bool PrintInputAST(const char *Filename,
   return success;
 }
 
+static Solver *createSolver() {
+  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
+
+  if (CoreSolverToUse != DUMMY_SOLVER) {
+    if (0 != MaxCoreSolverTime) {
+      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
+    }
+  }
+
+  return constructSolverChain(coreSolver,
+                              getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_BINARY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_BINARY_FILE_NAME));
+}
+
 static bool EvaluateInputAST(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder) {
@@ -213,19 +233,7 @@ static bool EvaluateInputAST(const char *Filename,
   if (!success)
     return false;
 
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
-
-  if (CoreSolverToUse != DUMMY_SOLVER) {
-    if (0 != MaxCoreSolverTime) {
-      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
-    }
-  }
-
-  Solver *S = constructSolverChain(coreSolver,
-                                   getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME));
+  Solver *S = createSolver();
 
   unsigned Index = 0;
   for (std::vector<Decl*>::iterator it = Decls.begin(),
@@ -326,6 +334,86 @@ static bool EvaluateInputAST(const char *Filename,
   return success;
 }
 
+/// Issue the queries of a binary query log again, comparing the answers and
+/// the time taken by the solver with those of the log.
+static bool ReplayBinaryQueryLog(const char *Filename,
+                                 const MemoryBuffer *MB) {
+  BinaryQueryLogReader reader(MB->getBufferStart(), MB->getBufferEnd());
+  Solver *S = createSolver();
+
+  unsigned index = 0, failures = 0, mismatches = 0;
+  double loggedTime = 0, replayTime = 0;
+  BinaryQueryLogRecord record;
+  while (reader.next(record)) {
+    ConstraintManager constraints(record.constraints);
+    Query query(constraints, record.expr);
+    BinaryQueryLogRecord result;
+
+    double start = util::getWallTime();
+    switch (record.kind) {
+    case BinaryQueryLogRecord::Truth:
+      result.success = S->impl->computeTruth(query, result.isValid);
+      break;
+    case BinaryQueryLogRecord::Validity:
+      result.success = S->impl->computeValidity(query, result.validity);
+      break;
+    case BinaryQueryLogRecord::Value:
+      result.success = S->impl->computeValue(query, result.value);
+      break;
+    case BinaryQueryLogRecord::InitialValues:
+      result.success = S->impl->computeInitialValues(
+          query, record.objects, result.values, result.hasSolution);
+      break;
+    }
+    double time = util::getWallTime() - start;
+
+    if (record.success)
+      loggedTime += record.time;
+    replayTime += time;
+    if (!result.success)
+      ++failures;
+
+    // Values and counterexamples may differ without either being wrong
+    bool matches = true;
+    if (record.success && result.success) {
+      switch (record.kind) {
+      case BinaryQueryLogRecord::Truth:
+        matches = record.isValid == result.isValid;
+        break;
+      case BinaryQueryLogRecord::Validity:
+        matches = record.validity == result.validity;
+        break;
+      case BinaryQueryLogRecord::Value:
+        break;
+      case BinaryQueryLogRecord::InitialValues:
+        matches = record.hasSolution == result.hasSolution;
+        break;
+      }
+    }
+    if (!matches) {
+      llvm::outs() << "Query " << index << ":\tresult differs from the log\n";
+      ++mismatches;
+    }
+    ++index;
+  }
+
+  delete S;
+
+  bool success = reader.getError().empty();
+  if (!success)
+    llvm::errs() << Filename << ": " << reader.getError() << "\n";
+
+  llvm::outs()
+    << "--\n"
+    << "replayed queries = " << index << "\n"
+    << "failed queries = " << failures << "\n"
+    << "mismatched results = " << mismatches << "\n"
+    << "logged solver time = " << loggedTime << "\n"
+    << "replay solver time = " << replayTime << "\n";
+
+  return success && !mismatches;
+}
+
 static bool printInputAsSMTLIBv2(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder)
@@ -448,8 +536,13 @@ int main(int argc, char **argv) {
                             Builder);
     break;
   case Evaluate:
-    success = EvaluateInputAST(InputFile=="-" ? "<stdin>" : InputFile.c_str(),
-                               MB.get(), Builder);
+    if (BinaryQueryLogReader::isBinaryQueryLog(MB->getBufferStart(),
+                                               MB->getBufferEnd()))
+      success = ReplayBinaryQueryLog(
+          InputFile == "-" ? "<stdin>" : InputFile.c_str(), MB.get());
+    else
+      success = EvaluateInputAST(
+          InputFile == "-" ? "<stdin>" : InputFile.c_str(), MB.get(), Builder);
     break;
   case PrintSMTLIBv2:
     success = printInputAsSMTLIBv2(InputFile=="-"? "<stdin>" : InputFile.c_str(), MB.get(),Builder);
@@ -16,6 +16,7 @@
 #include "klee/Config/Version.h"
 #include "klee/Internal/ADT/KTest.h"
 #include "klee/Internal/ADT/TreeStream.h"
+#include "klee/Internal/Support/AsyncFileWriter.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ModuleUtil.h"
 #include "klee/Internal/System/Time.h"
@@ -53,6 +54,7 @@
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -68,12 +70,15 @@
 #endif
 
 #include <dirent.h>
+#include <poll.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
@@ -225,21 +230,125 @@ namespace {
 	     cl::desc("Stop execution after generating the given number of tests.  Extra tests corresponding to partially explored paths will also be dumped."),
 	     cl::init(0));
 
+  cl::opt<bool>
+  WriteTestsAsync("write-tests-async",
+                  cl::desc("Write test case files on a background thread, "
+                           "so that exploration does not wait for the disk "
+                           "(default=on)"),
+                  cl::init(true));
+
   cl::opt<bool>
   Watchdog("watchdog",
            cl::desc("Use a watchdog process to enforce --max-time."),
            cl::init(0));
+
+  cl::opt<unsigned>
+  Workers("workers",
+          cl::desc("Explore with the given number of worker processes, which "
+                   "hand over states to each other as path prefixes. Use "
+                   "--allocate-determ if the program forks on symbolic "
+                   "pointers (default=0 (off))"),
+          cl::init(0));
+
+  cl::opt<std::string>
+  ModuleCacheDir("module-cache-dir",
+                 cl::desc("Directory keeping prepared modules, named by a "
+                          "hash of the program, runtime libraries and "
+                          "options, for reuse by later runs (default=off)"),
+                 cl::init(""));
 }
 
 extern cl::opt<double> MaxTime;
 
 /***/
 
+// Pipes from and to the coordinator, in a worker process of --workers.
+// Messages are lines of text; paths are strings of '0' and '1'.
+static int workerIn = -1, workerOut = -1;
+
+static void writeLine(int fd, const std::string &line) {
+  std::string buffer = line + "\n";
+  const char *pos = buffer.data();
+  size_t left = buffer.size();
+  while (left) {
+    ssize_t written = write(fd, pos, left);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_error("unable to write to worker pipe: %s", strerror(errno));
+    }
+    pos += written;
+    left -= written;
+  }
+}
+
+/// Read a line, without its newline. Returns false at end of file.
+static bool readLine(int fd, std::string &line) {
+  line.clear();
+  for (;;) {
+    char c;
+    ssize_t r = read(fd, &c, 1);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    if (c == '\n')
+      return true;
+    line += c;
+  }
+}
+
+static std::string encodePath(const std::vector<bool> &path) {
+  std::string result;
+  for (std::vector<bool>::const_iterator it = path.begin(), ie = path.end();
+       it != ie; ++it)
+    result += *it ? '1' : '0';
+  return result;
+}
+
+static void decodePath(const std::string &s, std::vector<bool> &path) {
+  path.clear();
+  for (std::string::const_iterator it = s.begin(), ie = s.end(); it != ie;
+       ++it)
+    path.push_back(*it == '1');
+}
+
+/// Get the next path prefix to explore from the coordinator. Returns false
+/// when there is no work left.
+static bool getWork(std::vector<bool> &prefix) {
+  writeLine(workerOut, "idle");
+  for (;;) {
+    std::string line;
+    if (!readLine(workerIn, line) || line == "exit")
+      return false;
+    if (line == "share") {
+      // Asked while finishing the previous prefix
+      writeLine(workerOut, "none");
+    } else {
+      assert(line.compare(0, 4, "run ") == 0 && "unexpected message");
+      decodePath(line.substr(4), prefix);
+      return true;
+    }
+  }
+}
+
+/// The writer of test case files of --write-tests-async, if started
+static AsyncFileWriter *testWriter = 0;
+
+/// Write the queued test case files when exiting on an error
+static void flushTestWriter() {
+  if (testWriter)
+    testWriter->flush();
+}
+
 class KleeHandler : public InterpreterHandler {
 private:
   Interpreter *m_interpreter;
   TreeStreamWriter *m_pathWriter, *m_symPathWriter;
   llvm::raw_ostream *m_infoFile;
+  /// Started with the first test case rather than in the constructor, as
+  /// the thread would not survive forking the workers
+  AsyncFileWriter *m_testWriter;
 
   SmallString<128> m_outputDirectory;
 
@@ -265,10 +374,15 @@ public:
                        const char *errorMessage,
                        const char *errorSuffix);
 
+  bool isStateWanted();
+  void shareState(const std::vector<bool> *path);
+
   std::string getOutputFilename(const std::string &filename);
   llvm::raw_fd_ostream *openOutputFile(const std::string &filename);
   std::string getTestFilename(const std::string &suffix, unsigned id);
-  llvm::raw_fd_ostream *openTestFile(const std::string &suffix, unsigned id);
+  llvm::raw_ostream *openTestFile(const std::string &suffix, unsigned id);
+  /// Wait until all test case files are written
+  void flushTestFiles();
 
   // load a .path file
   static void loadPathFile(std::string name,
@@ -285,6 +399,7 @@ KleeHandler::KleeHandler(int argc, char **argv)
     m_pathWriter(0),
     m_symPathWriter(0),
     m_infoFile(0),
+    m_testWriter(0),
     m_outputDirectory(),
     m_testIndex(0),
     m_pathsExplored(0),
@@ -362,6 +477,10 @@ KleeHandler::KleeHandler(int argc, char **argv)
 KleeHandler::~KleeHandler() {
   if (m_pathWriter) delete m_pathWriter;
   if (m_symPathWriter) delete m_symPathWriter;
+  if (m_testWriter) {
+    testWriter = 0;
+    delete m_testWriter;
+  }
   fclose(klee_warning_file);
   fclose(klee_message_file);
   delete m_infoFile;
@@ -370,7 +489,8 @@ KleeHandler::~KleeHandler() {
 void KleeHandler::setInterpreter(Interpreter *i) {
   m_interpreter = i;
 
-  if (WritePaths) {
+  // Workers hand over states as their path
+  if (WritePaths || workerIn >= 0) {
     m_pathWriter = new TreeStreamWriter(getOutputFilename("paths.ts"));
     assert(m_pathWriter->good());
     m_interpreter->setPathWriter(m_pathWriter);
@@ -418,9 +538,17 @@ std::string KleeHandler::getTestFilename(const std::string &suffix, unsigned id)
   return filename.str();
 }
 
-llvm::raw_fd_ostream *KleeHandler::openTestFile(const std::string &suffix,
-                                                unsigned id) {
-  return openOutputFile(getTestFilename(suffix, id));
+llvm::raw_ostream *KleeHandler::openTestFile(const std::string &suffix,
+                                             unsigned id) {
+  std::string filename = getTestFilename(suffix, id);
+  if (m_testWriter)
+    return new async_file_ostream(*m_testWriter, getOutputFilename(filename));
+  return openOutputFile(filename);
+}
+
+void KleeHandler::flushTestFiles() {
+  if (m_testWriter)
+    m_testWriter->flush();
 }
 
 
@@ -445,6 +573,12 @@ void KleeHandler::processTestCase(const ExecutionState &state,
 
     double start_time = util::getWallTime();
 
+    if (WriteTestsAsync && !m_testWriter) {
+      m_testWriter = new AsyncFileWriter();
+      testWriter = m_testWriter;
+      atexit(flushTestWriter);
+    }
+
     unsigned id = ++m_testIndex;
 
     if (success) {
@@ -481,8 +615,18 @@ void KleeHandler::processTestCase(const ExecutionState &state,
         }
         std::string ext = extStream.str();
 
-        if (!kTest_toFile(
-                 &b, getOutputFilename(getTestFilename(ext, id)).c_str())) {
+        std::string path = getOutputFilename(getTestFilename(ext, id));
+        if (m_testWriter) {
+          size_t size;
+          unsigned char *buffer = kTest_toBuffer(&b, &size);
+          if (buffer) {
+            std::string contents((const char *)buffer, size);
+            free(buffer);
+            m_testWriter->write(path, contents);
+          } else {
+            klee_warning("unable to write output test case, losing it");
+          }
+        } else if (!kTest_toFile(&b, path.c_str())) {
           klee_warning("unable to write output test case, losing it");
         }
 
@@ -500,11 +644,11 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       delete f;
     }
 
-    if (m_pathWriter) {
+    if (WritePaths) {
       std::vector<unsigned char> concreteBranches;
       m_pathWriter->readStream(m_interpreter->getPathStreamID(state),
                                concreteBranches);
-      llvm::raw_fd_ostream *f = openTestFile("path", id);
+      llvm::raw_ostream *f = openTestFile("path", id);
       for (std::vector<unsigned char>::iterator I = concreteBranches.begin(),
                                                 E = concreteBranches.end();
            I != E; ++I) {
@@ -621,7 +765,7 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       std::vector<unsigned char> symbolicBranches;
       m_symPathWriter->readStream(m_interpreter->getSymbolicPathStreamID(state),
                                   symbolicBranches);
-      llvm::raw_fd_ostream *f = openTestFile("sym.path", id);
+      llvm::raw_ostream *f = openTestFile("sym.path", id);
       for (std::vector<unsigned char>::iterator I = symbolicBranches.begin(), E = symbolicBranches.end(); I!=E; ++I) {
         *f << *I << "\n";
       }
@@ -673,6 +817,27 @@ void KleeHandler::processTestCase(const ExecutionState &state,
   }
 }
 
+bool KleeHandler::isStateWanted() {
+  if (workerIn < 0)
+    return false;
+  struct pollfd p;
+  p.fd = workerIn;
+  p.events = POLLIN;
+  if (poll(&p, 1, 0) <= 0)
+    return false;
+
+  // Only requests for states are sent while a prefix is explored
+  std::string line;
+  if (!readLine(workerIn, line))
+    klee_error("lost the connection to the coordinator");
+  assert(line == "share" && "unexpected message");
+  return true;
+}
+
+void KleeHandler::shareState(const std::vector<bool> *path) {
+  writeLine(workerOut, path ? "path " + encodePath(*path) : "none");
+}
+
   // load a .path file
 void KleeHandler::loadPathFile(std::string name,
                                      std::vector<bool> &buffer) {
@@ -1288,6 +1453,428 @@ static llvm::Module *linkWithUclibc(llvm::Module *mainModule, StringRef libDir)
 }
 #endif
 
+/***/
+
+// The module cache keeps modules as they are after linking with the runtime
+// libraries and KModule::prepare, named by a hash of everything they are
+// built from, so that later runs on the same program skip both.
+
+static void hashFile(MD5 &hash, const std::string &path) {
+  std::ifstream f(path.c_str(), std::ios::in | std::ios::binary);
+  char buffer[65536];
+  while (f.good()) {
+    f.read(buffer, sizeof(buffer));
+    hash.update(StringRef(buffer, f.gcount()));
+  }
+  // The name, with its terminator, separates the contents of files
+  hash.update(StringRef(path.c_str(), path.size() + 1));
+}
+
+static std::string getModuleCachePath(int argc, char **argv,
+                                      const std::string &libraryDir) {
+  MD5 hash;
+
+  // The klee binary, by size and modification time
+  struct stat st;
+  if (stat("/proc/self/exe", &st) == 0) {
+    uint64_t identity[2] = { (uint64_t)st.st_size, (uint64_t)st.st_mtime };
+    hash.update(StringRef((const char *)identity, sizeof(identity)));
+  }
+
+  // The options, up to the program, except those naming output locations
+  for (int i = 1; i < argc && InputFile != argv[i]; ++i) {
+    std::string arg = argv[i];
+    std::string name = arg.substr(0, arg.find('='));
+    name.erase(0, name.find_first_not_of('-'));
+    if (name == "output-dir" || name == "module-cache-dir") {
+      if (arg.find('=') == std::string::npos)
+        ++i;
+      continue;
+    }
+    hash.update(StringRef(arg.c_str(), arg.size() + 1));
+  }
+
+  hashFile(hash, InputFile);
+  for (std::vector<std::string>::iterator it = LinkLibraries.begin(),
+         ie = LinkLibraries.end(); it != ie; ++it)
+    hashFile(hash, *it);
+
+  // Any of the runtime libraries may be linked in
+  std::vector<std::string> libraries;
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+  error_code ec;
+#else
+  std::error_code ec;
+#endif
+  for (llvm::sys::fs::directory_iterator i(libraryDir, ec), e; i != e && !ec;
+       i.increment(ec))
+    libraries.push_back((*i).path());
+  std::sort(libraries.begin(), libraries.end());
+  for (std::vector<std::string>::iterator it = libraries.begin(),
+         ie = libraries.end(); it != ie; ++it)
+    hashFile(hash, *it);
+
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> digest;
+  MD5::stringifyResult(result, digest);
+
+  SmallString<128> path(ModuleCacheDir);
+  llvm::sys::path::append(path, digest.str() + ".bc");
+  return path.str().str();
+}
+
+static void writeModuleCache(Module *module, const std::string &path) {
+  if (mkdir(ModuleCacheDir.c_str(), 0775) < 0 && errno != EEXIST) {
+    klee_warning("unable to create module cache directory %s: %s",
+                 ModuleCacheDir.c_str(), sys::StrError(errno).c_str());
+    return;
+  }
+
+  // Written under a temporary name, as other runs may read or write the
+  // same entry meanwhile
+  std::stringstream tmp;
+  tmp << path << "." << getpid() << ".tmp";
+  std::string Error;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3,5)
+  llvm::raw_fd_ostream f(tmp.str().c_str(), Error, llvm::sys::fs::F_None);
+#elif LLVM_VERSION_CODE >= LLVM_VERSION(3,4)
+  llvm::raw_fd_ostream f(tmp.str().c_str(), Error, llvm::sys::fs::F_Binary);
+#else
+  llvm::raw_fd_ostream f(tmp.str().c_str(), Error,
+                         llvm::raw_fd_ostream::F_Binary);
+#endif
+  if (!Error.empty()) {
+    klee_warning("unable to write module cache %s: %s", tmp.str().c_str(),
+                 Error.c_str());
+    return;
+  }
+  WriteBitcodeToFile(module, f);
+  f.close();
+  if (f.has_error() || rename(tmp.str().c_str(), path.c_str()) < 0) {
+    f.clear_error();
+    klee_warning("unable to write module cache %s", path.c_str());
+    unlink(tmp.str().c_str());
+  }
+}
+
+/***/
+
+namespace {
+/// A worker process of --workers, as seen by the coordinator
+struct WorkerInfo {
+  pid_t pid;
+  int in, out; // pipes from and to the worker
+  std::string directory;
+  bool idle;   // waiting for a prefix to explore
+  bool asked;  // asked for a state, without an answer yet
+  bool done;   // finished, after reporting its counts
+  uint64_t instructions, paths, tests;
+};
+}
+
+static void interrupt_handle_coordinator() {
+  // The workers are interrupted too; wait for them to finish
+  interrupted = true;
+}
+
+/// Move the test cases of the workers into the output directory, numbered
+/// by worker and then by their number in the worker.
+static void mergeTestCases(KleeHandler &handler,
+                           std::vector<WorkerInfo> &workers) {
+  unsigned id = 0;
+  for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+         ie = workers.end(); it != ie; ++it) {
+    // The suffixes of the files of each test, e.g. "ktest" and "path"
+    std::map<unsigned, std::vector<std::string> > tests;
+    DIR *dir = opendir(it->directory.c_str());
+    if (!dir)
+      continue;
+    while (struct dirent *entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.size() < 12 || name.compare(0, 4, "test") || name[10] != '.')
+        continue;
+      char *end;
+      unsigned long n = strtoul(name.c_str() + 4, &end, 10);
+      if (end != name.c_str() + 10)
+        continue;
+      tests[n].push_back(name.substr(11));
+    }
+    closedir(dir);
+
+    for (std::map<unsigned, std::vector<std::string> >::iterator
+           tit = tests.begin(), tie = tests.end(); tit != tie; ++tit) {
+      ++id;
+      for (std::vector<std::string>::iterator sit = tit->second.begin(),
+             sie = tit->second.end(); sit != sie; ++sit) {
+        SmallString<128> from(it->directory);
+        sys::path::append(from, handler.getTestFilename(*sit, tit->first));
+        std::string to =
+            handler.getOutputFilename(handler.getTestFilename(*sit, id));
+        if (rename(from.c_str(), to.c_str()) < 0)
+          klee_warning("unable to move \"%s\": %s", from.c_str(),
+                       strerror(errno));
+      }
+    }
+  }
+}
+
+/// Write a run.stats with a single row adding up the last rows of the
+/// workers. As the workers cover overlapping code, the covered and
+/// uncovered instruction counts are those of the worker covering the most.
+static void mergeRunStats(KleeHandler &handler,
+                          std::vector<WorkerInfo> &workers, double wallTime) {
+  std::string header;
+  std::vector<std::string> columns;
+  std::vector<double> total;
+  double mostCovered = -1;
+  for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+         ie = workers.end(); it != ie; ++it) {
+    SmallString<128> path(it->directory);
+    sys::path::append(path, "run.stats");
+    std::ifstream f(path.c_str());
+    std::string line, last;
+    if (!std::getline(f, line))
+      continue;
+    if (header.empty()) {
+      header = line;
+      std::stringstream names(line.substr(1, line.size() - 2));
+      std::string name;
+      while (std::getline(names, name, ','))
+        columns.push_back(name);
+      total.assign(columns.size(), 0);
+    }
+    while (std::getline(f, line))
+      if (!line.empty())
+        last = line;
+    if (last.size() < 2)
+      continue;
+
+    std::vector<double> row;
+    std::stringstream values(last.substr(1, last.size() - 2));
+    std::string value;
+    while (std::getline(values, value, ','))
+      row.push_back(atof(value.c_str()));
+    row.resize(columns.size(), 0);
+
+    for (unsigned i = 0; i < columns.size(); ++i) {
+      if (columns[i] == "'CoveredInstructions'") {
+        if (row[i] > mostCovered) {
+          mostCovered = row[i];
+          total[i] = row[i];
+          for (unsigned j = 0; j < columns.size(); ++j)
+            if (columns[j] == "'UncoveredInstructions'")
+              total[j] = row[j];
+        }
+      } else if (columns[i] != "'UncoveredInstructions'") {
+        total[i] += row[i];
+      }
+    }
+  }
+  if (header.empty())
+    return;
+
+  llvm::raw_fd_ostream *f = handler.openOutputFile("run.stats");
+  if (!f)
+    return;
+  *f << header << "\n(";
+  for (unsigned i = 0; i < columns.size(); ++i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g",
+             columns[i] == "'WallTime'" ? wallTime : total[i]);
+    *f << (i ? "," : "") << buf;
+  }
+  *f << ")\n";
+  delete f;
+}
+
+/// Hand out the paths to explore to the workers until all of them are
+/// idle, then merge their output. Exploration starts from the root with a
+/// single worker; idle workers get the states that busy workers are asked
+/// to give away.
+static int coordinateWorkers(KleeHandler &handler,
+                             std::vector<WorkerInfo> &workers) {
+  double startTime = util::getWallTime();
+  std::deque<std::string> work(1, "");
+
+  for (;;) {
+    unsigned idle = 0, busy = 0;
+    bool asking = false;
+    for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+           ie = workers.end(); it != ie; ++it) {
+      if (it->done)
+        continue;
+      if (it->idle && !work.empty() && !interrupted) {
+        writeLine(it->out, "run " + work.front());
+        work.pop_front();
+        it->idle = false;
+      }
+      if (it->idle)
+        ++idle;
+      else
+        ++busy;
+      asking |= it->asked;
+    }
+    if (!idle && !busy)
+      break;
+    if (!busy && !asking && (work.empty() || interrupted))
+      break;
+
+    if (idle && work.empty() && !interrupted) {
+      for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+             ie = workers.end(); it != ie; ++it) {
+        if (!it->done && !it->idle && !it->asked) {
+          writeLine(it->out, "share");
+          it->asked = true;
+        }
+      }
+    }
+
+    std::vector<struct pollfd> fds;
+    std::vector<unsigned> index;
+    for (unsigned i = 0; i < workers.size(); ++i) {
+      if (workers[i].done)
+        continue;
+      struct pollfd p;
+      p.fd = workers[i].in;
+      p.events = POLLIN;
+      p.revents = 0;
+      fds.push_back(p);
+      index.push_back(i);
+    }
+    if (poll(&fds[0], fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_error("unable to poll the workers: %s", strerror(errno));
+    }
+
+    for (unsigned k = 0; k < fds.size(); ++k) {
+      if (!fds[k].revents)
+        continue;
+      WorkerInfo &w = workers[index[k]];
+      std::string line;
+      if (!readLine(w.in, line)) {
+        klee_warning("worker %u exited unexpectedly", index[k]);
+        w.done = true;
+      } else if (line == "idle") {
+        w.idle = true;
+      } else if (line == "none") {
+        w.asked = false;
+      } else if (line.compare(0, 5, "path ") == 0) {
+        work.push_back(line.substr(5));
+        w.asked = false;
+      } else if (line.compare(0, 5, "done ") == 0) {
+        std::istringstream counts(line.substr(5));
+        counts >> w.instructions >> w.paths >> w.tests;
+        w.done = true;
+      }
+    }
+  }
+
+  for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+         ie = workers.end(); it != ie; ++it) {
+    if (!it->done)
+      writeLine(it->out, "exit");
+    std::string line;
+    while (!it->done && readLine(it->in, line)) {
+      if (line.compare(0, 5, "done ") == 0) {
+        std::istringstream counts(line.substr(5));
+        counts >> it->instructions >> it->paths >> it->tests;
+        it->done = true;
+      }
+    }
+    int status;
+    while (waitpid(it->pid, &status, 0) < 0 && errno == EINTR)
+      ;
+    close(it->in);
+    close(it->out);
+  }
+
+  mergeTestCases(handler, workers);
+  mergeRunStats(handler, workers, util::getWallTime() - startTime);
+
+  uint64_t instructions = 0, paths = 0, tests = 0;
+  for (std::vector<WorkerInfo>::iterator it = workers.begin(),
+         ie = workers.end(); it != ie; ++it) {
+    instructions += it->instructions;
+    paths += it->paths;
+    tests += it->tests;
+  }
+
+  std::stringstream stats;
+  stats << "\n";
+  stats << "KLEE: done: workers = " << workers.size() << "\n";
+  stats << "KLEE: done: total instructions = " << instructions << "\n";
+  stats << "KLEE: done: completed paths = " << paths << "\n";
+  stats << "KLEE: done: generated tests = " << tests << "\n";
+
+  bool useColors = llvm::errs().is_displayed();
+  if (useColors)
+    llvm::errs().changeColor(llvm::raw_ostream::GREEN,
+                             /*bold=*/true,
+                             /*bg=*/false);
+  llvm::errs() << stats.str();
+  if (useColors)
+    llvm::errs().resetColor();
+  handler.getInfoStream() << stats.str();
+
+  return 0;
+}
+
+/// Fork the worker processes of --workers. Returns in each worker, after
+/// pointing --output-dir to a directory of its own inside the output
+/// directory. The coordinator exits once the exploration is over.
+static void startWorkers() {
+  KleeHandler *handler = new KleeHandler(0, 0);
+  std::vector<WorkerInfo> workers(Workers);
+
+  fflush(stdout);
+  fflush(stderr);
+  fflush(klee_warning_file);
+  fflush(klee_message_file);
+  for (unsigned i = 0; i < Workers; ++i) {
+    int toWorker[2], fromWorker[2];
+    if (pipe(toWorker) < 0 || pipe(fromWorker) < 0)
+      klee_error("unable to create worker pipes: %s", strerror(errno));
+
+    std::stringstream name;
+    name << "worker" << i;
+    std::string directory = handler->getOutputFilename(name.str());
+
+    pid_t pid = fork();
+    if (pid < 0)
+      klee_error("unable to fork worker: %s", strerror(errno));
+    if (pid == 0) {
+      for (unsigned j = 0; j < i; ++j) {
+        close(workers[j].in);
+        close(workers[j].out);
+      }
+      close(toWorker[1]);
+      close(fromWorker[0]);
+      workerIn = toWorker[0];
+      workerOut = fromWorker[1];
+      OutputDir = directory;
+      return;
+    }
+
+    close(toWorker[0]);
+    close(fromWorker[1]);
+    WorkerInfo &w = workers[i];
+    w.pid = pid;
+    w.in = fromWorker[0];
+    w.out = toWorker[1];
+    w.directory = directory;
+    w.idle = w.asked = w.done = false;
+    w.instructions = w.paths = w.tests = 0;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  sys::SetInterruptFunction(interrupt_handle_coordinator);
+  int status = coordinateWorkers(*handler, workers);
+  delete handler;
+  exit(status);
+}
+
 int main(int argc, char **argv, char **envp) {
   atexit(llvm_shutdown);  // Call llvm_shutdown() on exit.
 
@@ -1364,15 +1951,34 @@ int main(int argc, char **argv, char **envp) {
 
   sys::SetInterruptFunction(interrupt_handle);
 
-  // Load the bytecode...
+  if (Workers) {
+    if (!ReplayKTestDir.empty() || !ReplayKTestFile.empty() ||
+        ReplayPathFile != "" || !SeedOutFile.empty() || !SeedOutDir.empty())
+      klee_error("--workers cannot be used with replay or seeds");
+    startWorkers();
+  }
+
+  // Load the bytecode, or the prepared module from the module cache...
+  std::string moduleCachePath, moduleFile = InputFile;
+  bool cachedModule = false;
+  if (!ModuleCacheDir.empty()) {
+    moduleCachePath = getModuleCachePath(
+        argc, argv, KleeHandler::getRunTimeLibraryPath(argv[0]));
+    if (access(moduleCachePath.c_str(), R_OK) == 0) {
+      klee_message("NOTE: Using prepared module: %s", moduleCachePath.c_str());
+      moduleFile = moduleCachePath;
+      cachedModule = true;
+    }
+  }
+
   std::string ErrorMsg;
   LLVMContext ctx;
   Module *mainModule = 0;
 #if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
   OwningPtr<MemoryBuffer> BufferPtr;
-  error_code ec=MemoryBuffer::getFileOrSTDIN(InputFile.c_str(), BufferPtr);
+  error_code ec=MemoryBuffer::getFileOrSTDIN(moduleFile.c_str(), BufferPtr);
   if (ec) {
-    klee_error("error loading program '%s': %s", InputFile.c_str(),
+    klee_error("error loading program '%s': %s", moduleFile.c_str(),
                ec.message().c_str());
   }
 
@@ -1385,18 +1991,18 @@ int main(int argc, char **argv, char **envp) {
     }
   }
   if (!mainModule)
-    klee_error("error loading program '%s': %s", InputFile.c_str(),
+    klee_error("error loading program '%s': %s", moduleFile.c_str(),
                ErrorMsg.c_str());
 #else
-  auto Buffer = MemoryBuffer::getFileOrSTDIN(InputFile.c_str());
+  auto Buffer = MemoryBuffer::getFileOrSTDIN(moduleFile.c_str());
   if (!Buffer)
-    klee_error("error loading program '%s': %s", InputFile.c_str(),
+    klee_error("error loading program '%s': %s", moduleFile.c_str(),
                Buffer.getError().message().c_str());
 
   auto mainModuleOrError = getLazyBitcodeModule(Buffer->get(), ctx);
 
   if (!mainModuleOrError) {
-    klee_error("error loading program '%s': %s", InputFile.c_str(),
+    klee_error("error loading program '%s': %s", moduleFile.c_str(),
                mainModuleOrError.getError().message().c_str());
   }
   else {
@@ -1407,12 +2013,12 @@ int main(int argc, char **argv, char **envp) {
 
   mainModule = *mainModuleOrError;
   if (auto ec = mainModule->materializeAllPermanently()) {
-    klee_error("error loading program '%s': %s", InputFile.c_str(),
+    klee_error("error loading program '%s': %s", moduleFile.c_str(),
                ec.message().c_str());
   }
 #endif
 
-  if (WithPOSIXRuntime) {
+  if (WithPOSIXRuntime && !cachedModule) {
     int r = initEnv(mainModule);
     if (r != 0)
       return r;
@@ -1423,45 +2029,50 @@ int main(int argc, char **argv, char **envp) {
                                   /*Optimize=*/OptimizeModule,
                                   /*CheckDivZero=*/CheckDivZero,
                                   /*CheckOvershift=*/CheckOvershift);
+  Opts.Prepared = cachedModule;
 
-  switch (Libc) {
-  case NoLibc: /* silence compiler warning */
-    break;
+  // A prepared module is linked already
+  if (!cachedModule) {
+    switch (Libc) {
+    case NoLibc: /* silence compiler warning */
+      break;
 
-  case KleeLibc: {
-    // FIXME: Find a reasonable solution for this.
-    SmallString<128> Path(Opts.LibraryDir);
+    case KleeLibc: {
+      // FIXME: Find a reasonable solution for this.
+      SmallString<128> Path(Opts.LibraryDir);
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3,3)
-    llvm::sys::path::append(Path, "klee-libc.bc");
+      llvm::sys::path::append(Path, "klee-libc.bc");
 #else
-    llvm::sys::path::append(Path, "libklee-libc.bca");
+      llvm::sys::path::append(Path, "libklee-libc.bca");
 #endif
-    mainModule = klee::linkWithLibrary(mainModule, Path.c_str());
-    assert(mainModule && "unable to link with klee-libc");
-    break;
-  }
+      mainModule = klee::linkWithLibrary(mainModule, Path.c_str());
+      assert(mainModule && "unable to link with klee-libc");
+      break;
+    }
 
-  case UcLibc:
-    mainModule = linkWithUclibc(mainModule, LibraryDir);
-    break;
-  }
+    case UcLibc:
+      mainModule = linkWithUclibc(mainModule, LibraryDir);
+      break;
+    }
 
-  if (WithPOSIXRuntime) {
-    SmallString<128> Path(Opts.LibraryDir);
-    llvm::sys::path::append(Path, "libkleeRuntimePOSIX.bca");
-    klee_message("NOTE: Using model: %s", Path.c_str());
-    mainModule = klee::linkWithLibrary(mainModule, Path.c_str());
-    assert(mainModule && "unable to link with simple model");
-  }
+    if (WithPOSIXRuntime) {
+      SmallString<128> Path(Opts.LibraryDir);
+      llvm::sys::path::append(Path, "libkleeRuntimePOSIX.bca");
+      klee_message("NOTE: Using model: %s", Path.c_str());
+      mainModule = klee::linkWithLibrary(mainModule, Path.c_str());
+      assert(mainModule && "unable to link with simple model");
+    }
 
-  std::vector<std::string>::iterator libs_it;
-  std::vector<std::string>::iterator libs_ie;
-  for (libs_it = LinkLibraries.begin(), libs_ie = LinkLibraries.end();
-          libs_it != libs_ie; ++libs_it) {
-    const char * libFilename = libs_it->c_str();
-    klee_message("Linking in library: %s.\n", libFilename);
-    mainModule = klee::linkWithLibrary(mainModule, libFilename);
+    std::vector<std::string>::iterator libs_it;
+    std::vector<std::string>::iterator libs_ie;
+    for (libs_it = LinkLibraries.begin(), libs_ie = LinkLibraries.end();
+            libs_it != libs_ie; ++libs_it) {
+      const char * libFilename = libs_it->c_str();
+      klee_message("Linking in library: %s.\n", libFilename);
+      mainModule = klee::linkWithLibrary(mainModule, libFilename);
+    }
   }
+
   // Get the desired main function.  klee_main initializes uClibc
   // locale and other data and then calls main.
   Function *mainFn = mainModule->getFunction(EntryPoint);
@@ -1516,6 +2127,7 @@ int main(int argc, char **argv, char **envp) {
 
   Interpreter::InterpreterOptions IOpts;
   IOpts.MakeConcreteSymbolic = MakeConcreteSymbolic;
+  IOpts.CompletePaths = workerIn >= 0;
   KleeHandler *handler = new KleeHandler(pArgc, pArgv);
   Interpreter *interpreter =
     theInterpreter = Interpreter::create(ctx, IOpts, handler);
@@ -1527,6 +2139,8 @@ int main(int argc, char **argv, char **envp) {
   handler->getInfoStream() << "PID: " << getpid() << "\n";
 
   Module *analysisModule = interpreter->setModule(mainModule, Opts);
+  if (!moduleCachePath.empty() && !cachedModule)
+    writeModuleCache(analysisModule, moduleCachePath);
 
   llvm::PassManager PM;
   TripCounter::instance = new TripCounter();
@@ -1638,7 +2252,21 @@ int main(int argc, char **argv, char **envp) {
                    sys::StrError(errno).c_str());
       }
     }
-    interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
+    if (workerIn >= 0) {
+      // Explore the prefixes handed out by the coordinator, until it has
+      // none left or the time is up
+      double startTime = util::getWallTime();
+      std::vector<bool> prefix;
+      while (!interrupted &&
+             !(MaxTime && util::getWallTime() - startTime >= MaxTime) &&
+             getWork(prefix)) {
+        interpreter->setReplayPathPrefix(&prefix);
+        interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
+      }
+      interpreter->setReplayPathPrefix(0);
+    } else {
+      interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
+    }
 
     while (!seeds.empty()) {
       kTest_free(seeds.back());
@@ -1660,6 +2288,7 @@ int main(int argc, char **argv, char **envp) {
   delete[] pArgv;
 
   delete interpreter;
+  handler->flushTestFiles();
 
   uint64_t queries =
     *theStatisticManager->getStatisticByName("Queries");
@@ -1713,6 +2342,13 @@ int main(int argc, char **argv, char **envp) {
 
   handler->getInfoStream() << stats.str();
 
+  if (workerOut >= 0) {
+    std::stringstream counts;
+    counts << "done " << instructions << " " << handler->getNumPathsExplored()
+           << " " << handler->getNumTestCases();
+    writeLine(workerOut, counts.str());
+  }
+
 #if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
   // FIXME: This really doesn't look right
   // This is preventing the module from being
@@ -10,6 +10,7 @@
 #include <iostream>
 #include "gtest/gtest.h"
 
+#include "klee/Constraints.h"
 #include "klee/Expr.h"
 #include "klee/util/ArrayCache.h"
 
@@ -264,4 +265,76 @@ TEST(ExprTest, ReadExprFoldingSymbolicIndexUpdate) {
     EXPECT_EQ(Expr::Read, read.get()->getKind());
   }
 }
+
+TEST(ExprTest, ConstraintFactors) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  UpdateList ua(a, 0), ub(b, 0);
+
+  ref<Expr> a0 = ReadExpr::create(ua, getConstant(0, Expr::Int32));
+  ref<Expr> a1 = ReadExpr::create(ua, getConstant(1, Expr::Int32));
+  ref<Expr> b0 = ReadExpr::create(ub, getConstant(0, Expr::Int32));
+  ref<Expr> b1 = ReadExpr::create(ub, getConstant(1, Expr::Int32));
+
+  ConstraintManager cm;
+  ref<Expr> c0 = UltExpr::create(a0, b0);
+  ref<Expr> c1 = UltExpr::create(a1, getConstant(5, Expr::Int8));
+  ref<Expr> c2 = UltExpr::create(b1, getConstant(5, Expr::Int8));
+  cm.addConstraint(c0);
+  cm.addConstraint(c1);
+  cm.addConstraint(c2);
+  ASSERT_TRUE(cm.hasFactors());
+
+  std::vector<ref<Expr> > result;
+  cm.getIndependentConstraints(UltExpr::create(b0, b1), result);
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ(c0, result[0]);
+  EXPECT_EQ(c2, result[1]);
+
+  // A read at a symbolic index depends on every element of the array, and
+  // forks share the factors only until one of them adds a constraint
+  ConstraintManager fork(cm);
+  ref<Expr> c3 = UltExpr::create(
+      ReadExpr::create(ub, ZExtExpr::create(a1, Expr::Int32)),
+      getConstant(3, Expr::Int8));
+  fork.addConstraint(c3);
+
+  std::vector<std::vector<ref<Expr> > > factors;
+  fork.getIndependentFactors(ref<Expr>(), factors);
+  ASSERT_EQ(1u, factors.size());
+  EXPECT_EQ(4u, factors[0].size());
+
+  factors.clear();
+  cm.getIndependentFactors(ref<Expr>(), factors);
+  EXPECT_EQ(3u, factors.size());
+}
+
+TEST(ExprTest, InternExprs) {
+  bool wasInterning = Expr::interning;
+  Expr::interning = true;
+
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("arr", 4);
+  ref<Expr> read = ReadExpr::create(UpdateList(a, 0), getConstant(0, 32));
+  ref<Expr> one = getConstant(1, 8);
+  unsigned count = Expr::count;
+  {
+    // Structurally equal expressions are the same node
+    ref<Expr> x = AddExpr::create(read, one);
+    ref<Expr> y = AddExpr::create(read, one);
+    EXPECT_TRUE(x->isInterned());
+    EXPECT_EQ(x.get(), y.get());
+    EXPECT_EQ(count + 1, Expr::count);
+  }
+  // The node is destroyed with its last reference, and leaves the table, so
+  // an equal expression created later is a fresh node
+  EXPECT_EQ(count, Expr::count);
+  ref<Expr> z = AddExpr::create(read, one);
+  EXPECT_TRUE(z->isInterned());
+  EXPECT_EQ(1u, z->refCount);
+  EXPECT_EQ(count + 1, Expr::count);
+
+  Expr::interning = wasInterning;
+}
 }
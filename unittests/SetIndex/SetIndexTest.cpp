@@ -0,0 +1,106 @@
+#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/SetIndex.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+struct IsEven {
+  bool operator()(int v) const { return v % 2 == 0; }
+};
+
+struct Any {
+  bool operator()(int) const { return true; }
+};
+
+SetIndex<int>::key_ty makeKey(const std::set<unsigned> &s) {
+  return SetIndex<int>::key_ty(s.begin(), s.end());
+}
+
+std::set<unsigned> randomSet(unsigned maxSize, unsigned range) {
+  std::set<unsigned> s;
+  unsigned n = rand() % (maxSize + 1);
+  while (s.size() < n)
+    s.insert(rand() % range);
+  return s;
+}
+
+}
+
+TEST(SetIndexTest, Lookup) {
+  SetIndex<int> index;
+  std::set<unsigned> a, b;
+  a.insert(1);
+  a.insert(3);
+  b.insert(3);
+
+  index.insert(makeKey(a), 1);
+  index.insert(makeKey(std::set<unsigned>()), 2);
+  ASSERT_EQ(*index.lookup(makeKey(a)), 1);
+  ASSERT_EQ(*index.lookup(makeKey(std::set<unsigned>())), 2);
+  ASSERT_TRUE(index.lookup(makeKey(b)) == 0);
+
+  // Inserting an existing set replaces its value
+  index.insert(makeKey(a), 3);
+  ASSERT_EQ(*index.lookup(makeKey(a)), 3);
+  ASSERT_EQ(index.size(), 2u);
+
+  index.clear();
+  ASSERT_TRUE(index.lookup(makeKey(a)) == 0);
+}
+
+TEST(SetIndexTest, SubsetsAndSupersets) {
+  SetIndex<int> index;
+  std::set<unsigned> a, ab, abc;
+  a.insert(70);
+  ab = a;
+  ab.insert(6); // same signature bit as 70
+  abc = ab;
+  abc.insert(2);
+
+  index.insert(makeKey(ab), 4);
+  ASSERT_EQ(*index.findSubset(makeKey(abc), Any()), 4);
+  ASSERT_EQ(*index.findSubset(makeKey(ab), Any()), 4);
+  ASSERT_TRUE(index.findSubset(makeKey(a), Any()) == 0);
+  ASSERT_EQ(*index.findSuperset(makeKey(a), Any()), 4);
+  ASSERT_EQ(*index.findSuperset(makeKey(ab), Any()), 4);
+  ASSERT_TRUE(index.findSuperset(makeKey(abc), Any()) == 0);
+
+  // The predicate filters the candidates
+  ASSERT_TRUE(index.findSubset(makeKey(abc), IsEven()) != 0);
+  index.insert(makeKey(ab), 5);
+  ASSERT_TRUE(index.findSubset(makeKey(abc), IsEven()) == 0);
+  ASSERT_TRUE(index.findSuperset(makeKey(a), IsEven()) == 0);
+}
+
+TEST(SetIndexTest, AgreesWithMapOfSets) {
+  srand(1);
+  SetIndex<int> index;
+  MapOfSets<unsigned, int> reference;
+  for (unsigned i = 0; i < 500; ++i) {
+    std::set<unsigned> s = randomSet(8, 40);
+    index.insert(makeKey(s), i);
+    reference.insert(s, i);
+  }
+
+  for (unsigned i = 0; i < 500; ++i) {
+    std::set<unsigned> s = randomSet(12, 40);
+    SetIndex<int>::key_ty key = makeKey(s);
+
+    int *v = index.lookup(key);
+    int *r = reference.lookup(s);
+    ASSERT_EQ(v == 0, r == 0);
+    if (v) {
+      ASSERT_EQ(*v, *r);
+    }
+
+    ASSERT_EQ(index.findSubset(key, IsEven()) == 0,
+              reference.findSubset(s, IsEven()) == 0);
+    ASSERT_EQ(index.findSuperset(key, IsEven()) == 0,
+              reference.findSuperset(s, IsEven()) == 0);
+  }
+}
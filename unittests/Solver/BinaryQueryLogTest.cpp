@@ -0,0 +1,191 @@
+//===-- BinaryQueryLogTest.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/BinaryQueryLog.h"
+#include "klee/util/ExprPPrinter.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace klee;
+
+namespace {
+
+// The reader creates arrays of its own, which compare differently from the
+// logged ones, so expressions are compared as printed.
+std::string print(const ref<Expr> &e) {
+  std::string s;
+  llvm::raw_string_ostream os(s);
+  ExprPPrinter::printSingleExpr(os, e);
+  return os.str();
+}
+
+class BinaryQueryLogTest : public ::testing::Test {
+protected:
+  ArrayCache ac;
+  const Array *symbolic, *constant;
+  std::vector<BinaryQueryLogRecord> records;
+
+  void SetUp() {
+    symbolic = ac.CreateArray("arr", 4);
+    ref<ConstantExpr> values[4];
+    for (unsigned i = 0; i < 4; ++i)
+      values[i] = ConstantExpr::create(i * 3, Expr::Int8);
+    constant = ac.CreateArray("const_arr", 4, values, values + 4);
+
+    UpdateList ul(symbolic, 0);
+    ul.extend(ConstantExpr::create(1, Expr::Int32),
+              ConstantExpr::create(7, Expr::Int8));
+    ref<Expr> x = ConcatExpr::create(
+        ReadExpr::create(ul, ConstantExpr::create(1, Expr::Int32)),
+        ReadExpr::create(ul, ConstantExpr::create(0, Expr::Int32)));
+    ref<Expr> y = ZExtExpr::create(
+        ReadExpr::create(
+            UpdateList(constant, 0),
+            ZExtExpr::create(ExtractExpr::create(x, 8, Expr::Int8),
+                             Expr::Int32)),
+        Expr::Int16);
+    ref<Expr> c1 = UltExpr::create(x, y);
+    ref<Expr> c2 = NeExpr::create(ConstantExpr::create(3, Expr::Int16), x);
+    const uint64_t words[2] = { 5, 9 };
+    ref<Expr> wide =
+        ConstantExpr::alloc(llvm::APInt(128, llvm::ArrayRef<uint64_t>(words)));
+
+    BinaryQueryLogRecord r;
+    r.kind = BinaryQueryLogRecord::Truth;
+    r.success = true;
+    r.status = SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+    r.time = 0.25;
+    r.instructions = 1234567;
+    r.constraints.push_back(c1);
+    r.expr = c2;
+    r.isValid = true;
+    records.push_back(r);
+
+    r.kind = BinaryQueryLogRecord::Validity;
+    r.constraints.push_back(c2);
+    r.expr = EqExpr::create(ZExtExpr::create(x, 128), wide);
+    r.validity = Solver::False;
+    records.push_back(r);
+
+    r.kind = BinaryQueryLogRecord::Value;
+    r.expr = AddExpr::create(x, y);
+    r.value = ConstantExpr::create(42, Expr::Int16);
+    records.push_back(r);
+
+    r.kind = BinaryQueryLogRecord::InitialValues;
+    r.expr = ConstantExpr::create(0, Expr::Bool);
+    r.objects.push_back(symbolic);
+    r.hasSolution = true;
+    r.values.push_back(std::vector<unsigned char>(4, 2));
+    records.push_back(r);
+
+    r.kind = BinaryQueryLogRecord::Truth;
+    r.success = false;
+    r.status = SolverImpl::SOLVER_RUN_STATUS_TIMEOUT;
+    r.objects.clear();
+    r.values.clear();
+    records.push_back(r);
+  }
+
+  void checkRoundTrip(unsigned maxDefinitions) {
+    std::string log;
+    BinaryQueryLogWriter::writeHeader(log);
+    BinaryQueryLogWriter writer(maxDefinitions);
+    for (unsigned i = 0; i < records.size(); ++i)
+      writer.write(records[i], log);
+
+    const char *begin = log.data(), *end = log.data() + log.size();
+    ASSERT_TRUE(BinaryQueryLogReader::isBinaryQueryLog(begin, end));
+    BinaryQueryLogReader reader(begin, end);
+    BinaryQueryLogRecord r;
+    for (unsigned i = 0; i < records.size(); ++i) {
+      const BinaryQueryLogRecord &o = records[i];
+      ASSERT_TRUE(reader.next(r)) << reader.getError();
+      EXPECT_EQ(o.kind, r.kind);
+      EXPECT_EQ(o.success, r.success);
+      EXPECT_EQ(o.status, r.status);
+      EXPECT_EQ(o.time, r.time);
+      EXPECT_EQ(o.instructions, r.instructions);
+      ASSERT_EQ(o.constraints.size(), r.constraints.size());
+      for (unsigned j = 0; j < o.constraints.size(); ++j)
+        EXPECT_EQ(print(o.constraints[j]), print(r.constraints[j]));
+      EXPECT_EQ(print(o.expr), print(r.expr));
+      if (!o.success)
+        continue;
+      switch (o.kind) {
+      case BinaryQueryLogRecord::Truth:
+        EXPECT_EQ(o.isValid, r.isValid);
+        break;
+      case BinaryQueryLogRecord::Validity:
+        EXPECT_EQ(o.validity, r.validity);
+        break;
+      case BinaryQueryLogRecord::Value:
+        EXPECT_EQ(print(o.value), print(r.value));
+        break;
+      case BinaryQueryLogRecord::InitialValues:
+        ASSERT_EQ(1u, r.objects.size());
+        EXPECT_EQ(o.objects[0]->name, r.objects[0]->name);
+        EXPECT_EQ(o.hasSolution, r.hasSolution);
+        EXPECT_EQ(o.values, r.values);
+        break;
+      }
+    }
+    EXPECT_FALSE(reader.next(r));
+    EXPECT_EQ("", reader.getError());
+
+    // A log cut short, as by a crash, ends with an error
+    BinaryQueryLogReader truncated(begin, end - 1);
+    unsigned count = 0;
+    while (truncated.next(r))
+      ++count;
+    EXPECT_EQ(records.size() - 1, count);
+    EXPECT_NE("", truncated.getError());
+  }
+};
+
+}
+
+TEST_F(BinaryQueryLogTest, RoundTrip) {
+  checkRoundTrip(1 << 20);
+}
+
+TEST_F(BinaryQueryLogTest, RoundTripWithResets) {
+  // The definitions are discarded before every record but the first
+  checkRoundTrip(0);
+}
+
+TEST_F(BinaryQueryLogTest, SharedNodes) {
+  std::string once, twice;
+  BinaryQueryLogWriter::writeHeader(once);
+  BinaryQueryLogWriter writer;
+  writer.write(records[0], once);
+  twice = once;
+  writer.write(records[0], twice);
+
+  // The second copy of a query only refers to the nodes of the first
+  EXPECT_LT(twice.size() - once.size(), 32u);
+}
+
+TEST(BinaryQueryLogReaderTest, Malformed) {
+  const char text[] = "(query [] false)";
+  EXPECT_FALSE(
+      BinaryQueryLogReader::isBinaryQueryLog(text, text + sizeof(text) - 1));
+
+  std::string log;
+  BinaryQueryLogWriter::writeHeader(log);
+  log += (char)3; // A query referring to undefined expressions
+  log.append(16, (char)1);
+  BinaryQueryLogReader reader(log.data(), log.data() + log.size());
+  BinaryQueryLogRecord r;
+  EXPECT_FALSE(reader.next(r));
+  EXPECT_NE("", reader.getError());
+}